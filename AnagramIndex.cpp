@@ -0,0 +1,241 @@
+#include "AnagramIndex.h"
+#include <algorithm>
+using namespace std;
+
+// Letter number 0 to 25 of a character, or -1 if it is not a letter a to z (either case).
+static int letterOf(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        return c - 'a';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    return -1;
+}
+
+string AnagramIndex::signature(string_view word)
+{
+    string sig(word);
+    for (auto &c : sig)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = c - 'A' + 'a';
+        }
+    }
+    sort(sig.begin(), sig.end());
+    return sig;
+}
+
+void AnagramIndex::add(string_view word)
+{
+    string sig = signature(word);
+    auto found = bySignature.find(sig);
+    if (found == bySignature.end()) // first word with these letters : a new group
+    {
+        uint32_t id;
+        if (!freeGroups.empty())
+        {
+            id = freeGroups.back();
+            freeGroups.pop_back();
+            groups[id] = Group();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(groups.size());
+            groups.emplace_back();
+        }
+        Group &group = groups[id];
+        for (char c : sig)
+        {
+            int letter = letterOf(c);
+            if (letter < 0)
+            {
+                group.lettersOnly = false;
+                continue;
+            }
+            group.mask |= 1u << letter;
+            if (group.counts[letter] < 255)
+            {
+                ++group.counts[letter];
+            }
+        }
+        byMask[group.mask].push_back(id);
+        found = bySignature.emplace(move(sig), id).first;
+    }
+    auto &words = groups[found->second].words; // a handful of words at most : a linear search is the fastest
+    for (auto &entry : words)
+    {
+        if (entry.first == word)
+        {
+            ++entry.second;
+            return;
+        }
+    }
+    words.emplace_back(string(word), 1);
+    ++distinct;
+}
+
+void AnagramIndex::removeAll(string_view word)
+{
+    auto found = bySignature.find(signature(word));
+    if (found == bySignature.end())
+    {
+        return;
+    }
+    uint32_t id = found->second;
+    Group &group = groups[id];
+    auto entry = find_if(group.words.begin(), group.words.end(), [&](const pair<string, uint32_t> &e)
+                         { return e.first == word; });
+    if (entry == group.words.end())
+    {
+        return;
+    }
+    group.words.erase(entry);
+    --distinct;
+    if (!group.words.empty())
+    {
+        return;
+    }
+    // the group is empty : forget it everywhere and keep its slot for the next new signature
+    auto &sameMask = byMask[group.mask];
+    auto slot = find(sameMask.begin(), sameMask.end(), id);
+    *slot = sameMask.back();
+    sameMask.pop_back();
+    if (sameMask.empty())
+    {
+        byMask.erase(group.mask);
+    }
+    bySignature.erase(found);
+    group = Group();
+    freeGroups.push_back(id);
+}
+
+void AnagramIndex::clear()
+{
+    groups.clear();
+    freeGroups.clear();
+    bySignature.clear();
+    byMask.clear();
+    distinct = 0;
+}
+
+void AnagramIndex::emitGroup(const Group &group, const function<void(const string &)> &emit)
+{
+    for (const auto &entry : group.words)
+    {
+        emit(entry.first);
+    }
+}
+
+size_t AnagramIndex::anagramsOf(string_view letters, const function<void(const string &)> &emit) const
+{
+    auto found = bySignature.find(signature(letters));
+    if (found == bySignature.end())
+    {
+        return 0;
+    }
+    const Group &group = groups[found->second];
+    emitGroup(group, emit);
+    return group.words.size();
+}
+
+size_t AnagramIndex::formableFrom(string_view tiles, const function<void(const string &)> &emit, size_t minLength) const
+{
+    array<size_t, 26> have{};
+    size_t blanks = 0;
+    uint32_t tileMask = 0;
+    for (char c : tiles)
+    {
+        int letter = letterOf(c);
+        if (letter >= 0)
+        {
+            ++have[letter];
+            tileMask |= 1u << letter;
+        }
+        else if (c == '?')
+        {
+            ++blanks;
+        }
+    }
+    size_t found = 0;
+    auto tryGroup = [&](const Group &group)
+    {
+        if (!group.lettersOnly)
+        {
+            return;
+        }
+        size_t missing = 0, length = 0; // letters the tiles do not have, to be covered by blanks
+        for (int i = 0; i < 26; ++i)
+        {
+            length += group.counts[i];
+            if (group.counts[i] > have[i])
+            {
+                missing += group.counts[i] - have[i];
+            }
+        }
+        if (missing <= blanks && length >= minLength)
+        {
+            emitGroup(group, emit);
+            found += group.words.size();
+        }
+    };
+    auto tryMask = [&](uint32_t mask)
+    {
+        auto groupsOfMask = byMask.find(mask);
+        if (groupsOfMask != byMask.end())
+        {
+            for (uint32_t id : groupsOfMask->second)
+            {
+                tryGroup(groups[id]);
+            }
+        }
+    };
+    size_t tileLetters = __builtin_popcount(tileMask);
+    if (blanks == 0 && tileLetters < 32 && (size_t(1) << tileLetters) <= byMask.size())
+    {
+        // fewer subsets of the tiles' letters than letter sets in the index : look each subset up
+        for (uint32_t subset = tileMask; subset != 0; subset = (subset - 1) & tileMask)
+        {
+            tryMask(subset);
+        }
+        return found;
+    }
+    for (const auto &entry : byMask) // otherwise go through the letter sets, skipping those needing too many blanks
+    {
+        if (static_cast<size_t>(__builtin_popcount(entry.first & ~tileMask)) > blanks)
+        {
+            continue;
+        }
+        for (uint32_t id : entry.second)
+        {
+            tryGroup(groups[id]);
+        }
+    }
+    return found;
+}
+
+size_t AnagramIndex::wordCount() const { return distinct; }
+
+size_t AnagramIndex::memoryUsage() const
+{
+    const size_t inlineCapacity = string().capacity();
+    size_t bytes = groups.capacity() * sizeof(Group) + freeGroups.capacity() * sizeof(uint32_t);
+    for (const auto &group : groups)
+    {
+        bytes += group.words.capacity() * sizeof(pair<string, uint32_t>);
+        for (const auto &entry : group.words)
+        {
+            bytes += entry.first.capacity() > inlineCapacity ? entry.first.capacity() + 1 : 0;
+        }
+    }
+    // hash nodes: the key, the value and a next pointer, plus one bucket pointer each
+    for (const auto &entry : bySignature)
+    {
+        bytes += sizeof(pair<const string, uint32_t>) + 2 * sizeof(void *) + (entry.first.capacity() > inlineCapacity ? entry.first.capacity() + 1 : 0);
+    }
+    for (const auto &entry : byMask)
+    {
+        bytes += sizeof(pair<const uint32_t, vector<uint32_t>>) + 2 * sizeof(void *) + entry.second.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,109 @@
+#ifndef ANAGRAMINDEX_H
+#define ANAGRAMINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class AnagramIndex
+ * @brief Finds the words made of exactly some letters, or of some of them, without scanning every word.
+ *
+ * Words are grouped by signature: their characters sorted, letters lowercased ("Stop", "pots"
+ * and "tops" all have the signature "opst"), so the anagrams of some letters are one hash lookup away.
+ *
+ * Each group also keeps how many of each letter its words have, and the groups are indexed by the
+ * set of letters they use (a 26 bit mask). Words formable from some tiles can only use letters among
+ * the tiles, so only the groups whose mask is a subset of the tiles' mask are looked at: either by
+ * enumerating the subsets of the tiles' mask, or by filtering the masks present, whichever is fewer.
+ *
+ * Only words made of the letters a to z (either case) can be formed from tiles.
+ */
+class AnagramIndex
+{
+private:
+    /**
+     * @brief The words sharing one signature.
+     */
+    struct Group
+    {
+        std::array<uint8_t, 26> counts{};                       ///< How many of each letter (capped at 255).
+        uint32_t mask = 0;                                      ///< Bit i set if letter 'a' + i is used.
+        bool lettersOnly = true;                                ///< False if the words contain anything else than letters.
+        std::vector<std::pair<std::string, uint32_t>> words;    ///< Each distinct word and how many copies of it there are.
+    };
+
+    std::vector<Group> groups;                                  ///< The groups (empty ones are on freeGroups, to be reused).
+    std::vector<uint32_t> freeGroups;
+    std::unordered_map<std::string, uint32_t> bySignature;      ///< signature -> group
+    std::unordered_map<uint32_t, std::vector<uint32_t>> byMask; ///< letter mask -> the groups using exactly those letters
+    size_t distinct = 0;                                        ///< Number of distinct words.
+
+    /**
+     * @brief Calls emit with every word of a group.
+     * @param group The group.
+     * @param emit Called with each distinct word.
+     */
+    static void emitGroup(const Group &group, const std::function<void(const std::string &)> &emit);
+
+public:
+    /**
+     * @brief Returns the signature of a word: its characters sorted, letters lowercased.
+     * @param word The word.
+     * @return The signature.
+     */
+    static std::string signature(std::string_view word);
+
+    /**
+     * @brief Adds one copy of a word.
+     * @param word The word.
+     */
+    void add(std::string_view word);
+
+    /**
+     * @brief Removes every copy of a word (nothing happens if it is not there).
+     * @param word The word.
+     */
+    void removeAll(std::string_view word);
+
+    /**
+     * @brief Removes every word.
+     */
+    void clear();
+
+    /**
+     * @brief Calls emit with every word using exactly the given letters (case-insensitive).
+     * @param letters The letters, in any order (eg. a word to find the anagrams of).
+     * @param emit Called with each distinct word.
+     * @return The number of words found.
+     */
+    size_t anagramsOf(std::string_view letters, const std::function<void(const std::string &)> &emit) const;
+
+    /**
+     * @brief Calls emit with every word that can be formed from some tiles, each tile used at most once.
+     * @param tiles The letters available (case-insensitive); '?' is a blank standing for any letter.
+     * @param emit Called with each distinct word.
+     * @param minLength Shortest word to report.
+     * @return The number of words found.
+     */
+    size_t formableFrom(std::string_view tiles, const std::function<void(const std::string &)> &emit, size_t minLength = 1) const;
+
+    /**
+     * @brief Returns the number of distinct words.
+     * @return The number of distinct words.
+     */
+    size_t wordCount() const;
+
+    /**
+     * @brief Returns an estimate of the memory used by the index.
+     * @return The number of bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif // ANAGRAMINDEX_H
@@ -0,0 +1,205 @@
+#include "AutoSaver.h"
+#include "Compression.h"
+#include "VocabFile.h"
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+AutoSaver::AutoSaver(const Config &cfg) : config(cfg), lastSave(chrono::steady_clock::now())
+{
+    writer = thread(&AutoSaver::loop, this);
+}
+
+AutoSaver::~AutoSaver()
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+const AutoSaver::Config &AutoSaver::getConfig() const { return config; }
+
+shared_ptr<const string> AutoSaver::cachedBlock(const string &name, uint64_t version)
+{
+    lock_guard<mutex> lock(stateMutex);
+    auto found = blocks.find(name);
+    if (found != blocks.end() && found->second.first == version)
+    {
+        return found->second.second;
+    }
+    return nullptr;
+}
+
+void AutoSaver::submit(vector<Entry> &&snapshot, size_t dirtyCategories)
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        bool wasPending = static_cast<bool>(pending);
+        pendingVersions.clear();
+        for (const auto &entry : snapshot)
+        {
+            pendingVersions.emplace_back(entry.name, entry.version);
+        }
+        pending = make_unique<vector<Entry>>(move(snapshot)); // a newer snapshot simply replaces one not written yet
+        auto now = chrono::steady_clock::now();
+        if (dirtyCategories >= config.dirtyThreshold)
+        {
+            due = now; // enough edits : save now
+        }
+        else if (!wasPending)
+        {
+            due = max(now, lastSave + config.interval); // a few edits : save when the interval is over
+        }
+    }
+    wake.notify_one();
+}
+
+AutoSaver::Versions AutoSaver::latestVersions()
+{
+    lock_guard<mutex> lock(stateMutex);
+    if (pending)
+    {
+        return pendingVersions;
+    }
+    return writingVersions.empty() ? savedVersions : writingVersions;
+}
+
+size_t AutoSaver::getSaveCount()
+{
+    lock_guard<mutex> lock(stateMutex);
+    return saves;
+}
+
+void AutoSaver::format(const string &name, const vector<string> &words, string &out)
+{
+    out += '#';
+    out += name;
+    out += '\n';
+    for (const auto &word : words) // same layout as WordList::write(sout, 1) : word, space, newline
+    {
+        out += word;
+        out += " \n";
+    }
+}
+
+void AutoSaver::loop()
+{
+    unique_lock<mutex> lock(stateMutex);
+    while (true)
+    {
+        if (!pending)
+        {
+            if (stopping)
+            {
+                return;
+            }
+            wake.wait(lock);
+            continue;
+        }
+        if (!stopping && chrono::steady_clock::now() < due)
+        {
+            wake.wait_until(lock, due); // woken early by a newer snapshot or by the destructor
+            continue;
+        }
+        unique_ptr<vector<Entry>> snapshot = move(pending);
+        writingVersions = move(pendingVersions);
+        lock.unlock(); // serialize and write without holding the lock, submit never waits for the disk
+        bool written = write(*snapshot);
+        lock.lock();
+        if (written)
+        {
+            lastSave = chrono::steady_clock::now();
+            savedVersions = move(writingVersions);
+            ++saves;
+        }
+        else if (!pending) // keep it and try again later, unless a newer snapshot (with every change in it) replaced it meanwhile
+        {
+            if (stopping)
+            {
+                cerr << "Autosave: the last changes could not be saved to " << config.filename << '\n';
+            }
+            else
+            {
+                pending = move(snapshot);
+                pendingVersions = move(writingVersions);
+                due = chrono::steady_clock::now() + max(config.interval, chrono::seconds(1));
+            }
+        }
+        writingVersions.clear();
+    }
+}
+
+bool AutoSaver::write(vector<Entry> &snapshot)
+{
+    string text;
+    for (auto &entry : snapshot)
+    {
+        if (!entry.block) // edited (or never saved) : format it now, on this thread
+        {
+            auto block = make_shared<string>();
+            if (!entry.lines.empty()) // still only in its file : split the lines read from there
+            {
+                VocabFile::forEachWord(entry.lines.data(), entry.lines.data() + entry.lines.size(), [&](const string &word)
+                                       { entry.words.push_back(word); });
+                string().swap(entry.lines);
+            }
+            format(entry.name, entry.words, *block);
+            entry.block = block;
+        }
+        text += *entry.block;
+    }
+
+    Compression::Codec codec = Compression::forFilename(config.filename); // eg. autosave.txt.gz
+    if (codec != Compression::None)
+    {
+        string packed;
+        if (!Compression::compress(text, codec, packed))
+        {
+            cerr << "Autosave: " << Compression::name(codec) << " compression is not available for " << config.filename << '\n';
+            return false;
+        }
+        text.swap(packed);
+    }
+
+    // write everything to a temporary file, flush it to the disk, then rename it over the real one :
+    // rename is atomic, so a crash leaves either the old save or the new one, never half of one
+    string temporary = config.filename + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        cerr << "Autosave: error opening file for writing: " << temporary << '\n';
+        return false;
+    }
+    size_t done = 0;
+    while (done < text.size())
+    {
+        ssize_t n = ::write(fd, text.data() + done, text.size() - done);
+        if (n <= 0)
+        {
+            cerr << "Autosave: error writing " << temporary << '\n';
+            ::close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::fsync(fd);
+    ::close(fd);
+    if (rename(temporary.c_str(), config.filename.c_str()) != 0)
+    {
+        cerr << "Autosave: error renaming " << temporary << " to " << config.filename << '\n';
+        return false;
+    }
+
+    lock_guard<mutex> lock(stateMutex);
+    blocks.clear(); // keep only what the latest save used
+    for (const auto &entry : snapshot)
+    {
+        blocks[entry.name] = make_pair(entry.version, entry.block);
+    }
+    return true;
+}
@@ -0,0 +1,142 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class AutoSaver
+ * @brief Writes snapshots of the categories to a file on a background thread.
+ *
+ * The menu thread hands over a snapshot between two commands (the only moment the
+ * categories are guaranteed not to change) and goes back to the user right away.
+ * The writer thread serializes the snapshot, writes it to a temporary file and
+ * renames it over the target, so the file on disk is always a complete save.
+ * A snapshot is only forgotten once it is written (or replaced by a newer one): when a write
+ * fails, it is tried again later.
+ */
+class AutoSaver
+{
+public:
+    /**
+     * @brief When and where to save.
+     */
+    struct Config
+    {
+        std::string filename = "autosave.txt";         ///< The file to save to.
+        std::chrono::seconds interval{30};             ///< Longest time edits wait before being saved (and time between retries of a failed save).
+        size_t dirtyThreshold = 5;                     ///< Number of edited categories that triggers a save right away.
+    };
+
+    /**
+     * @brief One category in a snapshot. Exactly one way of getting its text is filled in.
+     */
+    struct Entry
+    {
+        std::string name;                          ///< The category name.
+        uint64_t version = 0;                      ///< The category's version when the snapshot was taken.
+        std::shared_ptr<const std::string> block;  ///< Text saved earlier for this exact version, reused as is.
+        std::vector<std::string> words;            ///< Copy of the words, for categories edited since the last save.
+        std::string lines;                         ///< For categories still only in a file : their lines, read from it when the snapshot was taken.
+    };
+
+    /**
+     * @brief (name, version) of every category of a snapshot, in order.
+     */
+    using Versions = std::vector<std::pair<std::string, uint64_t>>;
+
+private:
+    Config config;
+    std::thread writer;
+    std::mutex stateMutex;                           ///< Guards everything below that both threads touch.
+    std::condition_variable wake;
+    std::unique_ptr<std::vector<Entry>> pending;    ///< The latest snapshot not written yet (a newer one replaces it).
+    Versions pendingVersions;                       ///< The versions in pending.
+    Versions writingVersions;                       ///< The versions in the snapshot being written (empty when none is).
+    Versions savedVersions;                         ///< The versions in the last snapshot written.
+    std::chrono::steady_clock::time_point due;      ///< When pending should be written.
+    std::chrono::steady_clock::time_point lastSave; ///< When the last save finished.
+    bool stopping = false;
+    std::unordered_map<std::string, std::pair<uint64_t, std::shared_ptr<const std::string>>> blocks; ///< name -> (version, saved text)
+    size_t saves = 0;                               ///< Number of completed saves.
+
+    /**
+     * @brief The writer thread: waits for snapshots and writes them when they are due.
+     */
+    void loop();
+
+    /**
+     * @brief Serializes and writes one snapshot (temporary file, then rename).
+     * @param snapshot The snapshot to write.
+     * @return True if the file was written.
+     */
+    bool write(std::vector<Entry> &snapshot);
+
+public:
+    /**
+     * @brief Starts the writer thread.
+     * @param cfg When and where to save.
+     */
+    explicit AutoSaver(const Config &cfg);
+
+    /**
+     * @brief Writes any pending snapshot right away, then stops the writer thread.
+     */
+    ~AutoSaver();
+
+    AutoSaver(const AutoSaver &) = delete;
+    AutoSaver &operator=(const AutoSaver &) = delete;
+
+    /**
+     * @brief Returns the settings.
+     * @return The settings.
+     */
+    const Config &getConfig() const;
+
+    /**
+     * @brief Returns the text saved for a category version, if the writer still has it.
+     * Lets the next snapshot skip copying categories that did not change.
+     * @param name The category name.
+     * @param version The category version.
+     * @return The saved text, or nullptr.
+     */
+    std::shared_ptr<const std::string> cachedBlock(const std::string &name, uint64_t version);
+
+    /**
+     * @brief Hands a snapshot to the writer thread. Returns immediately.
+     * @param snapshot The categories to save, in order.
+     * @param dirtyCategories How many categories changed since the last snapshot.
+     */
+    void submit(std::vector<Entry> &&snapshot, size_t dirtyCategories);
+
+    /**
+     * @brief Returns the versions of the newest snapshot that is still held: the pending one, or the
+     * one being written, or else the last one written. A failed write is held again for a retry, so
+     * only categories that differ from these need a new snapshot.
+     * @return (name, version) of every category of that snapshot, in order.
+     */
+    Versions latestVersions();
+
+    /**
+     * @brief Returns the number of completed saves.
+     * @return The number of completed saves.
+     */
+    size_t getSaveCount();
+
+    /**
+     * @brief Formats a category the way WordCat::saveToFile does.
+     * @param name The category name.
+     * @param words The words.
+     * @param out Receives the text.
+     */
+    static void format(const std::string &name, const std::vector<std::string> &words, std::string &out);
+};
+
+#endif // AUTOSAVER_H
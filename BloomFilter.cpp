@@ -0,0 +1,104 @@
+#include "BloomFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+using namespace std;
+
+BloomFilter::BloomFilter(double rate) : falsePositiveRate(rate) {}
+
+// FNV-1a over 8 bytes at a time, then a final mix so that the high and low bits are both usable
+uint64_t BloomFilter::hash(string_view word)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ word.size();
+    size_t i = 0;
+    for (; i + 8 <= word.size(); i += 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, word.data() + i, 8);
+        h = (h ^ chunk) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < word.size(); ++i)
+    {
+        h = (h ^ static_cast<unsigned char>(word[i])) * 0x100000001b3ULL;
+    }
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void BloomFilter::reset(size_t expected)
+{
+    // textbook sizing : m/n = -ln(p) / ln(2)^2 bits per word, k = (m/n) * ln(2) hash functions
+    double bitsPerWord = -log(falsePositiveRate) / (log(2.0) * log(2.0));
+    hashes = static_cast<unsigned>(clamp(lround(bitsPerWord * log(2.0)), 1L, 16L));
+    capacity = max<size_t>(expected, 64);
+    double extra = (falsePositiveRate < 0.005) ? 1.4 : 1.1; // blocking costs some accuracy, more so for low rates
+    size_t bits = static_cast<size_t>(ceil(bitsPerWord * capacity * extra));
+    blocks.assign((bits + 511) / 512, Block());
+    inserted = 0;
+    ++stats.rebuilds;
+}
+
+void BloomFilter::insert(string_view word)
+{
+    if (blocks.empty())
+    {
+        reset(0);
+    }
+    uint64_t h = hash(word);
+    Block &block = blocks[h % blocks.size()];
+    uint32_t h1 = static_cast<uint32_t>(h >> 32), h2 = static_cast<uint32_t>(h) | 1;
+    for (unsigned i = 0; i < hashes; ++i)
+    {
+        unsigned bit = (h1 + i * h2) & 511; // k positions inside the same 512 bit block (double hashing)
+        block.bits[bit >> 6] |= 1ULL << (bit & 63);
+    }
+    ++inserted;
+}
+
+bool BloomFilter::mightContain(string_view word) const
+{
+    ++stats.queries;
+    if (blocks.empty())
+    {
+        ++stats.rejected;
+        return false;
+    }
+    uint64_t h = hash(word);
+    const Block &block = blocks[h % blocks.size()];
+    uint32_t h1 = static_cast<uint32_t>(h >> 32), h2 = static_cast<uint32_t>(h) | 1;
+    for (unsigned i = 0; i < hashes; ++i)
+    {
+        unsigned bit = (h1 + i * h2) & 511;
+        if (!(block.bits[bit >> 6] & (1ULL << (bit & 63))))
+        {
+            ++stats.rejected;
+            return false;
+        }
+    }
+    ++stats.passed;
+    return true;
+}
+
+void BloomFilter::recordFalsePositive() const { ++stats.falsePositives; }
+
+bool BloomFilter::isOverfull() const { return inserted > capacity; }
+
+void BloomFilter::setFalsePositiveRate(double rate) { falsePositiveRate = clamp(rate, 1e-6, 0.5); }
+
+double BloomFilter::getFalsePositiveRate() const { return falsePositiveRate; }
+
+BloomFilter::Stats BloomFilter::getStats() const { return stats; }
+
+size_t BloomFilter::memoryUsage() const { return blocks.capacity() * sizeof(Block); }
+
+void BloomFilter::release()
+{
+    vector<Block>().swap(blocks); // assign or clear would keep the capacity
+    inserted = 0;
+}
@@ -0,0 +1,121 @@
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class BloomFilter
+ * @brief A blocked Bloom filter used to reject words that are definitely absent.
+ *
+ * Every word maps to one 64-byte block (one cache line) and sets k bits inside it,
+ * so a query reads a single cache line. A "no" answer is always right, a "maybe"
+ * answer is wrong with roughly the configured false positive rate.
+ */
+class BloomFilter
+{
+public:
+    /**
+     * @brief Hit / miss counters, so callers can see how well the filter is doing.
+     */
+    struct Stats
+    {
+        uint64_t queries = 0;        ///< Number of mightContain calls.
+        uint64_t rejected = 0;       ///< Queries answered "definitely absent" without touching the words.
+        uint64_t passed = 0;         ///< Queries answered "maybe present".
+        uint64_t falsePositives = 0; ///< Passed queries that turned out to be absent (reported by the caller).
+        uint64_t rebuilds = 0;       ///< Number of times the filter was rebuilt.
+    };
+
+private:
+    static constexpr size_t BLOCK_WORDS = 8; ///< 8 x 64 bits = 512 bits = one cache line per block.
+
+    struct alignas(64) Block
+    {
+        uint64_t bits[BLOCK_WORDS] = {};
+    };
+
+    std::vector<Block> blocks; ///< The bit array, cut into cache-line sized blocks.
+    unsigned hashes = 1;       ///< Number of bits set per word (k).
+    size_t capacity = 0;       ///< Number of words the filter was sized for.
+    size_t inserted = 0;       ///< Number of words inserted since the last reset.
+    double falsePositiveRate;  ///< The false positive rate the filter is sized for.
+    mutable Stats stats;       ///< Counters, updated by the const queries too.
+
+public:
+    /**
+     * @brief Creates an empty filter.
+     * @param rate The wanted false positive rate (eg. 0.01 for 1%).
+     */
+    explicit BloomFilter(double rate = 0.01);
+
+    /**
+     * @brief Hashes a word to 64 bits. Also used by the other word indexes.
+     * @param word The word to hash.
+     * @return The hash of the word.
+     */
+    static uint64_t hash(std::string_view word);
+
+    /**
+     * @brief Empties the filter and sizes it for a number of words.
+     * @param expected The number of words that will be inserted.
+     */
+    void reset(size_t expected);
+
+    /**
+     * @brief Adds a word to the filter.
+     * @param word The word to add.
+     */
+    void insert(std::string_view word);
+
+    /**
+     * @brief Returns false if the word is definitely absent, true if it may be present.
+     * @param word The word to check.
+     * @return False if the word is definitely absent, true otherwise.
+     */
+    bool mightContain(std::string_view word) const;
+
+    /**
+     * @brief Records that a "maybe present" answer turned out to be wrong.
+     */
+    void recordFalsePositive() const;
+
+    /**
+     * @brief Returns true once more words were inserted than the filter was sized for.
+     * @return True if the filter should be rebuilt bigger.
+     */
+    bool isOverfull() const;
+
+    /**
+     * @brief Changes the wanted false positive rate (applies at the next reset).
+     * @param rate The wanted false positive rate.
+     */
+    void setFalsePositiveRate(double rate);
+
+    /**
+     * @brief Returns the wanted false positive rate.
+     * @return The wanted false positive rate.
+     */
+    double getFalsePositiveRate() const;
+
+    /**
+     * @brief Returns the hit / miss counters.
+     * @return The hit / miss counters.
+     */
+    Stats getStats() const;
+
+    /**
+     * @brief Returns the number of bytes used by the bit array.
+     * @return The number of bytes used.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Frees the bit array. The filter rejects everything until the next reset.
+     */
+    void release();
+};
+
+#endif // BLOOMFILTER_H
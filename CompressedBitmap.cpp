@@ -0,0 +1,229 @@
+#include "CompressedBitmap.h"
+#include <algorithm>
+using namespace std;
+
+bool CompressedBitmap::Chunk::contains(uint16_t low) const
+{
+    if (isBitmap())
+    {
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return binary_search(values.begin(), values.end(), low);
+}
+
+void CompressedBitmap::Chunk::toBitmap()
+{
+    bits.assign(1024, 0);
+    for (uint16_t low : values)
+    {
+        bits[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    vector<uint16_t>().swap(values);
+}
+
+void CompressedBitmap::Chunk::toArray()
+{
+    values.clear();
+    values.reserve(count);
+    for (size_t w = 0; w < bits.size(); ++w)
+    {
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1) // one step per set bit
+        {
+            values.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    vector<uint64_t>().swap(bits);
+}
+
+size_t CompressedBitmap::chunkIndex(uint16_t key) const
+{
+    return lower_bound(chunks.begin(), chunks.end(), key, [](const Chunk &chunk, uint16_t k)
+                       { return chunk.key < k; }) -
+           chunks.begin();
+}
+
+void CompressedBitmap::add(uint32_t value)
+{
+    uint16_t key = value >> 16, low = value & 0xffff;
+    size_t i = chunkIndex(key);
+    if (i == chunks.size() || chunks[i].key != key)
+    {
+        Chunk chunk;
+        chunk.key = key;
+        chunks.insert(chunks.begin() + i, move(chunk));
+    }
+    Chunk &chunk = chunks[i];
+    if (chunk.isBitmap())
+    {
+        uint64_t &word = chunk.bits[low >> 6];
+        uint64_t bit = uint64_t(1) << (low & 63);
+        chunk.count += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+    auto at = lower_bound(chunk.values.begin(), chunk.values.end(), low);
+    if (at != chunk.values.end() && *at == low)
+    {
+        return;
+    }
+    chunk.values.insert(at, low);
+    if (++chunk.count > ARRAY_MAX) // the array would now be bigger than the bitmap
+    {
+        chunk.toBitmap();
+    }
+}
+
+void CompressedBitmap::remove(uint32_t value)
+{
+    uint16_t key = value >> 16, low = value & 0xffff;
+    size_t i = chunkIndex(key);
+    if (i == chunks.size() || chunks[i].key != key)
+    {
+        return;
+    }
+    Chunk &chunk = chunks[i];
+    if (chunk.isBitmap())
+    {
+        uint64_t &word = chunk.bits[low >> 6];
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if ((word & bit) == 0)
+        {
+            return;
+        }
+        word &= ~bit;
+        if (--chunk.count <= ARRAY_MAX / 2) // not right at the limit, so that values going in and out do not convert every time
+        {
+            chunk.toArray();
+        }
+    }
+    else
+    {
+        auto at = lower_bound(chunk.values.begin(), chunk.values.end(), low);
+        if (at == chunk.values.end() || *at != low)
+        {
+            return;
+        }
+        chunk.values.erase(at);
+        --chunk.count;
+    }
+    if (chunk.count == 0)
+    {
+        chunks.erase(chunks.begin() + i);
+    }
+}
+
+bool CompressedBitmap::contains(uint32_t value) const
+{
+    size_t i = chunkIndex(value >> 16);
+    return i < chunks.size() && chunks[i].key == (value >> 16) && chunks[i].contains(value & 0xffff);
+}
+
+size_t CompressedBitmap::cardinality() const
+{
+    size_t total = 0;
+    for (const auto &chunk : chunks)
+    {
+        total += chunk.count;
+    }
+    return total;
+}
+
+bool CompressedBitmap::isEmpty() const { return chunks.empty(); }
+
+CompressedBitmap::Chunk CompressedBitmap::intersect(const Chunk &a, const Chunk &b)
+{
+    Chunk result;
+    result.key = a.key;
+    if (a.isBitmap() && b.isBitmap()) // 64 values per AND
+    {
+        result.bits.resize(1024);
+        for (size_t w = 0; w < 1024; ++w)
+        {
+            result.bits[w] = a.bits[w] & b.bits[w];
+            result.count += __builtin_popcountll(result.bits[w]);
+        }
+        if (result.count <= ARRAY_MAX)
+        {
+            result.toArray();
+        }
+        return result;
+    }
+    if (a.isBitmap() || b.isBitmap()) // test each value of the array against the bitmap
+    {
+        const Chunk &array = a.isBitmap() ? b : a;
+        const Chunk &bitmap = a.isBitmap() ? a : b;
+        for (uint16_t low : array.values)
+        {
+            if (bitmap.contains(low))
+            {
+                result.values.push_back(low);
+            }
+        }
+    }
+    else
+    {
+        set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), back_inserter(result.values));
+    }
+    result.count = static_cast<uint32_t>(result.values.size());
+    return result;
+}
+
+void CompressedBitmap::intersectWith(const CompressedBitmap &other)
+{
+    vector<Chunk> kept;
+    size_t j = 0;
+    for (const auto &chunk : chunks)
+    {
+        while (j < other.chunks.size() && other.chunks[j].key < chunk.key)
+        {
+            ++j;
+        }
+        if (j == other.chunks.size())
+        {
+            break;
+        }
+        if (other.chunks[j].key != chunk.key) // no value of this chunk in the other set
+        {
+            continue;
+        }
+        Chunk common = intersect(chunk, other.chunks[j]);
+        if (common.count > 0)
+        {
+            kept.push_back(move(common));
+        }
+    }
+    chunks = move(kept);
+}
+
+void CompressedBitmap::forEach(const function<void(uint32_t)> &visit) const
+{
+    for (const auto &chunk : chunks)
+    {
+        uint32_t high = uint32_t(chunk.key) << 16;
+        if (!chunk.isBitmap())
+        {
+            for (uint16_t low : chunk.values)
+            {
+                visit(high | low);
+            }
+            continue;
+        }
+        for (size_t w = 0; w < chunk.bits.size(); ++w)
+        {
+            for (uint64_t word = chunk.bits[w]; word != 0; word &= word - 1)
+            {
+                visit(high | static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+}
+
+size_t CompressedBitmap::memoryUsage() const
+{
+    size_t bytes = sizeof(*this) + chunks.capacity() * sizeof(Chunk);
+    for (const auto &chunk : chunks)
+    {
+        bytes += chunk.values.capacity() * sizeof(uint16_t) + chunk.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,106 @@
+#ifndef COMPRESSEDBITMAP_H
+#define COMPRESSEDBITMAP_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @class CompressedBitmap
+ * @brief A set of 32 bit integers stored in chunks of 65536 values, each chunk in the smaller of two forms.
+ *
+ * A chunk with few values (up to 4096) is a sorted array of their low 16 bits; a fuller chunk is a
+ * plain bitmap of 65536 bits (8 KB). So a sparse set costs about 2 bytes per value and a dense one
+ * about 1 bit per possible value, and intersecting two sets works chunk by chunk: merging arrays,
+ * testing an array against a bitmap, or ANDing two bitmaps 64 values at a time.
+ */
+class CompressedBitmap
+{
+private:
+    static const size_t ARRAY_MAX = 4096; ///< Above this many values a chunk becomes a bitmap (8 KB = 4096 uint16).
+
+    /**
+     * @brief The values sharing their high 16 bits.
+     */
+    struct Chunk
+    {
+        uint16_t key = 0;              ///< The high 16 bits.
+        uint32_t count = 0;            ///< Number of values.
+        std::vector<uint16_t> values;  ///< Low 16 bits, sorted (array form).
+        std::vector<uint64_t> bits;    ///< 1024 words (bitmap form, empty in array form).
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        void toBitmap();
+        void toArray();
+    };
+
+    std::vector<Chunk> chunks; ///< Sorted by key, none empty.
+
+    /**
+     * @brief Finds the chunk of a key.
+     * @param key The high 16 bits.
+     * @return Its position in chunks, or where it would be inserted.
+     */
+    size_t chunkIndex(uint16_t key) const;
+
+    /**
+     * @brief Intersects two chunks with the same key.
+     * @param a A chunk.
+     * @param b Another chunk.
+     * @return Their common values.
+     */
+    static Chunk intersect(const Chunk &a, const Chunk &b);
+
+public:
+    /**
+     * @brief Adds a value (nothing happens if it is there already).
+     * @param value The value.
+     */
+    void add(uint32_t value);
+
+    /**
+     * @brief Removes a value (nothing happens if it is not there).
+     * @param value The value.
+     */
+    void remove(uint32_t value);
+
+    /**
+     * @brief Tells whether a value is in the set.
+     * @param value The value.
+     * @return True if it is.
+     */
+    bool contains(uint32_t value) const;
+
+    /**
+     * @brief Returns the number of values.
+     * @return The number of values.
+     */
+    size_t cardinality() const;
+
+    /**
+     * @brief Tells whether the set is empty.
+     * @return True if there are no values.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Keeps only the values that are also in another set.
+     * @param other The other set.
+     */
+    void intersectWith(const CompressedBitmap &other);
+
+    /**
+     * @brief Calls visit with every value, in increasing order.
+     * @param visit Called with each value.
+     */
+    void forEach(const std::function<void(uint32_t)> &visit) const;
+
+    /**
+     * @brief Returns the memory used by the set.
+     * @return The number of bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif // COMPRESSEDBITMAP_H
@@ -0,0 +1,519 @@
+#include "Compression.h"
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef VOCAB_WITH_ZSTD
+#include <zstd.h>
+#endif
+using namespace std;
+
+const size_t DecompressingReader::QUEUE_BLOCKS;
+
+Compression::Codec Compression::detect(const char *data, size_t length)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+    if (length >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+    {
+        return Gzip;
+    }
+    if (length >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd)
+    {
+        return Zstd;
+    }
+    return None; // a vocabulary file starts with '#' or a word, never with these bytes
+}
+
+Compression::Codec Compression::detectFile(const string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return None;
+    }
+    char magic[4];
+    ssize_t got = pread(fd, magic, sizeof(magic), 0);
+    ::close(fd);
+    return got > 0 ? detect(magic, static_cast<size_t>(got)) : None;
+}
+
+Compression::Codec Compression::forFilename(const string &filename)
+{
+    auto endsWith = [&](const char *suffix)
+    {
+        size_t n = strlen(suffix);
+        return filename.size() > n && filename.compare(filename.size() - n, n, suffix) == 0;
+    };
+    if (endsWith(".gz"))
+    {
+        return Gzip;
+    }
+    if (endsWith(".zst"))
+    {
+        return Zstd;
+    }
+    return None;
+}
+
+bool Compression::isSupported(Codec codec)
+{
+#ifdef VOCAB_WITH_ZSTD
+    return true;
+#else
+    return codec != Zstd;
+#endif
+}
+
+const char *Compression::name(Codec codec)
+{
+    switch (codec)
+    {
+    case Gzip:
+        return "gzip";
+    case Zstd:
+        return "zstd";
+    default:
+        return "plain";
+    }
+}
+
+// The compressor shared by Compression::compress and CompressingWriter : created once, then fed
+// the text piece by piece, each piece's compressed bytes going to emit.
+static void *startCompressor(Compression::Codec codec)
+{
+    if (codec == Compression::Gzip)
+    {
+        z_stream *zs = new z_stream();
+        if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) // 15 + 16 : gzip header and trailer
+        {
+            delete zs;
+            return nullptr;
+        }
+        return zs;
+    }
+#ifdef VOCAB_WITH_ZSTD
+    if (codec == Compression::Zstd)
+    {
+        ZSTD_CStream *cs = ZSTD_createCStream();
+        if (cs && ZSTD_isError(ZSTD_initCStream(cs, 3)))
+        {
+            ZSTD_freeCStream(cs);
+            return nullptr;
+        }
+        return cs;
+    }
+#endif
+    return nullptr;
+}
+
+static bool compressSome(Compression::Codec codec, void *stream, const char *data, size_t length, bool last, vector<char> &packed, const function<bool(const char *, size_t)> &emit)
+{
+    if (codec == Compression::Gzip)
+    {
+        z_stream &zs = *static_cast<z_stream *>(stream);
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        zs.avail_in = static_cast<uInt>(length);
+        do // until deflate leaves room in packed : then it has taken all the input (and, when last, ended the stream)
+        {
+            zs.next_out = reinterpret_cast<Bytef *>(packed.data());
+            zs.avail_out = static_cast<uInt>(packed.size());
+            if (deflate(&zs, last ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+            {
+                return false;
+            }
+            size_t have = packed.size() - zs.avail_out;
+            if (have > 0 && !emit(packed.data(), have))
+            {
+                return false;
+            }
+        } while (zs.avail_out == 0);
+        return true;
+    }
+#ifdef VOCAB_WITH_ZSTD
+    if (codec == Compression::Zstd)
+    {
+        ZSTD_inBuffer in{data, length, 0};
+        bool done;
+        do
+        {
+            ZSTD_outBuffer out{packed.data(), packed.size(), 0};
+            size_t left = ZSTD_compressStream2(static_cast<ZSTD_CStream *>(stream), &out, &in, last ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(left) || (out.pos > 0 && !emit(packed.data(), out.pos)))
+            {
+                return false;
+            }
+            done = last ? left == 0 : in.pos == in.size;
+        } while (!done);
+        return true;
+    }
+#endif
+    return false;
+}
+
+static void endCompressor(Compression::Codec codec, void *stream)
+{
+    if (!stream)
+    {
+        return;
+    }
+    if (codec == Compression::Gzip)
+    {
+        deflateEnd(static_cast<z_stream *>(stream));
+        delete static_cast<z_stream *>(stream);
+    }
+#ifdef VOCAB_WITH_ZSTD
+    if (codec == Compression::Zstd)
+    {
+        ZSTD_freeCStream(static_cast<ZSTD_CStream *>(stream));
+    }
+#endif
+}
+
+bool Compression::compress(const string &text, Codec codec, string &out)
+{
+    out.clear();
+    if (codec == None)
+    {
+        out = text;
+        return true;
+    }
+    void *stream = startCompressor(codec);
+    if (!stream)
+    {
+        return false;
+    }
+    vector<char> packed(1 << 16);
+    bool ok = compressSome(codec, stream, text.data(), text.size(), true, packed, [&](const char *data, size_t length)
+                           {
+        out.append(data, length);
+        return true; });
+    endCompressor(codec, stream);
+    return ok;
+}
+
+DecompressingReader::DecompressingReader(const string &filename) : file(filename)
+{
+    if (!file.isOpen())
+    {
+        return;
+    }
+    firstPending = file.next(firstData, firstLength); // an empty file is plain (and empty)
+    codec = firstPending ? Compression::detect(firstData, firstLength) : Compression::None;
+    if (codec == Compression::None)
+    {
+        return;
+    }
+    if (!Compression::isSupported(codec))
+    {
+        error = true;
+        finished = true; // no worker : next returns false at once
+        return;
+    }
+    worker = thread(&DecompressingReader::decompress, this);
+}
+
+DecompressingReader::~DecompressingReader()
+{
+    if (worker.joinable())
+    {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+}
+
+bool DecompressingReader::isOpen() const { return file.isOpen(); }
+
+Compression::Codec DecompressingReader::getCodec() const { return codec; }
+
+bool DecompressingReader::failed()
+{
+    if (codec == Compression::None)
+    {
+        return error || file.failed();
+    }
+    lock_guard<mutex> lock(stateMutex);
+    return error;
+}
+
+bool DecompressingReader::push(Block &block)
+{
+    unique_lock<mutex> lock(stateMutex);
+    changed.wait(lock, [&]()
+                 { return ready.size() < QUEUE_BLOCKS || stopping; }); // bounded : a slow caller holds the decompression back
+    if (stopping)
+    {
+        return false;
+    }
+    ready.push_back(move(block));
+    if (!spare.empty())
+    {
+        block = move(spare.back());
+        spare.pop_back();
+    }
+    else
+    {
+        block = Block();
+    }
+    lock.unlock();
+    changed.notify_all();
+    return true;
+}
+
+void DecompressingReader::decompress()
+{
+    Block block;
+    bool ok = true, complete = false; // complete : the input ends right after a whole compressed stream
+    const char *data = firstData;
+    size_t length = firstLength;
+    // each format's decoder feeds decompressed bytes into block, queuing it whenever it is full
+    function<bool(const char *, size_t)> decode;
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    int status = Z_OK;
+#ifdef VOCAB_WITH_ZSTD
+    ZSTD_DStream *ds = nullptr;
+#endif
+    if (codec == Compression::Gzip)
+    {
+        ok = inflateInit2(&zs, 15 + 16) == Z_OK; // 15 + 16 : expect a gzip header
+        decode = [&](const char *in, size_t inLength)
+        {
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+            zs.avail_in = static_cast<uInt>(inLength);
+            while (zs.avail_in > 0)
+            {
+                if (status == Z_STREAM_END) // another gzip member follows (eg. a file appended to) : it continues the text
+                {
+                    inflateReset(&zs);
+                }
+                if (block.bytes.empty())
+                {
+                    block.bytes.resize(FileIO::BLOCK_BYTES);
+                }
+                zs.next_out = reinterpret_cast<Bytef *>(block.bytes.data() + block.length);
+                zs.avail_out = static_cast<uInt>(block.bytes.size() - block.length);
+                status = inflate(&zs, Z_NO_FLUSH);
+                if (status != Z_OK && status != Z_STREAM_END)
+                {
+                    return false;
+                }
+                block.length = block.bytes.size() - zs.avail_out;
+                if (block.length == block.bytes.size() && !push(block))
+                {
+                    return false;
+                }
+            }
+            complete = status == Z_STREAM_END;
+            return true;
+        };
+    }
+#ifdef VOCAB_WITH_ZSTD
+    else
+    {
+        ds = ZSTD_createDStream();
+        ok = ds && !ZSTD_isError(ZSTD_initDStream(ds));
+        decode = [&](const char *in, size_t inLength)
+        {
+            ZSTD_inBuffer input{in, inLength, 0};
+            while (input.pos < input.size)
+            {
+                if (block.bytes.empty())
+                {
+                    block.bytes.resize(FileIO::BLOCK_BYTES);
+                }
+                ZSTD_outBuffer output{block.bytes.data() + block.length, block.bytes.size() - block.length, 0};
+                size_t hint = ZSTD_decompressStream(ds, &output, &input); // frames following each other are read one after the other
+                if (ZSTD_isError(hint))
+                {
+                    return false;
+                }
+                block.length += output.pos;
+                complete = hint == 0; // 0 : a frame just ended
+                if (block.length == block.bytes.size() && !push(block))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+    }
+#endif
+
+    while (ok && decode(data, length))
+    {
+        if (!file.next(data, length))
+        {
+            ok = !file.failed() && complete; // the file must not end in the middle of a compressed stream
+            if (ok && block.length > 0)
+            {
+                ok = push(block);
+            }
+            break;
+        }
+    }
+    if (codec == Compression::Gzip)
+    {
+        inflateEnd(&zs);
+    }
+#ifdef VOCAB_WITH_ZSTD
+    if (ds)
+    {
+        ZSTD_freeDStream(ds);
+    }
+#endif
+    {
+        lock_guard<mutex> lock(stateMutex);
+        finished = true;
+        error = error || (!ok && !stopping);
+    }
+    changed.notify_all();
+}
+
+bool DecompressingReader::next(const char *&data, size_t &length)
+{
+    if (codec == Compression::None) // plain : the file's own blocks
+    {
+        if (firstPending)
+        {
+            firstPending = false;
+            data = firstData;
+            length = firstLength;
+            return true;
+        }
+        return !error && file.next(data, length);
+    }
+    unique_lock<mutex> lock(stateMutex);
+    if (!current.bytes.empty()) // the caller is done with it
+    {
+        current.length = 0;
+        spare.push_back(move(current));
+        current = Block();
+    }
+    changed.wait(lock, [&]()
+                 { return !ready.empty() || finished; });
+    if (ready.empty() || error)
+    {
+        return false;
+    }
+    current = move(ready.front());
+    ready.pop_front();
+    lock.unlock();
+    changed.notify_all(); // there is room in the queue again
+    data = current.bytes.data();
+    length = current.length;
+    return true;
+}
+
+// the format to write in : what the file already holds when appending to it, whatever its name says
+// (gzip after plain text, or plain text after a gzip stream, would leave a file no reader understands)
+static Compression::Codec formatFor(const string &filename, bool append, Compression::Codec wanted)
+{
+    struct stat info;
+    if (!append || ::stat(filename.c_str(), &info) != 0 || info.st_size == 0)
+    {
+        return wanted; // a new (or empty) file : whatever format was asked for
+    }
+    return Compression::detectFile(filename);
+}
+
+CompressingWriter::CompressingWriter(const string &filename, bool append, Compression::Codec codec)
+    : file(filename, append), codec(formatFor(filename, append, codec))
+{
+    if (this->codec != Compression::None)
+    {
+        stream = startCompressor(this->codec);
+        if (!stream) // eg. appending to a zstd file in a build without zstd
+        {
+            error = true;
+            return;
+        }
+        packed.resize(FileIO::BLOCK_BYTES);
+    }
+    buffer.resize(FileIO::BLOCK_BYTES);
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+CompressingWriter::~CompressingWriter()
+{
+    close();
+}
+
+bool CompressingWriter::isOpen() const { return file.isOpen() && !error; }
+
+bool CompressingWriter::drain(bool last)
+{
+    size_t count = static_cast<size_t>(pptr() - pbase());
+    if (!error)
+    {
+        if (codec == Compression::None)
+        {
+            error = count > 0 && file.sputn(buffer.data(), static_cast<streamsize>(count)) != static_cast<streamsize>(count);
+        }
+        else
+        {
+            error = !compressSome(codec, stream, buffer.data(), count, last, packed, [&](const char *data, size_t length)
+                                  { return file.sputn(data, static_cast<streamsize>(length)) == static_cast<streamsize>(length); });
+        }
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return !error;
+}
+
+CompressingWriter::int_type CompressingWriter::overflow(int_type c)
+{
+    if (!isOpen() || !drain(false))
+    {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+streamsize CompressingWriter::xsputn(const char *s, streamsize count)
+{
+    if (!isOpen())
+    {
+        return 0;
+    }
+    streamsize done = 0;
+    while (done < count)
+    {
+        if (pptr() == epptr() && !drain(false))
+        {
+            break;
+        }
+        streamsize room = min<streamsize>(epptr() - pptr(), count - done);
+        memcpy(pptr(), s + done, static_cast<size_t>(room));
+        pbump(static_cast<int>(room));
+        done += room;
+    }
+    return done;
+}
+
+bool CompressingWriter::close()
+{
+    if (!file.isOpen())
+    {
+        endCompressor(codec, stream);
+        stream = nullptr;
+        return false;
+    }
+    if (!error)
+    {
+        drain(true);
+    }
+    endCompressor(codec, stream);
+    stream = nullptr;
+    bool closed = file.close();
+    return closed && !error;
+}
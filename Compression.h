@@ -0,0 +1,229 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "FileIO.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class Compression
+ * @brief Tells compressed files apart by their first bytes, and compresses whole texts.
+ *
+ * gzip is always available (zlib). zstd needs the program to be built with VOCAB_WITH_ZSTD
+ * defined and linked with -lzstd; otherwise zstd files are recognised but cannot be read.
+ */
+class Compression
+{
+public:
+    /**
+     * @brief A compression format.
+     */
+    enum Codec
+    {
+        None, ///< Plain text.
+        Gzip, ///< gzip (starts with 1f 8b).
+        Zstd  ///< zstd (starts with 28 b5 2f fd).
+    };
+
+    /**
+     * @brief Tells the format of some data from its first bytes.
+     * @param data The first bytes.
+     * @param length How many there are (4 are enough).
+     * @return The format (None if it is not a known one).
+     */
+    static Codec detect(const char *data, size_t length);
+
+    /**
+     * @brief Tells the format of a file from its first bytes.
+     * @param filename The file.
+     * @return The format (None if it is not a known one, or the file cannot be read).
+     */
+    static Codec detectFile(const std::string &filename);
+
+    /**
+     * @brief Chooses the format to write a file in from its name.
+     * @param filename The file.
+     * @return Gzip for ".gz", Zstd for ".zst", None otherwise.
+     */
+    static Codec forFilename(const std::string &filename);
+
+    /**
+     * @brief Tells whether this build can read and write a format.
+     * @param codec The format.
+     * @return True if it can.
+     */
+    static bool isSupported(Codec codec);
+
+    /**
+     * @brief Returns the name of a format.
+     * @param codec The format.
+     * @return "plain", "gzip" or "zstd".
+     */
+    static const char *name(Codec codec);
+
+    /**
+     * @brief Compresses a whole text at once.
+     * @param text The text.
+     * @param codec The format (None copies the text).
+     * @param out Receives the compressed bytes.
+     * @return False if the format is not supported.
+     */
+    static bool compress(const std::string &text, Codec codec, std::string &out);
+};
+
+/**
+ * @class DecompressingReader
+ * @brief Hands out the contents of a plain or compressed file block by block, in order.
+ *
+ * A compressed file is decompressed on a thread of its own, which reads ahead through a
+ * FileReader and hands decompressed blocks over through a small bounded queue, so whatever the
+ * caller does with a block (eg. parsing it) overlaps with decompressing the next ones. A plain
+ * file is handed out straight from its FileReader, with no thread.
+ */
+class DecompressingReader
+{
+private:
+    static const size_t QUEUE_BLOCKS = 4; ///< Decompressed blocks the thread may get ahead of the caller.
+
+    /**
+     * @brief A decompressed block.
+     */
+    struct Block
+    {
+        std::vector<char> bytes; ///< BLOCK_BYTES of room.
+        size_t length = 0;       ///< How many are used.
+    };
+
+    FileReader file;                 ///< The file as it is on disk.
+    Compression::Codec codec = Compression::None; ///< Its format.
+    const char *firstData = nullptr; ///< The first block of the file, read to detect the format...
+    size_t firstLength = 0;          ///< ...and its length.
+    bool firstPending = false;       ///< True until the first block is used.
+    std::thread worker;              ///< Decompresses (compressed files only).
+    std::mutex stateMutex;           ///< Guards everything below.
+    std::condition_variable changed; ///< Signalled when a block is queued or taken, and at the end.
+    std::deque<Block> ready;         ///< Decompressed blocks not handed out yet.
+    std::vector<Block> spare;        ///< Blocks handed back, to reuse.
+    Block current;                   ///< The block handed out last.
+    bool finished = false;           ///< True once the worker is done.
+    bool stopping = false;           ///< True when the reader is destroyed before the end.
+    bool error = false;              ///< True after a read or decompression error.
+
+    /**
+     * @brief The worker thread: decompresses the whole file into blocks.
+     */
+    void decompress();
+
+    /**
+     * @brief Queues a decompressed block, waiting while the queue is full.
+     * @param block The block; receives an empty one to fill next.
+     * @return False if the reader is being destroyed.
+     */
+    bool push(Block &block);
+
+public:
+    /**
+     * @brief Opens a file, detects its format and, if it is compressed, starts decompressing it.
+     * @param filename The file.
+     */
+    explicit DecompressingReader(const std::string &filename);
+
+    /**
+     * @brief Stops the worker thread.
+     */
+    ~DecompressingReader();
+
+    DecompressingReader(const DecompressingReader &) = delete;
+    DecompressingReader &operator=(const DecompressingReader &) = delete;
+
+    /**
+     * @brief Tells whether the file was opened.
+     * @return True if it was.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Returns the format of the file.
+     * @return The format.
+     */
+    Compression::Codec getCodec() const;
+
+    /**
+     * @brief Hands out the next block of the contents (valid until the next call).
+     * @param data Receives the first byte of the block.
+     * @param length Receives the size of the block.
+     * @return False at the end, or after an error.
+     */
+    bool next(const char *&data, size_t &length);
+
+    /**
+     * @brief Tells whether reading or decompressing failed (including an unsupported format).
+     * @return True if it did.
+     */
+    bool failed();
+};
+
+/**
+ * @class CompressingWriter
+ * @brief An output stream buffer writing a file plain or compressed, through a FileWriter.
+ */
+class CompressingWriter : public std::streambuf
+{
+private:
+    FileWriter file;                     ///< The file, written in large queued blocks.
+    Compression::Codec codec;            ///< The format.
+    std::vector<char> buffer;            ///< Text waiting to be compressed.
+    std::vector<char> packed;            ///< Compressed bytes on their way to the file.
+    void *stream = nullptr;              ///< The compressor state (z_stream or ZSTD_CStream), or nullptr.
+    bool error = false;                  ///< True after an error.
+
+    /**
+     * @brief Compresses (or copies) the buffered text into the file.
+     * @param last True to end the compressed stream.
+     * @return False after an error.
+     */
+    bool drain(bool last);
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize count) override;
+
+public:
+    /**
+     * @brief Opens a file for writing.
+     * @param filename The file.
+     * @param append True to write after what the file already has (a compressed file gets another
+     * compressed stream, which gzip and zstd readers take as the continuation of the text).
+     * @param codec The format of a new (or empty) file. A file that has contents already is always
+     * appended to in the format it is in (detected from its first bytes), whatever codec says.
+     */
+    CompressingWriter(const std::string &filename, bool append, Compression::Codec codec);
+
+    /**
+     * @brief Finishes the file (see close).
+     */
+    ~CompressingWriter() override;
+
+    CompressingWriter(const CompressingWriter &) = delete;
+    CompressingWriter &operator=(const CompressingWriter &) = delete;
+
+    /**
+     * @brief Tells whether the file was opened (and the format is supported, including the format of
+     * a file being appended to).
+     * @return True if it was.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Ends the compressed stream, writes what is left and closes the file.
+     * @return False if the file could not be opened or written.
+     */
+    bool close();
+};
+
+#endif // COMPRESSION_H
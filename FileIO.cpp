@@ -0,0 +1,615 @@
+#include "FileIO.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+using namespace std;
+
+const size_t FileIO::BLOCK_BYTES;
+const unsigned FileIO::DEPTH;
+
+static atomic<bool> uringEnabled(true);
+static atomic<bool> uringAvailable(true); // false once setting up a ring failed : it would fail again
+
+static const size_t POOL_SIZE = 4; // backends a thread keeps for reuse (more are only needed while that many files are open at once)
+
+static const uint64_t BROKEN = ~uint64_t(0); // tag of the completion wait returns when the backend itself failed
+
+// The fallback : every request is done as soon as it is queued, wait only hands the results back.
+class PosixIO : public FileIO
+{
+private:
+    deque<Completion> finished;
+
+public:
+    const char *name() const override { return "pread/pwrite"; }
+
+    void read(int fd, char *buffer, size_t length, uint64_t offset, uint64_t tag) override
+    {
+        ssize_t got;
+        do
+        {
+            got = pread(fd, buffer, length, static_cast<off_t>(offset));
+        } while (got < 0 && errno == EINTR);
+        finished.push_back(Completion{tag, got < 0 ? -errno : static_cast<long>(got)});
+    }
+
+    void write(int fd, const char *buffer, size_t length, uint64_t offset, uint64_t tag) override
+    {
+        ssize_t put;
+        do
+        {
+            put = pwrite(fd, buffer, length, static_cast<off_t>(offset));
+        } while (put < 0 && errno == EINTR);
+        finished.push_back(Completion{tag, put < 0 ? -errno : static_cast<long>(put)});
+    }
+
+    Completion waitNext() override
+    {
+        if (finished.empty())
+        {
+            return Completion{BROKEN, -EINVAL};
+        }
+        Completion done = finished.front();
+        finished.pop_front();
+        return done;
+    }
+};
+
+// io_uring through its system calls (liburing is not needed) : requests go into the submission
+// ring shared with the kernel, results come back in the completion ring, and one io_uring_enter
+// call both sends everything queued and waits for a result.
+class UringIO : public FileIO
+{
+private:
+    int ringFd = -1;
+    void *sqRing = MAP_FAILED, *cqRing = MAP_FAILED;
+    size_t sqRingSize = 0, cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr, sqEntries = 0;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    unsigned toSubmit = 0; // queued in the ring, not sent to the kernel yet
+
+    int enter(unsigned submit, unsigned waitFor)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, submit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    }
+
+    void queue(uint8_t op, int fd, const char *buffer, size_t length, uint64_t offset, uint64_t tag)
+    {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) // ring full : let the kernel take what is there
+        {
+            int sent = enter(toSubmit, 0);
+            toSubmit -= sent > 0 ? static_cast<unsigned>(sent) : 0;
+        }
+        unsigned index = tail & *sqMask;
+        io_uring_sqe &sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = op;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE); // the kernel may read the entry from now on
+        ++toSubmit;
+    }
+
+public:
+    // sets up the rings, false (with errno telling why) if the kernel has no io_uring, one too old for
+    // IORING_OP_READ/WRITE (EINVAL), or not enough memory or descriptors left for one more ring
+    bool open(unsigned depth)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (ringFd < 0)
+        {
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) // that feature came with the plain read/write operations
+        {
+            errno = EINVAL;
+            return false;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP; // both rings in one mapping
+        if (single)
+        {
+            sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+        {
+            return false;
+        }
+        if (single)
+        {
+            cqRingSize = 0; // not mapped separately
+        }
+        else
+        {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED)
+            {
+                return false;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+        {
+            return false;
+        }
+        char *sq = static_cast<char *>(sqRing);
+        char *cq = single ? sq : static_cast<char *>(cqRing);
+        sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sqEntries = params.sq_entries;
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    ~UringIO() override
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (ringFd >= 0)
+            close(ringFd); // the kernel finishes or cancels whatever is still in flight
+    }
+
+    const char *name() const override { return "io_uring"; }
+
+    void read(int fd, char *buffer, size_t length, uint64_t offset, uint64_t tag) override
+    {
+        queue(IORING_OP_READ, fd, buffer, length, offset, tag);
+    }
+
+    void write(int fd, const char *buffer, size_t length, uint64_t offset, uint64_t tag) override
+    {
+        queue(IORING_OP_WRITE, fd, buffer, length, offset, tag);
+    }
+
+    Completion waitNext() override
+    {
+        while (true)
+        {
+            unsigned head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            {
+                const io_uring_cqe &cqe = cqes[head & *cqMask];
+                Completion done{cqe.user_data, cqe.res};
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE); // the kernel may reuse the entry
+                return done;
+            }
+            int sent = enter(toSubmit, 1);
+            if (sent < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                {
+                    continue;
+                }
+                return Completion{BROKEN, -errno};
+            }
+            toSubmit -= static_cast<unsigned>(sent);
+        }
+    }
+};
+
+unique_ptr<FileIO> FileIO::create(unsigned depth)
+{
+    if (uringEnabled && uringAvailable)
+    {
+        auto uring = make_unique<UringIO>();
+        if (uring->open(depth))
+        {
+            return uring;
+        }
+        if (errno == ENOSYS || errno == EPERM || errno == EINVAL)
+        {
+            uringAvailable = false; // no io_uring here (or too old, or not allowed) : stop paying for the attempt
+        }
+        // otherwise short of memory or descriptors for now (ENOMEM, EMFILE) : only this file goes without a ring
+    }
+    return make_unique<PosixIO>();
+}
+
+// the backends given back on this thread, ready for the next file
+static vector<unique_ptr<FileIO>> &threadPool()
+{
+    thread_local vector<unique_ptr<FileIO>> pool;
+    return pool;
+}
+
+FileIO::Handle FileIO::acquire()
+{
+    vector<unique_ptr<FileIO>> &pool = threadPool();
+    while (!pool.empty())
+    {
+        unique_ptr<FileIO> io = move(pool.back());
+        pool.pop_back();
+        if (uringEnabled || !dynamic_cast<UringIO *>(io.get())) // io_uring was turned off since it was given back
+        {
+            return Handle(io.release());
+        }
+    }
+    return Handle(create().release());
+}
+
+void FileIO::Release::operator()(FileIO *io) const
+{
+    unique_ptr<FileIO> owned(io);
+    vector<unique_ptr<FileIO>> &pool = threadPool(); // maybe not the thread it was borrowed on : any thread may use it next
+    if (!io->broken && pool.size() < POOL_SIZE)
+    {
+        pool.push_back(move(owned));
+    }
+}
+
+FileIO::Completion FileIO::wait()
+{
+    Completion done = waitNext();
+    if (done.tag == BROKEN)
+    {
+        broken = true;
+    }
+    return done;
+}
+
+bool FileIO::isBroken() const { return broken; }
+
+void FileIO::setUringEnabled(bool enabled) { uringEnabled = enabled; }
+
+// reads length bytes at offset into contents, DEPTH blocks at a time, each block going straight to its place
+static bool readFd(int fd, uint64_t offset, size_t length, string &contents)
+{
+    contents.resize(length);
+    const size_t block = FileIO::BLOCK_BYTES;
+    size_t blocks = (length + block - 1) / block;
+    vector<size_t> got(blocks, 0);
+    FileIO::Handle io = FileIO::acquire();
+    size_t nextBlock = 0, inFlight = 0;
+    bool ok = true;
+    auto blockLength = [&](size_t i)
+    { return min(block, length - i * block); };
+    auto queue = [&](size_t i) // the rest of block i
+    {
+        size_t start = i * block + got[i];
+        io->read(fd, &contents[start], blockLength(i) - got[i], offset + start, i);
+        ++inFlight;
+    };
+    while (nextBlock < blocks && inFlight < FileIO::DEPTH)
+    {
+        queue(nextBlock++);
+    }
+    while (inFlight > 0)
+    {
+        FileIO::Completion done = io->wait();
+        --inFlight;
+        if (done.result <= 0 || done.tag >= blocks) // an error, or the file is shorter than expected
+        {
+            ok = false;
+            if (done.tag == BROKEN)
+            {
+                break; // nothing more will complete
+            }
+            continue;
+        }
+        got[done.tag] += static_cast<size_t>(done.result);
+        if (!ok)
+        {
+            continue;
+        }
+        if (got[done.tag] < blockLength(done.tag)) // a short read : ask for the rest
+        {
+            queue(done.tag);
+        }
+        else if (nextBlock < blocks)
+        {
+            queue(nextBlock++);
+        }
+    }
+    return ok;
+}
+
+bool FileIO::readRange(const string &filename, uint64_t offset, size_t length, string &contents)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = readFd(fd, offset, length, contents);
+    ::close(fd);
+    return ok;
+}
+
+bool FileIO::readAll(const string &filename, string &contents)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && readFd(fd, 0, static_cast<size_t>(info.st_size), contents);
+    ::close(fd);
+    return ok;
+}
+
+FileReader::FileReader(const string &filename)
+{
+    fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        error = true;
+        return;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+    io = FileIO::acquire();
+    size_t slots = static_cast<size_t>(min<uint64_t>(FileIO::DEPTH, (size + FileIO::BLOCK_BYTES - 1) / FileIO::BLOCK_BYTES));
+    blocks.resize(slots);
+    blockAt.assign(slots, ~uint64_t(0));
+    filled.assign(slots, 0);
+    done.assign(slots, false);
+    for (size_t slot = 0; slot < slots; ++slot)
+    {
+        queue(slot);
+    }
+}
+
+FileReader::~FileReader()
+{
+    for (; inFlight > 0; --inFlight) // the buffers must outlive the reads
+    {
+        if (io->wait().tag == ~uint64_t(0))
+        {
+            break;
+        }
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+void FileReader::queue(size_t slot)
+{
+    blockAt[slot] = ~uint64_t(0); // idle unless there is a block left
+    done[slot] = false;
+    if (nextRead >= size || error)
+    {
+        return;
+    }
+    size_t length = static_cast<size_t>(min<uint64_t>(FileIO::BLOCK_BYTES, size - nextRead));
+    blocks[slot].resize(FileIO::BLOCK_BYTES);
+    blockAt[slot] = nextRead;
+    filled[slot] = 0;
+    io->read(fd, blocks[slot].data(), length, nextRead, slot);
+    nextRead += length;
+    ++inFlight;
+}
+
+bool FileReader::isOpen() const { return fd >= 0; }
+
+bool FileReader::failed() const { return error; }
+
+bool FileReader::next(const char *&data, size_t &length)
+{
+    if (handedOut >= 0) // the caller is done with it : read a later block into it
+    {
+        queue(static_cast<size_t>(handedOut));
+        handedOut = -1;
+    }
+    if (fd < 0 || error || nextOut >= size)
+    {
+        return false;
+    }
+    size_t slot = find(blockAt.begin(), blockAt.end(), nextOut) - blockAt.begin(); // the blocks are queued in order, so it is in flight
+    while (!done[slot])
+    {
+        FileIO::Completion finished = io->wait();
+        --inFlight;
+        if (finished.result <= 0 || finished.tag >= blocks.size())
+        {
+            error = true;
+            return false;
+        }
+        size_t s = finished.tag;
+        filled[s] += static_cast<size_t>(finished.result);
+        size_t want = static_cast<size_t>(min<uint64_t>(FileIO::BLOCK_BYTES, size - blockAt[s]));
+        if (filled[s] < want) // a short read : ask for the rest
+        {
+            io->read(fd, blocks[s].data() + filled[s], want - filled[s], blockAt[s] + filled[s], s);
+            ++inFlight;
+        }
+        else
+        {
+            done[s] = true;
+        }
+    }
+    data = blocks[slot].data();
+    length = filled[slot];
+    nextOut += length;
+    handedOut = static_cast<long>(slot);
+    return true;
+}
+
+FileWriter::FileWriter(const string &filename, bool append)
+{
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (append && fstat(fd, &info) == 0)
+    {
+        offset = static_cast<uint64_t>(info.st_size); // positioned writes : append by starting at the end
+    }
+    io = FileIO::acquire();
+    blocks.emplace_back(FileIO::BLOCK_BYTES);
+    blockAt.push_back(0);
+    written.push_back(0);
+    length.push_back(0);
+    setp(blocks[0].data(), blocks[0].data() + blocks[0].size());
+}
+
+FileWriter::~FileWriter()
+{
+    close();
+}
+
+bool FileWriter::isOpen() const { return fd >= 0; }
+
+void FileWriter::waitOne()
+{
+    FileIO::Completion finished = io->wait();
+    --inFlight;
+    if (finished.tag >= blocks.size())
+    {
+        error = true;
+        inFlight = 0; // the backend is broken : nothing else will complete
+        return;
+    }
+    size_t b = finished.tag;
+    if (finished.result <= 0)
+    {
+        error = true;
+        freeBlocks.push_back(b);
+        return;
+    }
+    written[b] += static_cast<size_t>(finished.result);
+    if (written[b] < length[b]) // a short write : queue the rest
+    {
+        io->write(fd, blocks[b].data() + written[b], length[b] - written[b], blockAt[b] + written[b], b);
+        ++inFlight;
+        return;
+    }
+    freeBlocks.push_back(b);
+}
+
+bool FileWriter::submitCurrent()
+{
+    size_t count = static_cast<size_t>(pptr() - pbase());
+    if (count == 0 || fd < 0)
+    {
+        return !error;
+    }
+    if (!error) // after an error the rest is dropped
+    {
+        blockAt[current] = offset;
+        written[current] = 0;
+        length[current] = count;
+        io->write(fd, blocks[current].data(), count, offset, current);
+        offset += count;
+        ++inFlight;
+        // format into another buffer while this one is written
+        if (freeBlocks.empty() && blocks.size() < FileIO::DEPTH)
+        {
+            blocks.emplace_back(FileIO::BLOCK_BYTES);
+            blockAt.push_back(0);
+            written.push_back(0);
+            length.push_back(0);
+            freeBlocks.push_back(blocks.size() - 1);
+        }
+        while (freeBlocks.empty() && inFlight > 0) // every buffer is being written : wait for one
+        {
+            waitOne();
+        }
+        current = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    setp(blocks[current].data(), blocks[current].data() + blocks[current].size());
+    return !error;
+}
+
+FileWriter::int_type FileWriter::overflow(int_type c)
+{
+    if (fd < 0 || !submitCurrent())
+    {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+streamsize FileWriter::xsputn(const char *s, streamsize count)
+{
+    if (fd < 0)
+    {
+        return 0;
+    }
+    streamsize done = 0;
+    while (done < count)
+    {
+        if (pptr() == epptr() && !submitCurrent())
+        {
+            break;
+        }
+        streamsize room = min<streamsize>(epptr() - pptr(), count - done);
+        memcpy(pptr(), s + done, static_cast<size_t>(room));
+        pbump(static_cast<int>(room));
+        done += room;
+    }
+    return done;
+}
+
+int FileWriter::sync()
+{
+    if (fd < 0)
+    {
+        return -1;
+    }
+    submitCurrent();
+    while (inFlight > 0)
+    {
+        waitOne();
+    }
+    return error ? -1 : 0;
+}
+
+bool FileWriter::close()
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+    sync();
+    if (::close(fd) != 0)
+    {
+        error = true;
+    }
+    fd = -1;
+    return !error;
+}
@@ -0,0 +1,271 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/**
+ * @class FileIO
+ * @brief Queues large file reads and writes and waits for them to finish, in any order.
+ *
+ * Two backends do the work: Linux io_uring, which keeps several requests in flight at once so
+ * the device sees a deep queue, and a fallback doing each request with plain pread/pwrite when it
+ * is queued (for kernels without io_uring, or when it is turned off). Callers only see the queue.
+ *
+ * Setting up a ring costs a system call and three mappings, more than a small file takes to read,
+ * so the helpers below do not make a backend per file: they borrow one from the calling thread
+ * (see acquire), which keeps the ones given back for the next file.
+ */
+class FileIO
+{
+private:
+    bool broken = false; ///< True once wait reported that the backend itself failed.
+
+public:
+    static const size_t BLOCK_BYTES = 1 << 20; ///< Size of each request issued by the helpers below.
+    static const unsigned DEPTH = 8;           ///< Requests the helpers keep in flight.
+
+    /**
+     * @brief A finished request.
+     */
+    struct Completion
+    {
+        uint64_t tag = 0; ///< The tag the request was queued with.
+        long result = 0;  ///< Bytes read or written (maybe fewer than asked), or -errno.
+    };
+
+    /**
+     * @brief Gives a borrowed backend back to the pool of the calling thread (see acquire).
+     */
+    struct Release
+    {
+        void operator()(FileIO *io) const;
+    };
+
+    /**
+     * @brief A backend borrowed with acquire; given back when it is destroyed.
+     */
+    using Handle = std::unique_ptr<FileIO, Release>;
+
+    virtual ~FileIO() = default;
+
+    /**
+     * @brief Creates the best backend available.
+     * Once setting up io_uring failed, it is not tried again: every later backend is a pread/pwrite one.
+     * @param depth The most requests that will be in flight at once.
+     * @return An io_uring backend if the kernel has it (and it is enabled), a pread/pwrite one otherwise.
+     */
+    static std::unique_ptr<FileIO> create(unsigned depth = DEPTH);
+
+    /**
+     * @brief Borrows a backend (of depth DEPTH) from the calling thread, creating one only if the
+     * thread has none to spare (eg. the first time, or while another file is being read).
+     * The backend must have no request in flight when the handle is destroyed.
+     * @return The backend.
+     */
+    static Handle acquire();
+
+    /**
+     * @brief Tells whether wait reported that the backend itself failed (it is then not reused).
+     * @return True if it did.
+     */
+    bool isBroken() const;
+
+    /**
+     * @brief Turns the io_uring backend on or off for the backends created after the call (on by default).
+     * @param enabled False to always use pread/pwrite.
+     */
+    static void setUringEnabled(bool enabled);
+
+    /**
+     * @brief Returns the name of the backend.
+     * @return "io_uring" or "pread/pwrite".
+     */
+    virtual const char *name() const = 0;
+
+    /**
+     * @brief Queues a read.
+     * @param fd The file.
+     * @param buffer Where the bytes go (must stay valid until the request completes).
+     * @param length The number of bytes to read.
+     * @param offset Where to read in the file.
+     * @param tag Given back with the completion.
+     */
+    virtual void read(int fd, char *buffer, size_t length, uint64_t offset, uint64_t tag) = 0;
+
+    /**
+     * @brief Queues a write.
+     * @param fd The file.
+     * @param buffer The bytes to write (must stay valid until the request completes).
+     * @param length The number of bytes to write.
+     * @param offset Where to write in the file.
+     * @param tag Given back with the completion.
+     */
+    virtual void write(int fd, const char *buffer, size_t length, uint64_t offset, uint64_t tag) = 0;
+
+    /**
+     * @brief Sends the queued requests and waits until one of them is done.
+     * There must be at least one request in flight.
+     * @return The finished request, or one tagged ~0 if the backend itself failed.
+     */
+    Completion wait();
+
+    /**
+     * @brief Reads part of a file with up to DEPTH large reads in flight, straight into the result.
+     * @param filename The file.
+     * @param offset Where to start.
+     * @param length The number of bytes to read.
+     * @param contents Receives the bytes.
+     * @return False if the file cannot be opened or is shorter than expected.
+     */
+    static bool readRange(const std::string &filename, uint64_t offset, size_t length, std::string &contents);
+
+    /**
+     * @brief Reads a whole file with up to DEPTH large reads in flight, straight into the result.
+     * @param filename The file.
+     * @param contents Receives the contents of the file.
+     * @return False if the file cannot be opened or read.
+     */
+    static bool readAll(const std::string &filename, std::string &contents);
+
+protected:
+    /**
+     * @brief Does the work of wait.
+     * @return The finished request, or one tagged ~0 if the backend itself failed.
+     */
+    virtual Completion waitNext() = 0;
+};
+
+/**
+ * @class FileReader
+ * @brief Hands out a file block by block, in order, while the next blocks are already being read.
+ */
+class FileReader
+{
+private:
+    FileIO::Handle io;                 ///< The backend, borrowed from the thread that opened the file.
+    int fd = -1;                       ///< The file, or -1 if it could not be opened.
+    uint64_t size = 0;                 ///< Size of the file.
+    uint64_t nextRead = 0;             ///< Offset of the next block to queue.
+    uint64_t nextOut = 0;              ///< Offset of the next block to hand out.
+    std::vector<std::vector<char>> blocks; ///< One buffer per request in flight.
+    std::vector<uint64_t> blockAt;     ///< Offset each buffer is reading.
+    std::vector<size_t> filled;        ///< Bytes each buffer has so far.
+    std::vector<bool> done;            ///< True when a buffer's read is complete.
+    size_t inFlight = 0;               ///< Reads queued and not complete yet.
+    long handedOut = -1;               ///< The buffer handed out last (queued again on the next call), or -1.
+    bool error = false;                ///< True after a failed read.
+
+    /**
+     * @brief Queues the read of the next block into a buffer, if the file has one left.
+     * @param slot The buffer.
+     */
+    void queue(size_t slot);
+
+public:
+    /**
+     * @brief Opens a file and starts reading its first blocks.
+     * @param filename The file.
+     */
+    explicit FileReader(const std::string &filename);
+
+    /**
+     * @brief Waits for the reads still in flight and closes the file.
+     */
+    ~FileReader();
+
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    /**
+     * @brief Tells whether the file was opened.
+     * @return True if it was.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Hands out the next block of the file (valid until the next call).
+     * @param data Receives the first byte of the block.
+     * @param length Receives the size of the block.
+     * @return False at the end of the file, or after an error.
+     */
+    bool next(const char *&data, size_t &length);
+
+    /**
+     * @brief Tells whether a read failed.
+     * @return True if one did.
+     */
+    bool failed() const;
+};
+
+/**
+ * @class FileWriter
+ * @brief An output stream buffer writing a file in large blocks queued to a FileIO backend.
+ *
+ * Formatting goes on into the next block while the full ones are being written, so an ostream
+ * built on it writes at the speed of the device rather than one small write at a time.
+ */
+class FileWriter : public std::streambuf
+{
+private:
+    FileIO::Handle io;                 ///< The backend, borrowed from the thread that opened the file.
+    int fd = -1;                       ///< The file, or -1 if it could not be opened.
+    uint64_t offset = 0;               ///< Where the next block goes in the file.
+    std::vector<std::vector<char>> blocks; ///< Buffers, DEPTH at most.
+    std::vector<size_t> freeBlocks;    ///< Buffers not being written.
+    std::vector<uint64_t> blockAt;     ///< Where each buffer being written goes.
+    std::vector<size_t> written;       ///< Bytes of each buffer written so far.
+    std::vector<size_t> length;        ///< Bytes to write from each buffer.
+    size_t current = 0;                ///< The buffer being filled.
+    size_t inFlight = 0;               ///< Writes queued and not complete yet.
+    bool error = false;                ///< True after a failed write.
+
+    /**
+     * @brief Queues the write of the buffer being filled and starts filling a free one.
+     * @return False after a failed write.
+     */
+    bool submitCurrent();
+
+    /**
+     * @brief Waits for one write, queuing the rest of it again if it was short.
+     */
+    void waitOne();
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize count) override;
+    int sync() override;
+
+public:
+    /**
+     * @brief Opens a file for writing.
+     * @param filename The file.
+     * @param append True to write after what the file already has, false to replace it.
+     */
+    FileWriter(const std::string &filename, bool append);
+
+    /**
+     * @brief Finishes the writes (see close).
+     */
+    ~FileWriter() override;
+
+    FileWriter(const FileWriter &) = delete;
+    FileWriter &operator=(const FileWriter &) = delete;
+
+    /**
+     * @brief Tells whether the file was opened.
+     * @return True if it was.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Writes what is left, waits for every write and closes the file.
+     * @return False if the file could not be opened or a write failed.
+     */
+    bool close();
+};
+
+#endif // FILEIO_H
@@ -0,0 +1,146 @@
+#include "FileWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <sys/inotify.h>
+#include <unistd.h>
+using namespace std;
+
+FileWatcher::FileWatcher() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+FileWatcher::~FileWatcher()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool FileWatcher::split(const string &filename, string &directory, string &name)
+{
+    filesystem::path path(filename);
+    error_code error;
+    // only the directory is resolved : the name stays as given, since a file renamed over it is reported under that name
+    filesystem::path real = filesystem::canonical(path.has_parent_path() ? path.parent_path() : filesystem::path("."), error);
+    if (error)
+    {
+        return false;
+    }
+    directory = real.string();
+    name = path.filename().string();
+    return true;
+}
+
+bool FileWatcher::add(const string &filename)
+{
+    string directory, name;
+    if (fd < 0 || !split(filename, directory, name))
+    {
+        return false;
+    }
+    // IN_CLOSE_WRITE : the file was written in place, IN_MOVED_TO : another file was renamed over it
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        return false;
+    }
+    ++directories[wd].files[name][filename]; // watching the same directory again gives back the same wd
+    return true;
+}
+
+void FileWatcher::remove(const string &filename)
+{
+    string directory, name;
+    if (fd < 0 || !split(filename, directory, name))
+    {
+        return;
+    }
+    for (auto dir = directories.begin(); dir != directories.end(); ++dir)
+    {
+        auto file = dir->second.files.find(name);
+        if (file == dir->second.files.end())
+        {
+            continue;
+        }
+        auto given = file->second.find(filename);
+        if (given == file->second.end())
+        {
+            continue;
+        }
+        if (--given->second == 0)
+        {
+            file->second.erase(given);
+            if (file->second.empty())
+            {
+                dir->second.files.erase(file);
+            }
+            if (dir->second.files.empty())
+            {
+                inotify_rm_watch(fd, dir->first);
+                directories.erase(dir);
+            }
+        }
+        return;
+    }
+}
+
+vector<string> FileWatcher::changedFiles()
+{
+    vector<string> changed;
+    if (fd < 0)
+    {
+        return changed;
+    }
+    // a file written several times is reloaded once
+    auto report = [&changed](const unordered_map<string, size_t> &spellings)
+    {
+        for (const auto &given : spellings) // every spelling the file was added under
+        {
+            if (find(changed.begin(), changed.end(), given.first) == changed.end())
+            {
+                changed.push_back(given.first);
+            }
+        }
+    };
+    bool overflowed = false;
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) // EAGAIN : no more events for now
+        {
+            break;
+        }
+        for (char *p = buffer; p < buffer + n;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) // wd is -1 : events were dropped, so any file may have changed
+            {
+                overflowed = true;
+                continue;
+            }
+            auto dir = directories.find(event->wd);
+            if (dir == directories.end() || event->len == 0)
+            {
+                continue;
+            }
+            auto file = dir->second.files.find(event->name);
+            if (file != dir->second.files.end())
+            {
+                report(file->second);
+            }
+        }
+    }
+    if (overflowed)
+    {
+        for (const auto &dir : directories)
+        {
+            for (const auto &file : dir.second.files)
+            {
+                report(file.second);
+            }
+        }
+    }
+    return changed;
+}
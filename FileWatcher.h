@@ -0,0 +1,80 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class FileWatcher
+ * @brief Tells which files were rewritten, using Linux inotify.
+ *
+ * The directory of each file is watched rather than the file itself, so files that are
+ * replaced by renaming a new file over them (as most generators do) keep being watched.
+ * Checking for changes never blocks.
+ *
+ * inotify gives the same watch for every spelling of a directory ("x", "./x", "/home/me/x"),
+ * so files are kept per watch, by their name in the directory: a file added under any
+ * spelling is found from the events of that watch.
+ */
+class FileWatcher
+{
+private:
+    /**
+     * @brief The files watched in one directory.
+     */
+    struct Directory
+    {
+        /// Name in the directory -> (filename as given to add -> number of adds not removed yet).
+        std::unordered_map<std::string, std::unordered_map<std::string, size_t>> files;
+    };
+
+    int fd = -1;                                  ///< The inotify descriptor, or -1 if inotify is not available.
+    std::unordered_map<int, Directory> directories; ///< Watch descriptor -> the files watched through it.
+
+    /**
+     * @brief Splits a filename into the real path of its directory (symbolic links and ".." resolved) and its name.
+     * @param filename The file.
+     * @param directory Receives the directory.
+     * @param name Receives the name of the file in it.
+     * @return False if the directory does not exist.
+     */
+    static bool split(const std::string &filename, std::string &directory, std::string &name);
+
+public:
+    /**
+     * @brief Opens an inotify instance.
+     */
+    FileWatcher();
+
+    /**
+     * @brief Closes the inotify instance (and every watch with it).
+     */
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    /**
+     * @brief Starts watching a file (adding it again, under any spelling, is counted).
+     * @param filename The file to watch.
+     * @return False if the file's directory cannot be watched.
+     */
+    bool add(const std::string &filename);
+
+    /**
+     * @brief Stops watching a file (once per add); the directory is let go once none of its files is watched.
+     * @param filename The file, as given to add.
+     */
+    void remove(const std::string &filename);
+
+    /**
+     * @brief Returns the watched files written or replaced since the last call, each once.
+     *
+     * If the kernel's event queue overflowed, events were lost, so every watched file is returned.
+     * @return The changed files, as given to add.
+     */
+    std::vector<std::string> changedFiles();
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,222 @@
+#include "FrontCodedList.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+using namespace std;
+
+// numbers are stored as varints : 7 bits per byte, the high bit says "more bytes follow"
+// most prefix and suffix lengths are < 128 so they only take one byte
+static void putVarint(string &out, size_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static size_t getVarint(const string &in, size_t &pos)
+{
+    size_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do
+    {
+        byte = static_cast<unsigned char>(in[pos++]);
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+bool FrontCodedList::less(string_view a, string_view b)
+{
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) // compare ignoring case first, the same order show_sorted uses
+    {
+        int ca = tolower(static_cast<unsigned char>(a[i]));
+        int cb = tolower(static_cast<unsigned char>(b[i]));
+        if (ca != cb)
+        {
+            return ca < cb;
+        }
+    }
+    if (a.size() != b.size())
+    {
+        return a.size() < b.size();
+    }
+    return a < b; // same letters, different case : fall back to the raw bytes so the order is total
+}
+
+FrontCodedList::FrontCodedList(vector<string> words) : count(words.size())
+{
+    sort(words.begin(), words.end(), less);
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        const string &word = words[i];
+        if (i % BLOCK_SIZE == 0) // first word of a block : store it in full
+        {
+            blockOffsets.push_back(static_cast<uint32_t>(data.size()));
+            putVarint(data, word.size());
+            data += word;
+        }
+        else // other words : store the length of the prefix shared with the previous word, then the rest
+        {
+            const string &previous = words[i - 1];
+            size_t shared = 0;
+            while (shared < word.size() && shared < previous.size() && word[shared] == previous[shared])
+            {
+                ++shared;
+            }
+            putVarint(data, shared);
+            putVarint(data, word.size() - shared);
+            data.append(word, shared, string::npos);
+        }
+    }
+    data.shrink_to_fit();
+    blockOffsets.shrink_to_fit();
+}
+
+string FrontCodedList::blockHead(size_t block) const
+{
+    size_t pos = blockOffsets[block];
+    size_t length = getVarint(data, pos);
+    return data.substr(pos, length);
+}
+
+bool FrontCodedList::decodeBlock(size_t block, const function<bool(const string &)> &visit) const
+{
+    size_t pos = blockOffsets[block];
+    size_t words = min(BLOCK_SIZE, count - block * BLOCK_SIZE);
+    string current; // rebuilt in place : keep the shared prefix, append the new suffix
+    for (size_t i = 0; i < words; ++i)
+    {
+        size_t shared = (i == 0) ? 0 : getVarint(data, pos);
+        size_t suffix = getVarint(data, pos);
+        current.resize(shared);
+        current.append(data, pos, suffix);
+        pos += suffix;
+        if (!visit(current))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t FrontCodedList::size() const { return count; }
+
+bool FrontCodedList::isEmpty() const { return count == 0; }
+
+bool FrontCodedList::lookup(const string &word) const
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    // binary search for the last block whose first word is <= word, only that block can contain it
+    size_t lo = 0, hi = blockOffsets.size();
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (less(word, blockHead(mid)))
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid;
+        }
+    }
+    bool found = false;
+    decodeBlock(lo, [&](const string &w)
+                {
+        if (w == word)
+        {
+            found = true;
+        }
+        return !found && !less(word, w); }); // stop as soon as we found it or went past it
+    return found;
+}
+
+string FrontCodedList::at(size_t n) const
+{
+    if (n >= count)
+    {
+        throw out_of_range("FrontCodedList::at: position " + to_string(n) + " out of range");
+    }
+    string result;
+    size_t wanted = n % BLOCK_SIZE, i = 0;
+    decodeBlock(n / BLOCK_SIZE, [&](const string &w)
+                {
+        if (i++ == wanted)
+        {
+            result = w;
+            return false;
+        }
+        return true; });
+    return result;
+}
+
+void FrontCodedList::forEach(const function<void(const string &)> &visit) const
+{
+    for (size_t block = 0; block < blockOffsets.size(); ++block)
+    {
+        decodeBlock(block, [&](const string &w)
+                    {
+            visit(w);
+            return true; });
+    }
+}
+
+vector<string> FrontCodedList::toVector() const
+{
+    vector<string> words;
+    words.reserve(count);
+    forEach([&](const string &w)
+            { words.push_back(w); });
+    return words;
+}
+
+void FrontCodedList::write(ostream &sout, int n) const
+{
+    int written = 0;
+    forEach([&](const string &w)
+            {
+        sout << w << ' ';
+        if (++written % n == 0)
+        {
+            sout << '\n';
+        } });
+}
+
+size_t FrontCodedList::memoryUsage() const
+{
+    return sizeof(*this) + data.capacity() + blockOffsets.capacity() * sizeof(uint32_t);
+}
+
+MemoryUsage FrontCodedList::memoryBreakdown() const
+{
+    MemoryUsage usage;
+    usage.words = count;
+    usage.payloadBytes = data.size();
+    usage.overheadBytes = sizeof(*this) + blockOffsets.size() * sizeof(uint32_t);
+    usage.slackBytes = (data.capacity() - data.size()) + (blockOffsets.capacity() - blockOffsets.size()) * sizeof(uint32_t);
+    return usage;
+}
+
+void FrontCodedList::shrinkToFit()
+{
+    data.shrink_to_fit();
+    blockOffsets.shrink_to_fit();
+}
+
+void FrontCodedList::clear()
+{
+    data.clear();
+    data.shrink_to_fit();
+    blockOffsets.clear();
+    blockOffsets.shrink_to_fit();
+    count = 0;
+}
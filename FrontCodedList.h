@@ -0,0 +1,133 @@
+#ifndef FRONTCODEDLIST_H
+#define FRONTCODEDLIST_H
+
+#include "MemoryUsage.h"
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class FrontCodedList
+ * @brief A compact, read-only, sorted list of words stored with front coding.
+ *
+ * Words are sorted (case-insensitively, ties broken by the raw bytes) and cut into
+ * blocks of BLOCK_SIZE words. The first word of a block is stored in full, every
+ * other word only stores how many leading characters it shares with the previous
+ * word and the remaining suffix. A small index of block offsets allows a binary
+ * search over the block heads, so lookups stay logarithmic.
+ */
+class FrontCodedList
+{
+private:
+    static constexpr size_t BLOCK_SIZE = 16; ///< Number of words per block (one full word + 15 front-coded ones).
+
+    std::string data;                    ///< The encoded blocks, one after the other.
+    std::vector<uint32_t> blockOffsets;  ///< Byte offset in data where each block starts (the sampled index).
+    size_t count = 0;                    ///< Number of words stored.
+
+    /**
+     * @brief Decodes the full first word of a block.
+     * @param block The index of the block.
+     * @return The first word of the block.
+     */
+    std::string blockHead(size_t block) const;
+
+    /**
+     * @brief Calls visit for every word of one block, in order.
+     * @param block The index of the block.
+     * @param visit Called with each decoded word; returning false stops early.
+     * @return False if visit stopped early, true otherwise.
+     */
+    bool decodeBlock(size_t block, const std::function<bool(const std::string &)> &visit) const;
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty list.
+     */
+    FrontCodedList() = default;
+
+    /**
+     * @brief Builds the compressed form of a set of words.
+     * @param words The words to store, in any order (duplicates are kept).
+     */
+    explicit FrontCodedList(std::vector<std::string> words);
+
+    /**
+     * @brief The order the words are stored in: case-insensitive, ties broken by the raw bytes.
+     * @return True if a comes before b.
+     */
+    static bool less(std::string_view a, std::string_view b);
+
+    /**
+     * @brief Returns the number of words stored.
+     * @return The number of words stored.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns true if no words are stored.
+     * @return True if no words are stored.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Returns true if a word is stored, using a binary search over the block heads.
+     * @param word The word to look for.
+     * @return True if the word is stored, false otherwise.
+     */
+    bool lookup(const std::string &word) const;
+
+    /**
+     * @brief Returns the word at a position in sorted order (decodes at most one block).
+     * @param n The position of the word.
+     * @return The word at that position.
+     * @throws std::out_of_range if n is not a valid position.
+     */
+    std::string at(size_t n) const;
+
+    /**
+     * @brief Calls visit for every word, in sorted order, decoding on the fly.
+     * @param visit Called with each word.
+     */
+    void forEach(const std::function<void(const std::string &)> &visit) const;
+
+    /**
+     * @brief Decodes every word, in sorted order.
+     * @return The stored words.
+     */
+    std::vector<std::string> toVector() const;
+
+    /**
+     * @brief Writes the words in sorted order, with a specified number of words per line.
+     * @param sout The output stream to write to.
+     * @param n The number of words per line.
+     */
+    void write(std::ostream &sout, int n = 5) const;
+
+    /**
+     * @brief Returns the number of bytes used by the compressed form.
+     * @return The number of bytes used.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Returns where the bytes go: encoded blocks, block index and unused capacity.
+     * @return The memory used by the compressed form.
+     */
+    MemoryUsage memoryBreakdown() const;
+
+    /**
+     * @brief Releases the unused capacity of the encoded blocks and the block index.
+     */
+    void shrinkToFit();
+
+    /**
+     * @brief Removes every word.
+     */
+    void clear();
+};
+
+#endif // FRONTCODEDLIST_H
@@ -0,0 +1,543 @@
+#include "FrozenDictionary.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const char MAGIC[8] = {'W', 'C', 'F', 'R', 'O', 'Z', '0', '1'};
+static const uint32_t DIRECT = 0x80000000u;   // a seed with this bit set is the slot itself (buckets of one key)
+static const uint32_t MAX_TRIES = 1u << 22;   // seeds tried for one bucket before starting over with another salt
+static const size_t KEYS_PER_BUCKET = 4;
+
+// FNV-1a, then a splitmix finalizer so that every bit depends on every character
+static uint64_t hashKey(string_view key, uint64_t salt)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ salt;
+    for (unsigned char c : key)
+    {
+        h = (h ^ c) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+static uint64_t bucketOf(uint64_t h, uint64_t buckets) { return (h >> 32) % buckets; }
+
+static uint64_t seededSlot(uint64_t h, uint32_t seed, uint64_t slots)
+{
+    uint64_t x = h ^ (seed * 0x9e3779b97f4a7c15ULL);
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 29;
+    return x % slots;
+}
+
+// hash and displace : biggest buckets first, find for each one a seed sending its keys to free slots;
+// buckets of one key (the last ones, when few slots are free) simply take the next free slot
+static bool buildPerfectHash(const vector<uint64_t> &hashes, uint64_t buckets, vector<uint32_t> &seeds, vector<uint64_t> &slotOfKey)
+{
+    const uint64_t n = hashes.size();
+    vector<vector<uint32_t>> members(buckets);
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        members[bucketOf(hashes[k], buckets)].push_back(k);
+    }
+    vector<uint32_t> order(buckets);
+    for (uint32_t b = 0; b < buckets; ++b)
+    {
+        order[b] = b;
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                { return members[a].size() > members[b].size(); });
+
+    seeds.assign(buckets, 0);
+    slotOfKey.assign(n, 0);
+    vector<bool> taken(n, false);
+    uint64_t nextFree = 0;
+    vector<uint64_t> slots;
+    for (uint32_t b : order)
+    {
+        const auto &keys = members[b];
+        if (keys.empty())
+        {
+            break; // sorted by size : the rest are empty too
+        }
+        if (keys.size() == 1)
+        {
+            while (taken[nextFree])
+                ++nextFree;
+            taken[nextFree] = true;
+            seeds[b] = DIRECT | static_cast<uint32_t>(nextFree);
+            slotOfKey[keys[0]] = nextFree;
+            continue;
+        }
+        uint32_t seed = 0;
+        for (; seed < MAX_TRIES; ++seed)
+        {
+            slots.clear();
+            bool ok = true;
+            for (uint32_t k : keys)
+            {
+                uint64_t slot = seededSlot(hashes[k], seed, n);
+                if (taken[slot] || find(slots.begin(), slots.end(), slot) != slots.end())
+                {
+                    ok = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (ok)
+                break;
+        }
+        if (seed == MAX_TRIES)
+        {
+            return false;
+        }
+        seeds[b] = seed;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            taken[slots[i]] = true;
+            slotOfKey[keys[i]] = slots[i];
+        }
+    }
+    return true;
+}
+
+template <typename T>
+const T *FrozenDictionary::section(Section s) const
+{
+    return reinterpret_cast<const T *>(reinterpret_cast<const char *>(header) + header->sections[s]);
+}
+
+FrozenDictionary::FrozenDictionary(const vector<string> &categoryNames, const vector<const vector<string> *> &categoryWords)
+{
+    // the distinct words of all categories, by first appearance
+    vector<string_view> words;
+    unordered_map<string_view, uint32_t> idOf;
+    for (const auto *run : categoryWords)
+    {
+        for (const auto &word : *run)
+        {
+            if (idOf.emplace(word, static_cast<uint32_t>(words.size())).second)
+            {
+                words.push_back(word);
+            }
+        }
+    }
+    vector<string_view> names;
+    vector<uint32_t> firstCategoryOf;
+    unordered_set<string_view> seenName;
+    for (uint32_t c = 0; c < categoryNames.size(); ++c)
+    {
+        if (seenName.insert(categoryNames[c]).second)
+        {
+            names.push_back(categoryNames[c]);
+            firstCategoryOf.push_back(c);
+        }
+    }
+
+    // find a salt for which both perfect hashes build (almost always the first one)
+    uint64_t wordBuckets = words.size() / KEYS_PER_BUCKET + 1, nameBuckets = names.size() / KEYS_PER_BUCKET + 1;
+    vector<uint32_t> wordSeeds, nameSeeds;
+    vector<uint64_t> wordSlot, nameSlot;
+    uint64_t salt = 0;
+    for (;; ++salt)
+    {
+        if (salt == 16)
+        {
+            throw runtime_error("FrozenDictionary: no perfect hash found");
+        }
+        vector<uint64_t> hashes(words.size());
+        for (size_t i = 0; i < words.size(); ++i)
+            hashes[i] = hashKey(words[i], salt);
+        if (!buildPerfectHash(hashes, wordBuckets, wordSeeds, wordSlot))
+            continue;
+        hashes.resize(names.size());
+        for (size_t i = 0; i < names.size(); ++i)
+            hashes[i] = hashKey(names[i], salt);
+        if (buildPerfectHash(hashes, nameBuckets, nameSeeds, nameSlot))
+            break;
+    }
+
+    const uint64_t n = words.size(), categories = categoryNames.size();
+    size_t wordBytes = 0, nameBytes = 0, members = 0;
+    for (auto word : words)
+        wordBytes += word.size();
+    for (const auto &name : categoryNames)
+        nameBytes += name.size();
+    for (const auto *run : categoryWords)
+        members += run->size();
+    Header head{};
+    memcpy(head.magic, MAGIC, sizeof(MAGIC));
+    head.salt = salt;
+    head.words = n;
+    head.categories = categories;
+    head.wordBuckets = wordBuckets;
+    head.nameBuckets = nameBuckets;
+    head.names = names.size();
+    head.memberWords = (categories + 63) / 64;
+    layout(head, wordBytes, nameBytes, members);
+    const uint64_t memberWords = head.memberWords, offset = head.size;
+
+    owned.assign(offset / 8, 0);
+    char *base = reinterpret_cast<char *>(owned.data());
+    memcpy(base, &head, sizeof(head));
+    auto at = [&](Section s)
+    { return base + head.sections[s]; };
+
+    memcpy(at(WordSeeds), wordSeeds.data(), wordSeeds.size() * sizeof(uint32_t));
+    vector<string_view> bySlot(n);
+    for (size_t i = 0; i < n; ++i)
+        bySlot[wordSlot[i]] = words[i];
+    uint64_t *wordOffsets = reinterpret_cast<uint64_t *>(at(WordOffsets));
+    char *chars = at(WordChars);
+    uint64_t pos = 0;
+    for (uint64_t slot = 0; slot < n; ++slot)
+    {
+        wordOffsets[slot] = pos;
+        memcpy(chars + pos, bySlot[slot].data(), bySlot[slot].size());
+        pos += bySlot[slot].size();
+    }
+    wordOffsets[n] = pos;
+
+    uint64_t *bitmap = reinterpret_cast<uint64_t *>(at(Members));
+    uint64_t *starts = reinterpret_cast<uint64_t *>(at(CategoryStarts));
+    uint32_t *catWords = reinterpret_cast<uint32_t *>(at(CategoryWords));
+    pos = 0;
+    for (uint64_t c = 0; c < categories; ++c)
+    {
+        starts[c] = pos;
+        for (const auto &word : *categoryWords[c]) // sorted already, so each category's slots come out in word order
+        {
+            uint64_t slot = wordSlot[idOf[word]];
+            bitmap[slot * memberWords + c / 64] |= 1ULL << (c % 64);
+            catWords[pos++] = static_cast<uint32_t>(slot);
+        }
+    }
+    starts[categories] = pos;
+
+    memcpy(at(NameSeeds), nameSeeds.data(), nameSeeds.size() * sizeof(uint32_t));
+    uint32_t *nameSlots = reinterpret_cast<uint32_t *>(at(NameSlots));
+    for (size_t i = 0; i < names.size(); ++i)
+        nameSlots[nameSlot[i]] = firstCategoryOf[i];
+    uint64_t *nameOffsets = reinterpret_cast<uint64_t *>(at(NameOffsets));
+    chars = at(NameChars);
+    pos = 0;
+    for (uint64_t c = 0; c < categories; ++c)
+    {
+        nameOffsets[c] = pos;
+        memcpy(chars + pos, categoryNames[c].data(), categoryNames[c].size());
+        pos += categoryNames[c].size();
+    }
+    nameOffsets[categories] = pos;
+    header = reinterpret_cast<const Header *>(base);
+}
+
+void FrozenDictionary::layout(Header &head, uint64_t wordBytes, uint64_t nameBytes, uint64_t members)
+{
+    uint64_t sizes[SectionCount] = {
+        head.wordBuckets * sizeof(uint32_t),
+        (head.words + 1) * sizeof(uint64_t),
+        wordBytes,
+        head.words * head.memberWords * sizeof(uint64_t),
+        head.nameBuckets * sizeof(uint32_t),
+        head.names * sizeof(uint32_t),
+        (head.categories + 1) * sizeof(uint64_t),
+        nameBytes,
+        (head.categories + 1) * sizeof(uint64_t),
+        members * sizeof(uint32_t)};
+    uint64_t offset = (sizeof(Header) + 7) / 8 * 8;
+    for (int s = 0; s < SectionCount; ++s)
+    {
+        head.sections[s] = offset;
+        offset += (sizes[s] + 7) / 8 * 8;
+    }
+    head.size = offset;
+}
+
+FrozenDictionary::FrozenDictionary(FrozenDictionary &&other) noexcept { *this = move(other); }
+
+FrozenDictionary &FrozenDictionary::operator=(FrozenDictionary &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        owned = move(other.owned); // the vector's buffer moves with it, so header stays valid
+        mapped = other.mapped;
+        mappedSize = other.mappedSize;
+        header = other.header;
+        other.mapped = nullptr;
+        other.mappedSize = 0;
+        other.header = nullptr;
+    }
+    return *this;
+}
+
+FrozenDictionary::~FrozenDictionary() { close(); }
+
+void FrozenDictionary::close()
+{
+    if (mapped)
+    {
+        munmap(mapped, mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+    vector<uint64_t>().swap(owned);
+    header = nullptr;
+}
+
+bool FrozenDictionary::save(const string &filename) const
+{
+    ofstream outFile(filename, ios::binary | ios::trunc);
+    if (!outFile)
+    {
+        cerr << "Error opening file for writing: " << filename << '\n';
+        return false;
+    }
+    if (header)
+    {
+        outFile.write(reinterpret_cast<const char *>(header), static_cast<streamsize>(header->size));
+    }
+    return static_cast<bool>(outFile);
+}
+
+bool FrozenDictionary::open(const string &filename, FrozenDictionary &dictionary)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+    {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (p == MAP_FAILED)
+    {
+        return false;
+    }
+    const Header *head = static_cast<const Header *>(p);
+    const char *base = static_cast<const char *>(p);
+    // the counts first : each one is bounded by the size, so the sizes computed from them cannot overflow
+    bool valid = memcmp(head->magic, MAGIC, sizeof(MAGIC)) == 0 && head->size == size &&
+                 head->words <= size / 8 && head->categories <= size / 8 && head->names <= head->categories &&
+                 head->wordBuckets == head->words / KEYS_PER_BUCKET + 1 && head->nameBuckets == head->names / KEYS_PER_BUCKET + 1 &&
+                 head->memberWords == (head->categories + 63) / 64 &&
+                 (head->words == 0 || head->memberWords <= size / 8 / head->words);
+    // then the three totals the section sizes depend on, read from the last entry of their offset tables...
+    uint64_t totals[3] = {0, 0, 0};
+    const Section tables[3] = {WordOffsets, NameOffsets, CategoryStarts};
+    const uint64_t entries[3] = {head->words, head->categories, head->categories};
+    for (int t = 0; t < 3 && valid; ++t)
+    {
+        uint64_t at = head->sections[tables[t]];
+        valid = at % 8 == 0 && at <= size && (entries[t] + 1) * sizeof(uint64_t) <= size - at;
+        if (valid)
+        {
+            memcpy(&totals[t], base + at + entries[t] * sizeof(uint64_t), sizeof(uint64_t));
+            valid = totals[t] <= size;
+        }
+    }
+    // ...and every section must be exactly where the builder would have put it
+    if (valid)
+    {
+        Header expected = *head;
+        layout(expected, totals[0], totals[1], totals[2]);
+        valid = expected.size == size && memcmp(expected.sections, head->sections, sizeof(expected.sections)) == 0;
+    }
+    if (!valid)
+    {
+        munmap(p, size);
+        return false;
+    }
+    dictionary.close();
+    dictionary.mapped = p;
+    dictionary.mappedSize = size;
+    dictionary.header = head;
+    return true;
+}
+
+uint64_t FrozenDictionary::slotOf(string_view key, const uint32_t *seeds, uint64_t buckets, uint64_t slots) const
+{
+    uint64_t h = hashKey(key, header->salt);
+    uint32_t seed = seeds[bucketOf(h, buckets)];
+    if (!(seed & DIRECT))
+    {
+        return seededSlot(h, seed, slots);
+    }
+    uint64_t slot = seed & ~DIRECT;
+    return slot < slots ? slot : NOT_FOUND;
+}
+
+string_view FrozenDictionary::wordAt(uint64_t slot) const
+{
+    const uint64_t *offsets = section<uint64_t>(WordOffsets);
+    if (offsets[slot] > offsets[slot + 1] || offsets[slot + 1] > offsets[header->words]) // open() checked the last one against the section
+    {
+        return string_view();
+    }
+    return string_view(section<char>(WordChars) + offsets[slot], offsets[slot + 1] - offsets[slot]);
+}
+
+bool FrozenDictionary::findWordSlot(string_view word, uint64_t &slot) const
+{
+    if (!header || header->words == 0)
+    {
+        return false;
+    }
+    slot = slotOf(word, section<uint32_t>(WordSeeds), header->wordBuckets, header->words);
+    return slot != NOT_FOUND && wordAt(slot) == word; // the hash sends any string somewhere : one comparison tells if it is really there
+}
+
+bool FrozenDictionary::contains(string_view word) const
+{
+    uint64_t slot;
+    return findWordSlot(word, slot);
+}
+
+bool FrozenDictionary::contains(string_view word, size_t category) const
+{
+    uint64_t slot;
+    if (category >= categoryCount() || !findWordSlot(word, slot))
+    {
+        return false;
+    }
+    const uint64_t *row = section<uint64_t>(Members) + slot * header->memberWords;
+    return (row[category / 64] >> (category % 64)) & 1;
+}
+
+vector<size_t> FrozenDictionary::categoriesOf(string_view word) const
+{
+    uint64_t slot;
+    if (!findWordSlot(word, slot))
+    {
+        return vector<size_t>();
+    }
+    return categoriesOfSlot(slot);
+}
+
+void FrozenDictionary::findSlots(const string_view *words, size_t count, uint64_t *slots) const
+{
+    if (!header || header->words == 0)
+    {
+        fill(slots, slots + count, NOT_FOUND);
+        return;
+    }
+    const uint32_t *seeds = section<uint32_t>(WordSeeds);
+    const uint64_t *offsets = section<uint64_t>(WordOffsets);
+    // 1. hash every word and ask for its bucket's seed (slots holds the hashes meanwhile)
+    for (size_t i = 0; i < count; ++i)
+    {
+        slots[i] = hashKey(words[i], header->salt);
+        __builtin_prefetch(&seeds[bucketOf(slots[i], header->wordBuckets)]);
+    }
+    // 2. the seeds have arrived by now : compute the slots and ask for where their words are
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t seed = seeds[bucketOf(slots[i], header->wordBuckets)];
+        slots[i] = (seed & DIRECT) ? (seed & ~DIRECT) : seededSlot(slots[i], seed, header->words);
+        if (slots[i] >= header->words) // a seed past the last slot, in a damaged file
+        {
+            slots[i] = NOT_FOUND;
+            continue;
+        }
+        __builtin_prefetch(&offsets[slots[i]]);
+    }
+    // 3. ask for the characters of each candidate...
+    const char *chars = section<char>(WordChars);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (slots[i] != NOT_FOUND)
+        {
+            __builtin_prefetch(chars + offsets[slots[i]]);
+        }
+    }
+    // 4. ...and compare them with the words
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (slots[i] != NOT_FOUND && wordAt(slots[i]) != words[i])
+        {
+            slots[i] = NOT_FOUND;
+        }
+    }
+}
+
+vector<size_t> FrozenDictionary::categoriesOfSlot(uint64_t slot) const
+{
+    vector<size_t> found;
+    const uint64_t *row = section<uint64_t>(Members) + slot * header->memberWords;
+    for (uint64_t w = 0; w < header->memberWords; ++w)
+    {
+        for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1) // one step per set bit
+        {
+            found.push_back(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+        }
+    }
+    return found;
+}
+
+bool FrozenDictionary::findCategory(string_view name, size_t &category) const
+{
+    if (!header || header->names == 0)
+    {
+        return false;
+    }
+    uint64_t slot = slotOf(name, section<uint32_t>(NameSeeds), header->nameBuckets, header->names);
+    if (slot == NOT_FOUND)
+    {
+        return false;
+    }
+    category = section<uint32_t>(NameSlots)[slot];
+    return category < header->categories && categoryName(category) == name;
+}
+
+string_view FrozenDictionary::categoryName(size_t category) const
+{
+    const uint64_t *offsets = section<uint64_t>(NameOffsets);
+    if (offsets[category] > offsets[category + 1] || offsets[category + 1] > offsets[header->categories])
+    {
+        return string_view();
+    }
+    return string_view(section<char>(NameChars) + offsets[category], offsets[category + 1] - offsets[category]);
+}
+
+void FrozenDictionary::forEachWord(size_t category, const function<void(string_view)> &visit) const
+{
+    if (category >= categoryCount())
+    {
+        return;
+    }
+    const uint64_t *starts = section<uint64_t>(CategoryStarts);
+    const uint32_t *slots = section<uint32_t>(CategoryWords);
+    uint64_t end = min(starts[category + 1], starts[header->categories]);
+    for (uint64_t i = starts[category]; i < end; ++i)
+    {
+        if (slots[i] < header->words) // a damaged file may point anywhere
+        {
+            visit(wordAt(slots[i]));
+        }
+    }
+}
+
+size_t FrozenDictionary::wordCount() const { return header ? header->words : 0; }
+
+size_t FrozenDictionary::categoryCount() const { return header ? header->categories : 0; }
+
+size_t FrozenDictionary::byteSize() const { return header ? header->size : 0; }
@@ -0,0 +1,231 @@
+#ifndef FROZENDICTIONARY_H
+#define FROZENDICTIONARY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class FrozenDictionary
+ * @brief A read-only snapshot of categories, answering lookups in O(1) without probing.
+ *
+ * Every distinct word and every category name gets a slot from a minimal perfect hash
+ * (hash and displace: words are hashed into small buckets and each bucket stores the seed
+ * that sends all its words to free slots). A lookup hashes the word once, reads its bucket's
+ * seed, computes the slot and compares one string.
+ *
+ * Everything lives in one contiguous buffer of fixed-layout sections (the characters of all
+ * words, their offsets, a word x category membership bitmap, ...), so the same bytes are
+ * written to a file and used in place when the file is mapped back with open().
+ */
+class FrozenDictionary
+{
+public:
+    static constexpr uint64_t NOT_FOUND = ~0ULL; ///< The slot findSlots gives words that are not in the dictionary.
+
+private:
+    /**
+     * @brief The sections of the buffer, in order.
+     */
+    enum Section
+    {
+        WordSeeds,      ///< uint32 per word bucket: the seed of the bucket (or a slot, high bit set).
+        WordOffsets,    ///< uint64 per word slot, plus one: where each word starts in WordChars.
+        WordChars,      ///< The characters of every word, in slot order.
+        Members,        ///< uint64 bitmap per word slot: bit c set if the word is in category c.
+        NameSeeds,      ///< Same as WordSeeds, for category names.
+        NameSlots,      ///< uint32 per name slot: the first category with that name.
+        NameOffsets,    ///< uint64 per category, plus one: where each name starts in NameChars.
+        NameChars,      ///< The characters of every category name, in category order.
+        CategoryStarts, ///< uint64 per category, plus one: where its words start in CategoryWords.
+        CategoryWords,  ///< uint32 word slots of each category, sorted by word.
+        SectionCount
+    };
+
+    /**
+     * @brief The start of the buffer, describing the rest.
+     */
+    struct Header
+    {
+        char magic[8];                    ///< "WCFROZ01".
+        uint64_t size;                    ///< Size of the whole buffer in bytes.
+        uint64_t salt;                    ///< Mixed into every hash; changed until the perfect hash builds.
+        uint64_t words;                   ///< Number of distinct words.
+        uint64_t categories;              ///< Number of categories.
+        uint64_t wordBuckets;             ///< Number of buckets of the word hash.
+        uint64_t nameBuckets;             ///< Number of buckets of the name hash.
+        uint64_t names;                   ///< Number of distinct category names.
+        uint64_t memberWords;             ///< uint64 per word in the membership bitmap.
+        uint64_t sections[SectionCount];  ///< Byte offset of each section.
+    };
+
+    std::vector<uint64_t> owned;      ///< The buffer, when built in memory (uint64 for alignment).
+    void *mapped = nullptr;           ///< The buffer, when mapped from a file.
+    size_t mappedSize = 0;
+    const Header *header = nullptr;   ///< Points at the start of the buffer, or nullptr when empty.
+
+    template <typename T>
+    const T *section(Section s) const;
+
+    /**
+     * @brief Lays the sections out one after the other, each aligned on 8 bytes.
+     * Used to build a dictionary, and to check that a mapped file is laid out as it would have been built.
+     * @param head The header, with its counts filled in; receives the offset of each section and the size.
+     * @param wordBytes The number of characters of all words.
+     * @param nameBytes The number of characters of all category names.
+     * @param members The number of (category, word) pairs.
+     */
+    static void layout(Header &head, uint64_t wordBytes, uint64_t nameBytes, uint64_t members);
+
+    /**
+     * @brief Finds the slot of a key in one of the two perfect hashes.
+     * @param key The key.
+     * @param seeds The bucket seeds.
+     * @param buckets The number of buckets.
+     * @param slots The number of keys.
+     * @return The only slot the key can be in (the caller checks it is really there),
+     * or NOT_FOUND if the seed of its bucket points past the last slot (a damaged file).
+     */
+    uint64_t slotOf(std::string_view key, const uint32_t *seeds, uint64_t buckets, uint64_t slots) const;
+
+    /**
+     * @brief Returns the word in a slot.
+     * @param slot The slot.
+     * @return The word (empty if its offsets are out of order, in a damaged file).
+     */
+    std::string_view wordAt(uint64_t slot) const;
+
+    /**
+     * @brief Finds the slot of a word.
+     * @param word The word.
+     * @param slot Receives the slot.
+     * @return False if the word is not in the dictionary.
+     */
+    bool findWordSlot(std::string_view word, uint64_t &slot) const;
+
+    /**
+     * @brief Releases the buffer.
+     */
+    void close();
+
+public:
+    /**
+     * @brief Creates an empty dictionary.
+     */
+    FrozenDictionary() = default;
+
+    /**
+     * @brief Builds a dictionary.
+     * @param categoryNames The category names, in order.
+     * @param categoryWords The words of each category, sorted with no duplicates.
+     * @throws std::runtime_error if no perfect hash could be found (which does not happen in practice).
+     */
+    FrozenDictionary(const std::vector<std::string> &categoryNames, const std::vector<const std::vector<std::string> *> &categoryWords);
+
+    FrozenDictionary(const FrozenDictionary &) = delete;
+    FrozenDictionary &operator=(const FrozenDictionary &) = delete;
+    FrozenDictionary(FrozenDictionary &&other) noexcept;
+    FrozenDictionary &operator=(FrozenDictionary &&other) noexcept;
+
+    /**
+     * @brief Unmaps or frees the buffer.
+     */
+    ~FrozenDictionary();
+
+    /**
+     * @brief Writes the buffer to a file, as is.
+     * @param filename The file to write.
+     * @return False if the file cannot be written.
+     */
+    bool save(const std::string &filename) const;
+
+    /**
+     * @brief Maps a file written by save. Nothing is read or parsed until it is used.
+     * @param filename The file to map.
+     * @param dictionary Receives the dictionary.
+     * @return False if the file cannot be mapped or is not a frozen dictionary.
+     */
+    static bool open(const std::string &filename, FrozenDictionary &dictionary);
+
+    /**
+     * @brief Tells whether a word is in any category.
+     * @param word The word.
+     * @return True if the word is in the dictionary.
+     */
+    bool contains(std::string_view word) const;
+
+    /**
+     * @brief Tells whether a word is in a category.
+     * @param word The word.
+     * @param category The index of the category.
+     * @return True if the word is in the category.
+     */
+    bool contains(std::string_view word, size_t category) const;
+
+    /**
+     * @brief Returns the indexes of the categories containing a word.
+     * @param word The word.
+     * @return The category indexes, in order.
+     */
+    std::vector<size_t> categoriesOf(std::string_view word) const;
+
+    /**
+     * @brief Looks up many words at once, each step done for the whole batch before the next one,
+     * so the memory reads of different words overlap instead of waiting for each other.
+     * @param words The words.
+     * @param count The number of words.
+     * @param slots Receives the slot of each word, or NOT_FOUND.
+     */
+    void findSlots(const std::string_view *words, size_t count, uint64_t *slots) const;
+
+    /**
+     * @brief Returns the indexes of the categories containing the word in a slot.
+     * @param slot A slot given by findSlots (not NOT_FOUND).
+     * @return The category indexes, in order.
+     */
+    std::vector<size_t> categoriesOfSlot(uint64_t slot) const;
+
+    /**
+     * @brief Finds a category by name.
+     * @param name The category name.
+     * @param category Receives the index of the (first) category with that name.
+     * @return False if there is no such category.
+     */
+    bool findCategory(std::string_view name, size_t &category) const;
+
+    /**
+     * @brief Returns the name of a category.
+     * @param category The index of the category.
+     * @return The name.
+     */
+    std::string_view categoryName(size_t category) const;
+
+    /**
+     * @brief Calls visit with every word of a category, sorted.
+     * @param category The index of the category.
+     * @param visit Called with each word.
+     */
+    void forEachWord(size_t category, const std::function<void(std::string_view)> &visit) const;
+
+    /**
+     * @brief Returns the number of distinct words.
+     * @return The number of distinct words.
+     */
+    size_t wordCount() const;
+
+    /**
+     * @brief Returns the number of categories.
+     * @return The number of categories.
+     */
+    size_t categoryCount() const;
+
+    /**
+     * @brief Returns the size of the buffer.
+     * @return The number of bytes, the same in memory and on disk.
+     */
+    size_t byteSize() const;
+};
+
+#endif // FROZENDICTIONARY_H
@@ -0,0 +1,92 @@
+#include "LineScanner.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// the newline mask of 64 bytes that are all inside the text
+static uint64_t newlinesOf(const char *p)
+{
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) // 16 bytes per compare, movemask packs the 16 results into 16 bits
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+        uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+        mask |= bits << (16 * i);
+    }
+    return mask;
+#else
+    // 8 bytes per step in a plain integer : a zero byte of (word ^ newlines) is a newline
+    const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+    uint64_t mask = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        uint64_t word;
+        memcpy(&word, p + 8 * i, 8);
+        uint64_t x = word ^ (ones * '\n');
+        uint64_t zeros = ~(((x & ~highs) + ~highs) | x) & highs; // exactly the zero bytes, with no false hits
+        for (; zeros != 0; zeros &= zeros - 1)
+        {
+            int byte = __builtin_ctzll(zeros) / 8;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            byte = 7 - byte;
+#endif
+            mask |= uint64_t(1) << (8 * i + byte);
+        }
+    }
+    return mask;
+#endif
+}
+
+LineScanner::LineScanner(const char *begin, const char *end) : pos(begin), end(end), block(begin), mask(0)
+{
+    if (begin < end)
+    {
+        scanBlock(); // the first block is at begin already
+    }
+}
+
+void LineScanner::nextBlock()
+{
+    block += 64; // only called while there are more than 64 bytes from block to end : stays inside the text
+    scanBlock();
+}
+
+void LineScanner::scanBlock()
+{
+    if (end - block >= 64)
+    {
+        mask = newlinesOf(block);
+        return;
+    }
+    // the last, shorter block : one byte at a time (it never reads past end)
+    mask = 0;
+    for (const char *p = block; p < end; ++p)
+    {
+        mask |= uint64_t(*p == '\n') << (p - block);
+    }
+}
+
+bool LineScanner::nextFromNewBlock(string_view &line)
+{
+    while (mask == 0) // no newline left in this block
+    {
+        if (end - block <= 64) // and none after it : the last line has no newline
+        {
+            line = string_view(pos, static_cast<size_t>(end - pos));
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+            pos = end;
+            return true;
+        }
+        nextBlock();
+    }
+    return next(line);
+}
+
+const char *LineScanner::position() const { return pos; }
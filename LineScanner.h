@@ -0,0 +1,87 @@
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @class LineScanner
+ * @brief Splits a block of text into lines, finding the newlines 64 bytes at a time.
+ *
+ * Each 64 byte block is compared against '\n' with SIMD instructions (SSE2 on x86, 8 bytes at a
+ * time in a plain integer elsewhere) into a 64 bit mask with one bit per newline. Handing out the
+ * next line is then a count of trailing zeros, with no byte-by-byte loop and no copy: lines are
+ * views into the text. A '\r' before a newline (CRLF files) is not part of the line.
+ */
+class LineScanner
+{
+private:
+    const char *pos;   ///< Start of the next line.
+    const char *end;   ///< One past the last character of the text.
+    const char *block; ///< Start of the 64 bytes mask describes.
+    uint64_t mask;     ///< One bit per newline of block not handed out yet.
+
+    /**
+     * @brief Moves block to the next 64 bytes and computes their newline mask.
+     */
+    void nextBlock();
+
+    /**
+     * @brief Computes the newline mask of the (up to) 64 bytes at block.
+     */
+    void scanBlock();
+
+    /**
+     * @brief Hands out the next line when mask has no newline left: moves on to the block holding its end (the slow path of next).
+     * @param line Receives the line.
+     * @return True (there is a line left whenever this is called).
+     */
+    bool nextFromNewBlock(std::string_view &line);
+
+public:
+    /**
+     * @brief Creates a scanner over a block of text.
+     * @param begin The first character of the text.
+     * @param end One past the last character of the text.
+     */
+    LineScanner(const char *begin, const char *end);
+
+    /**
+     * @brief Hands out the next line.
+     * The last line needs no newline; an empty text, or a newline at the very end, has no line after it.
+     * @param line Receives the line, without its newline (nor the '\r' before it).
+     * @return False once every line was handed out.
+     */
+    bool next(std::string_view &line);
+
+    /**
+     * @brief Returns where the scanner is in the text.
+     * @return One past the newline of the last line handed out (end after an unterminated last line).
+     */
+    const char *position() const;
+};
+
+// next runs once per line, so it is inline: the common case is a count of trailing zeros and a few stores
+inline bool LineScanner::next(std::string_view &line)
+{
+    if (pos >= end)
+    {
+        return false;
+    }
+    if (mask == 0)
+    {
+        return nextFromNewBlock(line);
+    }
+    const char *newline = block + __builtin_ctzll(mask);
+    mask &= mask - 1; // that newline is used
+    size_t length = static_cast<size_t>(newline - pos);
+    if (length > 0 && newline[-1] == '\r')
+    {
+        --length;
+    }
+    line = std::string_view(pos, length);
+    pos = newline + 1;
+    return true;
+}
+
+#endif // LINESCANNER_H
@@ -0,0 +1,26 @@
+#include "MemoryUsage.h"
+using namespace std;
+
+size_t MemoryUsage::total() const { return payloadBytes + overheadBytes + slackBytes; }
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other)
+{
+    words += other.words;
+    nodes += other.nodes;
+    payloadBytes += other.payloadBytes;
+    overheadBytes += other.overheadBytes;
+    slackBytes += other.slackBytes;
+    return *this;
+}
+
+void MemoryUsage::write(ostream &sout) const
+{
+    sout << total() << " bytes (" << payloadBytes << " payload, " << overheadBytes << " overhead, "
+         << slackBytes << " slack), " << words << " words, " << nodes << " nodes\n";
+}
+
+ostream &operator<<(ostream &out, const MemoryUsage &usage)
+{
+    usage.write(out);
+    return out;
+}
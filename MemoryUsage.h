@@ -0,0 +1,49 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <iostream>
+
+/**
+ * @struct MemoryUsage
+ * @brief Where the bytes of a category (or of all of them) go.
+ *
+ * The numbers are computed from the sizes and capacities of the containers, so they
+ * leave out what the allocator itself adds (size classes, chunk headers).
+ */
+struct MemoryUsage
+{
+    size_t words = 0;         ///< Number of words held in memory.
+    size_t nodes = 0;         ///< Number of list nodes (one allocation each).
+    size_t payloadBytes = 0;  ///< Bytes of the words themselves (encoded bytes for compressed categories).
+    size_t overheadBytes = 0; ///< Bytes of bookkeeping: list nodes, string headers, indexes, filters, caches.
+    size_t slackBytes = 0;    ///< Bytes reserved but not used: string and vector capacity, room kept by the word arenas.
+
+    /**
+     * @brief Returns payload, overhead and slack added together.
+     * @return The total number of bytes.
+     */
+    size_t total() const;
+
+    /**
+     * @brief Adds the numbers of another MemoryUsage to these.
+     * @param other The numbers to add.
+     * @return A reference to this MemoryUsage.
+     */
+    MemoryUsage &operator+=(const MemoryUsage &other);
+
+    /**
+     * @brief Writes the numbers on one line.
+     * @param sout The output stream.
+     */
+    void write(std::ostream &sout) const;
+
+    /**
+     * @brief Output stream operator overload for MemoryUsage.
+     * @param out The output stream.
+     * @param usage The numbers to output.
+     * @return The output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const MemoryUsage &usage);
+};
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,665 @@
+#include "Pattern.h"
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+using namespace std;
+
+static const size_t MAX_LITERALS = 16;      // beyond this many alternatives a literal list stops paying off
+static const size_t MAX_DFA_STATES = 10000; // about 10000 * (number of classes) * 4 bytes of table at most
+
+// reads a [...] class starting just after the '[' ; negate is '!' for globs, '^' for regexes
+static bitset<256> parseClass(const string &pattern, size_t &pos, bool regex)
+{
+    bitset<256> set;
+    bool negated = false;
+    if (pos < pattern.size() && (pattern[pos] == '^' || (!regex && pattern[pos] == '!')))
+    {
+        negated = true;
+        ++pos;
+    }
+    bool first = true;
+    while (pos < pattern.size() && (pattern[pos] != ']' || first)) // a ']' right after '[' is a plain character
+    {
+        first = false;
+        unsigned char low = static_cast<unsigned char>(pattern[pos++]);
+        if (regex && low == '\\' && pos < pattern.size())
+        {
+            low = static_cast<unsigned char>(pattern[pos++]);
+        }
+        unsigned char high = low;
+        if (pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']') // a range like a-z
+        {
+            high = static_cast<unsigned char>(pattern[pos + 1]);
+            pos += 2;
+            if (high < low)
+            {
+                throw invalid_argument("bad range in [ ] of pattern: " + pattern);
+            }
+        }
+        for (unsigned c = low; c <= high; ++c)
+        {
+            set.set(c);
+        }
+    }
+    if (pos >= pattern.size())
+    {
+        throw invalid_argument("missing ] in pattern: " + pattern);
+    }
+    ++pos; // the ']'
+    return negated ? ~set : set;
+}
+
+// recursive descent over : alternation = concatenation ('|' concatenation)*, concatenation = repetition*,
+// repetition = atom ('*' | '+' | '?')*, atom = '(' alternation ')' | '[' class ']' | '.' | '\' char | char
+struct Pattern::RegexParser
+{
+    const string &pattern;
+    size_t pos = 0;
+    int depth = 0; ///< Number of '(' around pos : anchors are only allowed outside of them.
+
+    Node alternation()
+    {
+        Node first = concatenation();
+        if (pos >= pattern.size() || pattern[pos] != '|')
+        {
+            return first;
+        }
+        Node alt;
+        alt.kind = Node::Alternate;
+        alt.kids.push_back(move(first));
+        while (pos < pattern.size() && pattern[pos] == '|')
+        {
+            ++pos;
+            alt.kids.push_back(concatenation());
+        }
+        return alt;
+    }
+
+    Node concatenation()
+    {
+        Node seq;
+        seq.kind = Node::Concat;
+        while (pos < pattern.size() && pattern[pos] != '|' && pattern[pos] != ')')
+        {
+            if (atEndAnchor()) // handled by the caller
+            {
+                break;
+            }
+            seq.kids.push_back(repetition());
+        }
+        if (seq.kids.size() == 1)
+        {
+            return move(seq.kids[0]);
+        }
+        return seq;
+    }
+
+    // a '$' ending a top-level alternative
+    bool atEndAnchor() const
+    {
+        return depth == 0 && pos < pattern.size() && pattern[pos] == '$' && (pos + 1 == pattern.size() || pattern[pos + 1] == '|');
+    }
+
+    Node repetition()
+    {
+        Node node = atom();
+        while (pos < pattern.size() && (pattern[pos] == '*' || pattern[pos] == '+' || pattern[pos] == '?'))
+        {
+            Node repeated;
+            repeated.kind = pattern[pos] == '*' ? Node::Star : pattern[pos] == '+' ? Node::Plus : Node::Optional;
+            repeated.kids.push_back(move(node));
+            node = move(repeated);
+            ++pos;
+        }
+        return node;
+    }
+
+    Node atom()
+    {
+        Node node;
+        node.kind = Node::Chars;
+        char c = pattern[pos++];
+        switch (c)
+        {
+        case '(':
+            ++depth;
+            node = alternation();
+            --depth;
+            if (pos >= pattern.size() || pattern[pos] != ')')
+            {
+                throw invalid_argument("missing ) in pattern: " + pattern);
+            }
+            ++pos;
+            break;
+        case '[':
+            node.set = parseClass(pattern, pos, true);
+            break;
+        case '.':
+            node.set.set();
+            break;
+        case '\\':
+            if (pos >= pattern.size())
+            {
+                throw invalid_argument("pattern ends with \\: " + pattern);
+            }
+            c = pattern[pos++];
+            if (c == 'd' || c == 'w' || c == 's')
+            {
+                for (unsigned b = 0; b < 256; ++b)
+                {
+                    bool in = (c == 'd') ? isdigit(b) : (c == 'w') ? (isalnum(b) || b == '_') : isspace(b);
+                    node.set.set(b, in);
+                }
+            }
+            else
+            {
+                node.set.set(static_cast<unsigned char>(c));
+            }
+            break;
+        case '*':
+        case '+':
+        case '?':
+        case ')':
+        case '^':
+        case '$':
+            throw invalid_argument(string("unexpected ") + c + " in pattern: " + pattern);
+        default:
+            node.set.set(static_cast<unsigned char>(c));
+        }
+        return node;
+    }
+};
+
+Pattern::Node Pattern::parseGlob(const string &pattern)
+{
+    Node seq;
+    seq.kind = Node::Concat;
+    for (size_t pos = 0; pos < pattern.size();)
+    {
+        Node node;
+        node.kind = Node::Chars;
+        char c = pattern[pos++];
+        if (c == '*')
+        {
+            node.set.set();
+            Node star;
+            star.kind = Node::Star;
+            star.kids.push_back(move(node));
+            seq.kids.push_back(move(star));
+            continue;
+        }
+        if (c == '\\' && pos < pattern.size())
+            node.set.set(static_cast<unsigned char>(pattern[pos++]));
+        else if (c == '?')
+            node.set.set();
+        else if (c == '[')
+            node.set = parseClass(pattern, pos, false);
+        else
+            node.set.set(static_cast<unsigned char>(c));
+        seq.kids.push_back(move(node));
+    }
+    return seq;
+}
+
+Pattern::Node Pattern::parseRegex(const string &pattern, bool &anchoredStart, bool &anchoredEnd)
+{
+    // the top-level alternatives, each with its own anchors : ^a|b is (^a)|b
+    RegexParser parser{pattern};
+    vector<Node> branches;
+    vector<pair<bool, bool>> anchors; // (starts with ^, ends with $) for each branch
+    while (true)
+    {
+        bool start = parser.pos < pattern.size() && pattern[parser.pos] == '^';
+        parser.pos += start ? 1 : 0;
+        branches.push_back(parser.concatenation());
+        bool end = parser.atEndAnchor();
+        parser.pos += end ? 1 : 0;
+        anchors.emplace_back(start, end);
+        if (parser.pos >= pattern.size() || pattern[parser.pos] != '|')
+        {
+            break;
+        }
+        ++parser.pos;
+    }
+    if (parser.pos != pattern.size()) // a ')' without its '('
+    {
+        throw invalid_argument("unexpected ) in pattern: " + pattern);
+    }
+    if (branches.size() == 1)
+    {
+        anchoredStart = anchors[0].first;
+        anchoredEnd = anchors[0].second;
+        return move(branches[0]);
+    }
+    Node alt;
+    alt.kind = Node::Alternate;
+    bool same = all_of(anchors.begin(), anchors.end(), [&](const pair<bool, bool> &a)
+                       { return a == anchors[0]; });
+    anchoredStart = same ? anchors[0].first : true;
+    anchoredEnd = same ? anchors[0].second : true;
+    for (size_t i = 0; i < branches.size(); ++i)
+    {
+        // the same anchors everywhere : ^a|^b is ^(a|b). Otherwise each branch matches whole words on its own
+        alt.kids.push_back(same ? move(branches[i]) : matchAnywhere(move(branches[i]), anchors[i].first, anchors[i].second));
+    }
+    return alt;
+}
+
+Pattern::Node Pattern::matchAnywhere(Node root, bool anchoredStart, bool anchoredEnd)
+{
+    if (anchoredStart && anchoredEnd)
+    {
+        return root;
+    }
+    Node any;
+    any.kind = Node::Chars;
+    any.set.set();
+    Node anything;
+    anything.kind = Node::Star;
+    anything.kids.push_back(any);
+    Node whole;
+    whole.kind = Node::Concat;
+    if (!anchoredStart)
+        whole.kids.push_back(anything);
+    whole.kids.push_back(move(root));
+    if (!anchoredEnd)
+        whole.kids.push_back(anything);
+    return whole;
+}
+
+bool Pattern::finiteStrings(const Node &node, vector<string> &strings)
+{
+    strings.clear();
+    vector<string> part;
+    switch (node.kind)
+    {
+    case Node::Empty:
+        strings.push_back("");
+        return true;
+    case Node::Chars:
+        if (node.set.count() > 4) // [a-z] or . : too many to be worth listing
+        {
+            return false;
+        }
+        for (unsigned c = 0; c < 256; ++c)
+        {
+            if (node.set.test(c))
+            {
+                strings.push_back(string(1, static_cast<char>(c)));
+            }
+        }
+        return true;
+    case Node::Concat:
+        strings.push_back("");
+        for (const auto &kid : node.kids)
+        {
+            if (!finiteStrings(kid, part) || strings.size() * part.size() > MAX_LITERALS)
+            {
+                return false;
+            }
+            vector<string> longer;
+            for (const auto &head : strings)
+            {
+                for (const auto &tail : part)
+                {
+                    longer.push_back(head + tail);
+                }
+            }
+            strings.swap(longer);
+        }
+        return true;
+    case Node::Alternate:
+    {
+        vector<string> all;
+        for (const auto &kid : node.kids)
+        {
+            if (!finiteStrings(kid, part) || all.size() + part.size() > MAX_LITERALS)
+            {
+                return false;
+            }
+            all.insert(all.end(), part.begin(), part.end());
+        }
+        strings.swap(all);
+        return true;
+    }
+    case Node::Optional:
+        if (!finiteStrings(node.kids[0], strings) || strings.size() + 1 > MAX_LITERALS)
+        {
+            return false;
+        }
+        strings.push_back("");
+        return true;
+    default: // Star and Plus match infinitely many strings
+        return false;
+    }
+}
+
+void Pattern::extractLiterals(const Node &root, bool anchoredStart)
+{
+    vector<const Node *> sequence;
+    if (root.kind == Node::Concat)
+    {
+        for (const auto &kid : root.kids)
+            sequence.push_back(&kid);
+    }
+    else
+    {
+        sequence.push_back(&root);
+    }
+
+    vector<string> strings;
+    // the strings the leading elements of a sequence can spell : every match of it starts with one of them
+    auto leadingStrings = [&](const vector<const Node *> &elements)
+    {
+        vector<string> heads{""};
+        for (const Node *node : elements)
+        {
+            if (!finiteStrings(*node, strings) || heads.size() * strings.size() > MAX_LITERALS)
+            {
+                break;
+            }
+            vector<string> longer;
+            for (const auto &head : heads)
+            {
+                for (const auto &tail : strings)
+                {
+                    longer.push_back(head + tail);
+                }
+            }
+            heads.swap(longer);
+        }
+        return heads;
+    };
+    if (anchoredStart)
+    {
+        vector<string> heads;
+        if (root.kind == Node::Alternate) // every match starts like one of the alternatives (one spelling "" : no prefixes at all)
+        {
+            for (const auto &kid : root.kids)
+            {
+                vector<const Node *> elements;
+                if (kid.kind == Node::Concat)
+                {
+                    for (const auto &element : kid.kids)
+                        elements.push_back(&element);
+                }
+                else
+                {
+                    elements.push_back(&kid);
+                }
+                vector<string> kidHeads = leadingStrings(elements);
+                heads.insert(heads.end(), kidHeads.begin(), kidHeads.end());
+                if (heads.size() > MAX_LITERALS)
+                {
+                    heads.assign(1, "");
+                    break;
+                }
+            }
+        }
+        else
+        {
+            heads = leadingStrings(sequence);
+        }
+        sort(heads.begin(), heads.end());
+        heads.erase(unique(heads.begin(), heads.end()), heads.end());
+        if (!heads[0].empty()) // an empty prefix would mean scanning everything anyway
+        {
+            for (const auto &head : heads) // "un" already covers "under" : keep only the shortest of nested prefixes
+            {
+                if (prefixes.empty() || head.compare(0, prefixes.back().size(), prefixes.back()) != 0)
+                {
+                    prefixes.push_back(head);
+                }
+            }
+        }
+    }
+
+    // the longest run of elements that each spell exactly one string
+    string run;
+    for (const Node *node : sequence)
+    {
+        if (finiteStrings(*node, strings) && strings.size() == 1)
+        {
+            run += strings[0];
+            continue;
+        }
+        if (run.size() > required.size())
+        {
+            required = run;
+        }
+        run.clear();
+    }
+    if (run.size() > required.size())
+    {
+        required = run;
+    }
+}
+
+void Pattern::buildDfa(const Node &root)
+{
+    // Thompson construction : each node becomes a piece of NFA with one start and one end state
+    struct NfaState
+    {
+        bitset<256> set;     // characters leading to 'to'
+        int32_t to = -1;
+        vector<int32_t> eps; // moves that read nothing
+    };
+    vector<NfaState> nfa;
+    auto newState = [&]()
+    {
+        nfa.emplace_back();
+        return static_cast<int32_t>(nfa.size() - 1);
+    };
+    function<pair<int32_t, int32_t>(const Node &)> build = [&](const Node &node) -> pair<int32_t, int32_t>
+    {
+        int32_t start = newState(), end;
+        switch (node.kind)
+        {
+        case Node::Chars:
+            end = newState();
+            nfa[start].set = node.set;
+            nfa[start].to = end;
+            return {start, end};
+        case Node::Concat:
+            end = start;
+            for (const auto &kid : node.kids)
+            {
+                auto piece = build(kid);
+                nfa[end].eps.push_back(piece.first);
+                end = piece.second;
+            }
+            return {start, end};
+        case Node::Alternate:
+            end = newState();
+            for (const auto &kid : node.kids)
+            {
+                auto piece = build(kid);
+                nfa[start].eps.push_back(piece.first);
+                nfa[piece.second].eps.push_back(end);
+            }
+            return {start, end};
+        case Node::Star:
+        case Node::Plus:
+        case Node::Optional:
+        {
+            end = newState();
+            auto piece = build(node.kids[0]);
+            nfa[start].eps.push_back(piece.first);
+            if (node.kind != Node::Plus)
+                nfa[start].eps.push_back(end); // may be skipped
+            if (node.kind != Node::Optional)
+                nfa[piece.second].eps.push_back(piece.first); // may repeat
+            nfa[piece.second].eps.push_back(end);
+            return {start, end};
+        }
+        default:
+            return {start, start};
+        }
+    };
+    auto whole = build(root);
+
+    // characters that every NFA edge treats the same way share one class (usually a handful in total)
+    byteClass.fill(0);
+    classCount = 1;
+    for (const auto &state : nfa)
+    {
+        if (state.to < 0)
+        {
+            continue;
+        }
+        map<pair<uint8_t, bool>, uint8_t> split; // (old class, in this set) -> new class
+        for (unsigned c = 0; c < 256; ++c)
+        {
+            auto found = split.emplace(make_pair(byteClass[c], state.set.test(c)), static_cast<uint8_t>(split.size()));
+            byteClass[c] = found.first->second;
+        }
+        classCount = split.size();
+    }
+    vector<unsigned char> representative(classCount);
+    for (unsigned c = 256; c-- > 0;)
+    {
+        representative[byteClass[c]] = static_cast<unsigned char>(c);
+    }
+
+    // subset construction : each DFA state is the set of NFA states the input so far can be in
+    auto closure = [&](vector<int32_t> states)
+    {
+        vector<bool> seen(nfa.size(), false);
+        vector<int32_t> stack(states);
+        states.clear();
+        while (!stack.empty())
+        {
+            int32_t s = stack.back();
+            stack.pop_back();
+            if (seen[s])
+                continue;
+            seen[s] = true;
+            states.push_back(s);
+            for (int32_t next : nfa[s].eps)
+                stack.push_back(next);
+        }
+        sort(states.begin(), states.end());
+        return states;
+    };
+    map<vector<int32_t>, int32_t> known;
+    vector<vector<int32_t>> sets;
+    auto stateOf = [&](vector<int32_t> set)
+    {
+        auto found = known.find(set);
+        if (found != known.end())
+        {
+            return found->second;
+        }
+        if (sets.size() >= MAX_DFA_STATES)
+        {
+            throw invalid_argument("pattern too complex: " + text);
+        }
+        int32_t id = static_cast<int32_t>(sets.size());
+        known.emplace(set, id);
+        sets.push_back(move(set));
+        return id;
+    };
+    stateOf({});                   // state 0 : no NFA state left, nothing can match anymore
+    startState = stateOf(closure({whole.first}));
+    for (size_t d = 0; d < sets.size(); ++d) // sets grows while we go
+    {
+        transitions.resize((d + 1) * classCount, 0);
+        for (size_t k = 0; k < classCount; ++k)
+        {
+            vector<int32_t> moved;
+            for (int32_t s : sets[d])
+            {
+                if (nfa[s].to >= 0 && nfa[s].set.test(representative[k]))
+                {
+                    moved.push_back(nfa[s].to);
+                }
+            }
+            int32_t next = moved.empty() ? 0 : stateOf(closure(move(moved)));
+            transitions[d * classCount + k] = next;
+        }
+    }
+    accepting.assign(sets.size(), 0);
+    acceptsRest.assign(sets.size(), 0);
+    for (size_t d = 0; d < sets.size(); ++d)
+    {
+        accepting[d] = binary_search(sets[d].begin(), sets[d].end(), whole.second);
+        bool loops = accepting[d];
+        for (size_t k = 0; k < classCount && loops; ++k)
+        {
+            loops = transitions[d * classCount + k] == static_cast<int32_t>(d);
+        }
+        acceptsRest[d] = loops; // eg. after "un" in ^un : whatever follows, the word matches
+    }
+}
+
+Pattern::Pattern(const string &pattern, Syntax syntax) : text(pattern)
+{
+    bool anchoredStart = true, anchoredEnd = true; // a glob always matches the whole word
+    Node root = syntax == Glob ? parseGlob(pattern) : parseRegex(pattern, anchoredStart, anchoredEnd);
+    extractLiterals(root, anchoredStart);
+    buildDfa(matchAnywhere(move(root), anchoredStart, anchoredEnd)); // "match anywhere" is "match the whole word, with anything before and after"
+}
+
+Pattern::Syntax Pattern::guessSyntax(const string &pattern)
+{
+    bool regex = !pattern.empty() && (pattern.front() == '^' || pattern.back() == '$');
+    return regex ? Regex : Glob;
+}
+
+const string &Pattern::getText() const { return text; }
+
+bool Pattern::matches(string_view word) const
+{
+    int32_t state = startState;
+    for (unsigned char c : word)
+    {
+        if (acceptsRest[state])
+        {
+            return true;
+        }
+        state = transitions[state * classCount + byteClass[c]];
+        if (state == 0)
+        {
+            return false;
+        }
+    }
+    return accepting[state];
+}
+
+size_t Pattern::scanSorted(const vector<string> &sorted, const function<void(const string &)> &emit) const
+{
+    size_t found = 0;
+    auto check = [&](const string &word)
+    {
+        if (!required.empty() && word.find(required) == string::npos) // most words fail here, without the DFA
+        {
+            return;
+        }
+        if (matches(word))
+        {
+            emit(word);
+            ++found;
+        }
+    };
+    if (prefixes.empty())
+    {
+        for (const auto &word : sorted)
+        {
+            check(word);
+        }
+        return found;
+    }
+    for (const auto &prefix : prefixes) // sorted and not nested, so the words come out sorted too
+    {
+        for (auto it = lower_bound(sorted.begin(), sorted.end(), prefix); it != sorted.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+        {
+            check(*it);
+        }
+    }
+    return found;
+}
+
+const vector<string> &Pattern::getPrefixes() const { return prefixes; }
+
+const string &Pattern::getRequired() const { return required; }
@@ -0,0 +1,171 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Pattern
+ * @brief A glob or regular expression compiled once into a DFA, with literals to skip words cheaply.
+ *
+ * Globs (*, ?, [a-z], [!x], \ to escape) must match the whole word. Regular expressions (., [ ], ( ), |, *, +, ?,
+ * escapes with \) match anywhere in the word unless anchored with ^ and / or $. As usual, anchors belong to the
+ * top-level alternative they are written on: ^a|b is (^a)|b, not ^(a|b).
+ * Compiling also extracts two literals from the pattern:
+ * - the prefixes every match starts with (eg. "un" and "over" for ^(un|over)), so a sorted run
+ *   of words only has to be looked at in the ranges starting with them;
+ * - the longest piece of text every match contains (eg. "shirt" for *shirt), so most words
+ *   are rejected by a substring search without running the DFA.
+ */
+class Pattern
+{
+public:
+    /**
+     * @brief How the pattern text is written.
+     */
+    enum Syntax
+    {
+        Glob, ///< Shell-style wildcards, matching the whole word.
+        Regex ///< Regular expression, matching anywhere unless anchored.
+    };
+
+private:
+    /**
+     * @brief One node of the parsed pattern.
+     */
+    struct Node
+    {
+        enum Kind
+        {
+            Chars,    ///< One character out of set.
+            Concat,   ///< kids one after the other.
+            Alternate, ///< One of kids.
+            Star,     ///< kids[0], any number of times.
+            Plus,     ///< kids[0], at least once.
+            Optional, ///< kids[0], at most once.
+            Empty     ///< Nothing.
+        };
+        Kind kind = Empty;
+        std::bitset<256> set; ///< For Chars: the characters matched.
+        std::vector<Node> kids;
+    };
+
+    std::string text;                      ///< The pattern as written.
+    std::array<uint8_t, 256> byteClass{};  ///< Character -> class of characters the DFA never tells apart.
+    size_t classCount = 0;                 ///< Number of character classes.
+    std::vector<int32_t> transitions;      ///< DFA state * classCount + class -> next state (state 0 rejects everything).
+    std::vector<uint8_t> accepting;        ///< DFA state -> 1 if a word ending there matches.
+    std::vector<uint8_t> acceptsRest;      ///< DFA state -> 1 if the word matches whatever follows.
+    int32_t startState = 0;
+    std::vector<std::string> prefixes;     ///< Every match starts with one of these (empty: no such list).
+    std::string required;                  ///< Every match contains this.
+
+    struct RegexParser; ///< Recursive descent parser for regexes, defined in Pattern.cpp.
+
+    /**
+     * @brief Parses a glob.
+     * @param pattern The glob.
+     * @return The parsed glob.
+     */
+    static Node parseGlob(const std::string &pattern);
+
+    /**
+     * @brief Parses a regex.
+     * Each top-level alternative may have its own anchors. When they all have the same ones, these are
+     * reported and left out of the result; otherwise each alternative is made to match the whole word
+     * on its own (see matchAnywhere) and the result is reported anchored at both ends.
+     * @param pattern The regex.
+     * @param anchoredStart Set to true if matches must start at the beginning of the word.
+     * @param anchoredEnd Set to true if matches must end at the end of the word.
+     * @return The parsed regex, without the anchors.
+     */
+    static Node parseRegex(const std::string &pattern, bool &anchoredStart, bool &anchoredEnd);
+
+    /**
+     * @brief Turns a pattern into one matching whole words, with anything before and / or after it.
+     * @param root The pattern.
+     * @param anchoredStart False to allow anything before it.
+     * @param anchoredEnd False to allow anything after it.
+     * @return The pattern, with ".*" added on the sides that are not anchored.
+     */
+    static Node matchAnywhere(Node root, bool anchoredStart, bool anchoredEnd);
+
+    /**
+     * @brief Lists the strings a node matches, if there are few of them.
+     * @param node The node.
+     * @param strings Receives the strings.
+     * @return False if the node matches too many strings (or infinitely many).
+     */
+    static bool finiteStrings(const Node &node, std::vector<std::string> &strings);
+
+    /**
+     * @brief Fills prefixes and required from the top-level sequence of the pattern
+     * (prefixes from each alternative when the pattern is an alternation).
+     * @param root The parsed pattern.
+     * @param anchoredStart True if matches must start at the beginning of the word.
+     */
+    void extractLiterals(const Node &root, bool anchoredStart);
+
+    /**
+     * @brief Builds the DFA: Thompson NFA, then subset construction over character classes.
+     * @param root The parsed pattern, already wrapped to match whole words.
+     */
+    void buildDfa(const Node &root);
+
+public:
+    /**
+     * @brief Compiles a pattern.
+     * @param pattern The pattern text.
+     * @param syntax How the pattern is written.
+     * @throws std::invalid_argument if the pattern is malformed or too complex.
+     */
+    Pattern(const std::string &pattern, Syntax syntax);
+
+    /**
+     * @brief Guesses how a pattern is written: regex if it starts with ^ or ends with $, glob otherwise.
+     * @param pattern The pattern text.
+     * @return The guessed syntax.
+     */
+    static Syntax guessSyntax(const std::string &pattern);
+
+    /**
+     * @brief Returns the pattern as written.
+     * @return The pattern text.
+     */
+    const std::string &getText() const;
+
+    /**
+     * @brief Tells whether a word matches.
+     * @param word The word.
+     * @return True if the word matches.
+     */
+    bool matches(std::string_view word) const;
+
+    /**
+     * @brief Calls emit with every matching word of a sorted run, in order.
+     * Only the ranges starting with one of the pattern's prefixes are looked at.
+     * @param sorted Words sorted by their bytes.
+     * @param emit Called with each matching word.
+     * @return The number of matching words.
+     */
+    size_t scanSorted(const std::vector<std::string> &sorted, const std::function<void(const std::string &)> &emit) const;
+
+    /**
+     * @brief Returns the prefixes every match starts with.
+     * @return The prefixes (empty if there are none to use).
+     */
+    const std::vector<std::string> &getPrefixes() const;
+
+    /**
+     * @brief Returns the text every match contains.
+     * @return The required text (empty if there is none).
+     */
+    const std::string &getRequired() const;
+};
+
+#endif // PATTERN_H
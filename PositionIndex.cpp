@@ -0,0 +1,150 @@
+#include "PositionIndex.h"
+#include <algorithm>
+using namespace std;
+
+// The posting key of a letter at a position (letters in lowercase, so queries ignore case).
+static uint32_t postingKey(size_t position, char c)
+{
+    unsigned char letter = static_cast<unsigned char>(c);
+    if (letter >= 'A' && letter <= 'Z')
+    {
+        letter = letter - 'A' + 'a';
+    }
+    return static_cast<uint32_t>(position * 256 + letter);
+}
+
+static bool isWildcard(char c) { return c == PositionIndex::ANY || c == '.' || c == '_'; }
+
+void PositionIndex::add(string_view word)
+{
+    string key(word);
+    auto found = idOf.find(key);
+    if (found != idOf.end()) // one more copy : the sets do not change
+    {
+        return;
+    }
+    Length &length = byLength[word.size()];
+    uint32_t id;
+    if (!length.freeIds.empty())
+    {
+        id = length.freeIds.back();
+        length.freeIds.pop_back();
+        length.words[id] = key;
+    }
+    else
+    {
+        id = static_cast<uint32_t>(length.words.size());
+        length.words.push_back(key);
+    }
+    length.all.add(id);
+    for (size_t position = 0; position < word.size(); ++position)
+    {
+        length.postings[postingKey(position, word[position])].add(id);
+    }
+    idOf.emplace(move(key), make_pair(word.size(), id));
+}
+
+void PositionIndex::removeAll(string_view word)
+{
+    auto found = idOf.find(string(word));
+    if (found == idOf.end())
+    {
+        return;
+    }
+    Length &length = byLength[found->second.first];
+    uint32_t id = found->second.second;
+    length.all.remove(id);
+    for (size_t position = 0; position < word.size(); ++position)
+    {
+        auto posting = length.postings.find(postingKey(position, word[position]));
+        posting->second.remove(id);
+        if (posting->second.isEmpty())
+        {
+            length.postings.erase(posting);
+        }
+    }
+    string().swap(length.words[id]);
+    length.freeIds.push_back(id);
+    idOf.erase(found);
+    if (length.all.isEmpty())
+    {
+        byLength.erase(word.size());
+    }
+}
+
+void PositionIndex::clear()
+{
+    byLength.clear();
+    idOf.clear();
+}
+
+size_t PositionIndex::find(string_view pattern, const function<void(const string &)> &emit) const
+{
+    auto found = byLength.find(pattern.size());
+    if (found == byLength.end())
+    {
+        return 0;
+    }
+    const Length &length = found->second;
+    vector<const CompressedBitmap *> sets; // one per fixed letter
+    for (size_t position = 0; position < pattern.size(); ++position)
+    {
+        if (isWildcard(pattern[position]))
+        {
+            continue;
+        }
+        auto posting = length.postings.find(postingKey(position, pattern[position]));
+        if (posting == length.postings.end()) // no word has that letter there
+        {
+            return 0;
+        }
+        sets.push_back(&posting->second);
+    }
+    size_t count = 0;
+    auto report = [&](uint32_t id)
+    {
+        emit(length.words[id]);
+        ++count;
+    };
+    if (sets.empty()) // only wildcards : every word of that length
+    {
+        length.all.forEach(report);
+        return count;
+    }
+    // start from the smallest set, so every intersection after it is as cheap as possible
+    sort(sets.begin(), sets.end(), [](const CompressedBitmap *a, const CompressedBitmap *b)
+         { return a->cardinality() < b->cardinality(); });
+    CompressedBitmap result = *sets[0];
+    for (size_t i = 1; i < sets.size() && !result.isEmpty(); ++i)
+    {
+        result.intersectWith(*sets[i]);
+    }
+    result.forEach(report);
+    return count;
+}
+
+size_t PositionIndex::memoryUsage() const
+{
+    const size_t inlineCapacity = string().capacity();
+    size_t bytes = 0;
+    for (const auto &entry : byLength)
+    {
+        const Length &length = entry.second;
+        bytes += sizeof(entry) + 3 * sizeof(void *); // the map node
+        bytes += length.words.capacity() * sizeof(string) + length.freeIds.capacity() * sizeof(uint32_t);
+        for (const auto &word : length.words)
+        {
+            bytes += word.capacity() > inlineCapacity ? word.capacity() + 1 : 0;
+        }
+        bytes += length.all.memoryUsage();
+        for (const auto &posting : length.postings)
+        {
+            bytes += posting.second.memoryUsage() + sizeof(uint32_t) + 2 * sizeof(void *);
+        }
+    }
+    for (const auto &entry : idOf)
+    {
+        bytes += sizeof(entry) + 2 * sizeof(void *) + (entry.first.capacity() > inlineCapacity ? entry.first.capacity() + 1 : 0);
+    }
+    return bytes;
+}
@@ -0,0 +1,80 @@
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include "CompressedBitmap.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class PositionIndex
+ * @brief Finds the words of a given length with given letters at given positions (crossword-style queries).
+ *
+ * Words are grouped by length, and each word gets a small id within its length. For every
+ * (position, letter) the index keeps the set of ids of the words having that letter there, as a
+ * CompressedBitmap. A query such as "?a???e?" intersects the sets of (1, 'a') and (5, 'e') among
+ * the 7 letter words, smallest set first, and only reads the words left at the end.
+ *
+ * Letters are compared case-insensitively.
+ */
+class PositionIndex
+{
+private:
+    /**
+     * @brief The words of one length.
+     */
+    struct Length
+    {
+        std::vector<std::string> words;                      ///< id -> word (empty for a free id).
+        std::vector<uint32_t> freeIds;                       ///< Ids of removed words, to reuse.
+        CompressedBitmap all;                                ///< Every id in use.
+        std::unordered_map<uint32_t, CompressedBitmap> postings; ///< position * 256 + letter -> the ids with that letter there.
+    };
+
+    std::map<size_t, Length> byLength;                          ///< length -> its words
+    std::unordered_map<std::string, std::pair<size_t, uint32_t>> idOf; ///< word -> (length, id)
+
+public:
+    /**
+     * @brief The character standing for any letter in a query pattern (as well as '.' and '_').
+     */
+    static const char ANY = '?';
+
+    /**
+     * @brief Adds a word (copies of a word already there change nothing).
+     * @param word The word.
+     */
+    void add(std::string_view word);
+
+    /**
+     * @brief Removes every copy of a word (nothing happens if it is not there).
+     * @param word The word.
+     */
+    void removeAll(std::string_view word);
+
+    /**
+     * @brief Removes every word.
+     */
+    void clear();
+
+    /**
+     * @brief Calls emit with every distinct word matching a pattern.
+     * @param pattern One character per position: a letter the word must have there (any case), or ANY, '.' or '_'.
+     * @param emit Called with each word.
+     * @return The number of words found.
+     */
+    size_t find(std::string_view pattern, const std::function<void(const std::string &)> &emit) const;
+
+    /**
+     * @brief Returns an estimate of the memory used by the index.
+     * @return The number of bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif // POSITIONINDEX_H
@@ -0,0 +1,305 @@
+#include "SessionReplay.h"
+#include "WordCatVec.h"
+#include "VocabFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+using namespace std;
+
+// Reads one character at a time from another buffer (cin's), and writes every character read to a stream.
+// No buffering of its own : the characters copied are exactly the ones the menus consumed.
+class SessionReplay::TeeBuffer : public streambuf
+{
+    streambuf *source;
+    ostream &copy;
+
+protected:
+    int_type underflow() override { return source->sgetc(); } // look at the next character without taking it
+
+    int_type uflow() override // take the next character
+    {
+        int_type c = source->sbumpc();
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            copy.put(traits_type::to_char_type(c));
+        }
+        return c;
+    }
+
+public:
+    TeeBuffer(streambuf *source, ostream &copy) : source(source), copy(copy) {}
+};
+
+// An output buffer that only counts what is written to it, so printing costs as little as possible.
+class SessionReplay::NullBuffer : public streambuf
+{
+    char scratch[4096];
+    uint64_t flushed = 0;
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        flushed += pptr() - pbase();
+        setp(scratch, scratch + sizeof(scratch)); // start over at the beginning : nothing is kept
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            sputc(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    streamsize xsputn(const char *, streamsize n) override
+    {
+        flushed += n; // big writes are not even copied
+        return n;
+    }
+
+public:
+    NullBuffer() { setp(scratch, scratch + sizeof(scratch)); }
+
+    uint64_t bytes() const { return flushed + (pptr() - pbase()); }
+};
+
+bool SessionReplay::record(const string &scriptFile)
+{
+    ofstream script(scriptFile);
+    if (!script)
+    {
+        cerr << "Error opening file for writing: " << scriptFile << '\n';
+        return false;
+    }
+    TeeBuffer tee(cin.rdbuf(), script);
+    streambuf *keyboard = cin.rdbuf(&tee); // from now on, what the menus read also goes to the script
+    {
+        WordCatVec word_cat_vec;
+        word_cat_vec.run();
+    }
+    cin.rdbuf(keyboard);
+    return static_cast<bool>(script.flush());
+}
+
+string SessionReplay::generate(const string &vocabFile, size_t commands, uint32_t seed, const string &saveFile)
+{
+    string contents;
+    if (!VocabFile::readAll(vocabFile, contents))
+    {
+        cerr << "Error opening file: " << vocabFile << '\n';
+        return "";
+    }
+    vector<CategoryExtent> extents = VocabFile::scan(contents);
+    vector<string> names;
+    vector<string> words;
+    for (const auto &extent : extents)
+    {
+        if (extent.name.empty() || extent.name == "exit") // cannot be typed at the category prompt
+        {
+            continue;
+        }
+        names.push_back(extent.name);
+        VocabFile::forEachWord(contents.data() + extent.offset, contents.data() + extent.offset + extent.length, [&](const string &word)
+                               { words.push_back(word); });
+    }
+    mt19937 rng(seed);
+    auto pick = [&](const vector<string> &from) -> const string &
+    { return from[uniform_int_distribution<size_t>(0, from.size() - 1)(rng)]; };
+    auto randomWord = [&]() // a word that is most likely in no category
+    {
+        string word;
+        size_t length = uniform_int_distribution<size_t>(4, 10)(rng);
+        for (size_t i = 0; i < length; ++i)
+        {
+            word += static_cast<char>('a' + uniform_int_distribution<int>(0, 25)(rng));
+        }
+        return word;
+    };
+    auto knownOrNot = [&]() // searches find a word about half of the time
+    { return (!words.empty() && rng() % 2 == 0) ? pick(words) : randomWord(); };
+
+    ostringstream script;
+    script << "8\n"
+           << vocabFile << '\n';
+    uniform_int_distribution<int> percent(0, 99);
+    for (size_t n = 0; n < commands; ++n)
+    {
+        int roll = percent(rng);
+        if (names.empty() || roll < 30) // search every category (most common, and cheap)
+        {
+            script << "a\n"
+                   << knownOrNot() << '\n';
+        }
+        else if (roll < 65) // a burst of appends inside a category, then a search there
+        {
+            script << "5\n"
+                   << pick(names) << "\n2\n";
+            size_t burst = uniform_int_distribution<size_t>(1, 20)(rng);
+            for (size_t i = 0; i < burst; ++i)
+            {
+                script << randomWord() << '\n';
+            }
+            script << "exit\n6\n"
+                   << knownOrNot() << "\n0\n";
+        }
+        else if (roll < 80) // the sorted view of one category
+        {
+            script << "5\n"
+                   << pick(names) << "\n7\n0\n";
+        }
+        else if (roll < 85) // every word sorted
+        {
+            script << "6\n";
+        }
+        else if (roll < 95)
+        {
+            script << "d\n";
+        }
+        else
+        {
+            script << "9\n"
+                   << saveFile << '\n';
+        }
+    }
+    script << "0\n";
+    return script.str();
+}
+
+// Nearest-rank percentile of sorted latencies, in microseconds.
+static double percentile(const vector<uint64_t> &sorted, double p)
+{
+    size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+    return sorted[rank == 0 ? 0 : rank - 1] / 1000.0;
+}
+
+SessionReplay::Report SessionReplay::replay(const string &script, size_t repeats, const string &saveFile)
+{
+    samples.clear();
+    Report report;
+    NullBuffer sink;
+    auto start = chrono::steady_clock::now();
+    for (size_t r = 0; r < repeats; ++r)
+    {
+        if (!saveFile.empty())
+        {
+            remove(saveFile.c_str()); // saves append : without this the file, and the time to save it, would grow run after run
+        }
+        istringstream keystrokes(script);
+        streambuf *keyboard = cin.rdbuf(keystrokes.rdbuf()); // the menus read the script...
+        streambuf *screen = cout.rdbuf(&sink);                // ...and print to nowhere
+        {
+            WordCatVec word_cat_vec;
+            word_cat_vec.setCommandObserver([&](const char *menu, char option, chrono::nanoseconds elapsed)
+                                            {
+                samples[string(menu) + ':' + option].push_back(elapsed.count());
+                ++report.commandCount; });
+            word_cat_vec.run();
+        }
+        cout.flush();
+        cout.rdbuf(screen);
+        cin.rdbuf(keyboard);
+        cin.clear(); // the script may end with the end of input
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report.outputBytes = sink.bytes();
+    for (auto &entry : samples)
+    {
+        vector<uint64_t> &latencies = entry.second;
+        sort(latencies.begin(), latencies.end());
+        CommandLatency latency;
+        latency.command = entry.first;
+        latency.count = latencies.size();
+        latency.p50 = percentile(latencies, 0.50);
+        latency.p95 = percentile(latencies, 0.95);
+        latency.p99 = percentile(latencies, 0.99);
+        report.commands.push_back(latency);
+    }
+    return report;
+}
+
+double SessionReplay::Report::commandsPerSecond() const { return seconds > 0 ? commandCount / seconds : 0; }
+
+void SessionReplay::Report::write(ostream &sout) const
+{
+    sout << left << setw(14) << "command" << right << setw(8) << "count" << setw(12) << "p50 (us)" << setw(12) << "p95 (us)" << setw(12) << "p99 (us)" << '\n';
+    sout << fixed << setprecision(1);
+    for (const auto &latency : commands)
+    {
+        sout << left << setw(14) << latency.command << right << setw(8) << latency.count << setw(12) << latency.p50 << setw(12) << latency.p95 << setw(12) << latency.p99 << '\n';
+    }
+    sout << commandCount << " commands in " << setprecision(3) << seconds << " s (" << setprecision(0) << commandsPerSecond() << " commands/s), "
+         << outputBytes << " bytes of output\n";
+    sout.unsetf(ios::floatfield);
+    sout << setprecision(6);
+}
+
+bool SessionReplay::Report::save(const string &filename) const
+{
+    ofstream out(filename);
+    if (!out)
+    {
+        cerr << "Error opening file for writing: " << filename << '\n';
+        return false;
+    }
+    out << "# session baseline: commands seconds, then command count p50 p95 p99 (microseconds)\n";
+    out << commandCount << ' ' << seconds << '\n';
+    for (const auto &latency : commands)
+    {
+        out << latency.command << ' ' << latency.count << ' ' << latency.p50 << ' ' << latency.p95 << ' ' << latency.p99 << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+bool SessionReplay::Report::load(const string &filename, Report &report)
+{
+    ifstream in(filename);
+    string header;
+    if (!in || !getline(in, header) || header.rfind("# session baseline", 0) != 0)
+    {
+        return false;
+    }
+    report = Report();
+    if (!(in >> report.commandCount >> report.seconds))
+    {
+        return false;
+    }
+    CommandLatency latency;
+    while (in >> latency.command >> latency.count >> latency.p50 >> latency.p95 >> latency.p99)
+    {
+        report.commands.push_back(latency);
+    }
+    return true;
+}
+
+size_t SessionReplay::compare(const Report &current, const Report &baseline, ostream &sout, double tolerance, double minimumMicros)
+{
+    size_t regressions = 0;
+    auto slower = [&](double now, double before)
+    { return now > before * (1 + tolerance) && now - before > minimumMicros; };
+    for (const auto &latency : current.commands)
+    {
+        auto before = find_if(baseline.commands.begin(), baseline.commands.end(), [&](const CommandLatency &b)
+                              { return b.command == latency.command; });
+        if (before == baseline.commands.end())
+        {
+            continue; // not in the baseline's session : nothing to compare with
+        }
+        if (slower(latency.p50, before->p50) || slower(latency.p95, before->p95))
+        {
+            sout << "REGRESSION " << latency.command << ": p50 " << before->p50 << " -> " << latency.p50
+                 << " us, p95 " << before->p95 << " -> " << latency.p95 << " us\n";
+            ++regressions;
+        }
+    }
+    double before = baseline.commandsPerSecond(), now = current.commandsPerSecond();
+    if (before > 0 && now < before / (1 + tolerance))
+    {
+        sout << "REGRESSION throughput: " << before << " -> " << now << " commands/s\n";
+        ++regressions;
+    }
+    return regressions;
+}
@@ -0,0 +1,123 @@
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @class SessionReplay
+ * @brief Records, generates and replays keystroke-level sessions of the menus, timing every command.
+ *
+ * A session script is exactly what a user types: menu choices, names and words, one per line.
+ * Replaying feeds the script to WordCatVec::run() through std::cin with std::cout thrown away,
+ * so the commands go through the same handleOption code as an interactive session, at full speed.
+ * Every command's latency is collected per menu option (eg. "WordCat:2" for appends inside a
+ * category), and the percentiles can be saved as a baseline and compared with later runs.
+ */
+class SessionReplay
+{
+public:
+    /**
+     * @brief The latency of one menu option over a replay, in microseconds.
+     */
+    struct CommandLatency
+    {
+        std::string command; ///< Menu and option, eg. "WordCatVec:a".
+        size_t count = 0;    ///< Number of times the command ran.
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+    };
+
+    /**
+     * @brief The result of a replay (or a baseline read back from a file).
+     */
+    struct Report
+    {
+        std::vector<CommandLatency> commands; ///< One entry per menu option, by name.
+        size_t commandCount = 0;              ///< Number of commands run.
+        double seconds = 0;                   ///< Wall time of the whole replay.
+        uint64_t outputBytes = 0;             ///< Bytes the menus printed (and were thrown away).
+
+        /**
+         * @brief Returns the number of commands run per second.
+         * @return The throughput.
+         */
+        double commandsPerSecond() const;
+
+        /**
+         * @brief Prints the report as a table.
+         * @param sout The output stream.
+         */
+        void write(std::ostream &sout) const;
+
+        /**
+         * @brief Saves the report as a baseline to compare later runs with.
+         * @param filename The file to write.
+         * @return False if the file cannot be written.
+         */
+        bool save(const std::string &filename) const;
+
+        /**
+         * @brief Reads a baseline saved by save.
+         * @param filename The file to read.
+         * @param report Receives the baseline.
+         * @return False if the file cannot be read or is not a baseline.
+         */
+        static bool load(const std::string &filename, Report &report);
+    };
+
+private:
+    class TeeBuffer;  ///< Reads from another buffer and copies what was read to a stream, defined in SessionReplay.cpp.
+    class NullBuffer; ///< Counts and discards output, defined in SessionReplay.cpp.
+
+    std::map<std::string, std::vector<uint64_t>> samples; ///< command -> the latency of each run, in nanoseconds.
+
+public:
+    /**
+     * @brief Runs an interactive session, saving everything typed to a script.
+     * @param scriptFile The file to write the script to.
+     * @return False if the file cannot be written.
+     */
+    static bool record(const std::string &scriptFile);
+
+    /**
+     * @brief Generates a session typical of real use: loading a file, bursts of appends inside
+     * categories, searches (of words that exist and words that do not), sorted views,
+     * statistics and saves.
+     * @param vocabFile The vocabulary file the session loads, and takes category names and words from.
+     * @param commands The number of top-level commands, not counting the load and the exit.
+     * @param seed Seed of the random choices, so a script can be generated again identically.
+     * @param saveFile The file the session's saves append to.
+     * @return The script, or an empty string if vocabFile cannot be read.
+     */
+    static std::string generate(const std::string &vocabFile, size_t commands, uint32_t seed, const std::string &saveFile);
+
+    /**
+     * @brief Replays a script against a new WordCatVec, several times, and reports the latencies.
+     * @param script The keystrokes.
+     * @param repeats The number of times to replay it; the latencies of all runs are pooled.
+     * @param saveFile The file the script's saves append to (see generate), removed before each run
+     * so that every run saves to the same empty file (empty: none).
+     * @return The latencies of each command and the throughput.
+     */
+    Report replay(const std::string &script, size_t repeats = 1, const std::string &saveFile = "");
+
+    /**
+     * @brief Lists the commands that got slower than in a baseline.
+     * A command is flagged when its p50 or p95 grew by more than tolerance and by more than
+     * minimumMicros (so that commands taking a few microseconds do not flag noise).
+     * @param current The new report.
+     * @param baseline The baseline.
+     * @param sout Where to print the regressions.
+     * @param tolerance Allowed relative growth, eg. 0.2 for 20%.
+     * @param minimumMicros Allowed absolute growth in microseconds.
+     * @return The number of regressions (including a drop in throughput).
+     */
+    static size_t compare(const Report &current, const Report &baseline, std::ostream &sout, double tolerance = 0.2, double minimumMicros = 20);
+};
+
+#endif // SESSIONREPLAY_H
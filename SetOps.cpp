@@ -0,0 +1,174 @@
+#include "SetOps.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+using namespace std;
+
+bool SetOps::preferGallop(size_t small, size_t large)
+{
+    // merging costs about small + large comparisons, galloping about small * log2(large / small) * 2
+    if (small == 0)
+    {
+        return true;
+    }
+    double ratio = static_cast<double>(large) / small;
+    return small * 2.0 * (log2(ratio) + 1) < static_cast<double>(small + large);
+}
+
+size_t SetOps::gallop(const vector<string> &run, size_t from, const string &word)
+{
+    // double the step until we pass word, then binary search in the last step
+    size_t step = 1, lo = from, hi = from;
+    while (hi < run.size() && run[hi] < word)
+    {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    hi = min(hi, run.size());
+    return static_cast<size_t>(lower_bound(run.begin() + lo, run.begin() + hi, word) - run.begin());
+}
+
+vector<string> SetOps::intersect(const vector<string> &a, const vector<string> &b)
+{
+    vector<string> result;
+    const vector<string> &small = (a.size() <= b.size()) ? a : b;
+    const vector<string> &large = (a.size() <= b.size()) ? b : a;
+    if (preferGallop(small.size(), large.size()))
+    {
+        size_t pos = 0;
+        for (const auto &word : small)
+        {
+            pos = gallop(large, pos, word);
+            if (pos == large.size())
+            {
+                break;
+            }
+            if (large[pos] == word)
+            {
+                result.push_back(word);
+            }
+        }
+        return result;
+    }
+    set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(result));
+    return result;
+}
+
+vector<string> SetOps::subtract(const vector<string> &a, const vector<string> &b)
+{
+    vector<string> result;
+    if (a.size() < b.size() && preferGallop(a.size(), b.size())) // few words to check against a big run
+    {
+        size_t pos = 0;
+        for (const auto &word : a)
+        {
+            pos = gallop(b, pos, word);
+            if (pos == b.size() || b[pos] != word)
+            {
+                result.push_back(word);
+            }
+        }
+        return result;
+    }
+    if (b.size() < a.size() && preferGallop(b.size(), a.size())) // few words to remove from a big run : copy the gaps between them
+    {
+        size_t pos = 0;
+        for (const auto &word : b)
+        {
+            size_t found = gallop(a, pos, word);
+            result.insert(result.end(), a.begin() + pos, a.begin() + found);
+            pos = (found < a.size() && a[found] == word) ? found + 1 : found;
+        }
+        result.insert(result.end(), a.begin() + pos, a.end());
+        return result;
+    }
+    set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(result));
+    return result;
+}
+
+void SetOps::apply(Operation op, const vector<const vector<string> *> &runs, const Emit &emit)
+{
+    if (runs.empty())
+    {
+        return;
+    }
+    if (op == Intersection || op == Difference)
+    {
+        vector<string> result;
+        if (op == Intersection)
+        {
+            vector<const vector<string> *> bySize(runs);
+            sort(bySize.begin(), bySize.end(), [](const vector<string> *a, const vector<string> *b)
+                 { return a->size() < b->size(); });
+            result = *bySize[0]; // start from the smallest run, the result only shrinks
+            for (size_t i = 1; i < bySize.size() && !result.empty(); ++i)
+            {
+                result = intersect(result, *bySize[i]);
+            }
+        }
+        else
+        {
+            result = *runs[0];
+            for (size_t i = 1; i < runs.size() && !result.empty(); ++i)
+            {
+                result = subtract(result, *runs[i]);
+            }
+        }
+        for (const auto &word : result)
+        {
+            emit(word);
+        }
+        return;
+    }
+
+    // union and symmetric difference : one k-way merge, counting in how many runs each word is
+    using Cursor = pair<const string *, size_t>; // (current word, run index)
+    auto greater = [](const Cursor &a, const Cursor &b)
+    { return *a.first > *b.first; };
+    priority_queue<Cursor, vector<Cursor>, decltype(greater)> heap(greater);
+    vector<size_t> positions(runs.size(), 0);
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        if (!runs[r]->empty())
+        {
+            heap.emplace(&(*runs[r])[0], r);
+        }
+    }
+    while (!heap.empty())
+    {
+        string word = *heap.top().first;
+        size_t copies = 0;
+        while (!heap.empty() && *heap.top().first == word) // pop every run currently at this word
+        {
+            size_t r = heap.top().second;
+            heap.pop();
+            ++copies;
+            if (++positions[r] < runs[r]->size())
+            {
+                heap.emplace(&(*runs[r])[positions[r]], r);
+            }
+        }
+        if (op == Union || copies % 2 == 1)
+        {
+            emit(word);
+        }
+    }
+}
+
+bool SetOps::parse(const string &name, Operation &op)
+{
+    string lower(name);
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "u" || lower == "union")
+        op = Union;
+    else if (lower == "i" || lower == "intersection")
+        op = Intersection;
+    else if (lower == "d" || lower == "difference")
+        op = Difference;
+    else if (lower == "s" || lower == "symmetric" || lower == "symmetric difference")
+        op = SymmetricDifference;
+    else
+        return false;
+    return true;
+}
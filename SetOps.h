@@ -0,0 +1,85 @@
+#ifndef SETOPS_H
+#define SETOPS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @class SetOps
+ * @brief Set operations over sorted runs of words (sorted, no duplicates).
+ *
+ * Two runs of similar size are combined with a linear merge. When one run is
+ * much smaller than the other, each of its words is found in the big run with
+ * a galloping (exponential) search instead, so the cost depends on the small run.
+ */
+class SetOps
+{
+public:
+    /**
+     * @brief The supported operations.
+     */
+    enum Operation
+    {
+        Union,              ///< Words in at least one run.
+        Intersection,       ///< Words in every run.
+        Difference,         ///< Words in the first run and in none of the others.
+        SymmetricDifference ///< Words in an odd number of runs.
+    };
+
+    /**
+     * @brief Callback receiving the result words, in sorted order.
+     */
+    using Emit = std::function<void(const std::string &)>;
+
+    /**
+     * @brief Combines any number of sorted runs, streaming the result in sorted order.
+     * @param op The operation to apply.
+     * @param runs The sorted runs, in order (the order matters for Difference).
+     * @param emit Called with each word of the result.
+     */
+    static void apply(Operation op, const std::vector<const std::vector<std::string> *> &runs, const Emit &emit);
+
+    /**
+     * @brief Returns true if a galloping search is expected to beat a linear merge.
+     * @param small The size of the smaller run.
+     * @param large The size of the larger run.
+     * @return True if galloping is cheaper.
+     */
+    static bool preferGallop(size_t small, size_t large);
+
+    /**
+     * @brief Finds the first position at or after from where run[position] >= word, galloping from from.
+     * @param run The sorted run to search.
+     * @param from Where to start searching.
+     * @param word The word to look for.
+     * @return The first position at or after from whose word is not less than word.
+     */
+    static size_t gallop(const std::vector<std::string> &run, size_t from, const std::string &word);
+
+    /**
+     * @brief Intersects two sorted runs, with a merge or galloping search (whichever is cheaper).
+     * @param a The first run.
+     * @param b The second run.
+     * @return The words in both runs.
+     */
+    static std::vector<std::string> intersect(const std::vector<std::string> &a, const std::vector<std::string> &b);
+
+    /**
+     * @brief Removes the words of one sorted run from another, with a merge or galloping search.
+     * @param a The run to remove words from.
+     * @param b The words to remove.
+     * @return The words of a that are not in b.
+     */
+    static std::vector<std::string> subtract(const std::vector<std::string> &a, const std::vector<std::string> &b);
+
+    /**
+     * @brief Parses an operation name ("union", "intersection", "difference", "symmetric", or u/i/d/s).
+     * @param name The name to parse.
+     * @param op Receives the operation.
+     * @return False if the name is not an operation.
+     */
+    static bool parse(const std::string &name, Operation &op);
+};
+
+#endif // SETOPS_H
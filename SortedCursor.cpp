@@ -0,0 +1,89 @@
+#include "SortedCursor.h"
+#include <algorithm>
+using namespace std;
+
+SortedCursor::SortedCursor(vector<string_view> words, Less less, deque<string> owned) : words(move(words)), owned(move(owned)), less(less)
+{
+    total = this->words.size();
+    done.push_back(Done{total, total}); // nothing sorted yet : everything before the end is one unsorted range
+}
+
+SortedCursor::SortedCursor(size_t total, function<string(size_t)> fetch) : fetch(move(fetch)), total(total) {}
+
+string_view SortedCursor::take()
+{
+    while (true)
+    {
+        Done &top = done.back();
+        if (position >= top.end && done.size() > 1) // passed this range : the next one down the stack is nearer now
+        {
+            done.pop_back();
+            continue;
+        }
+        if (position >= top.begin)
+        {
+            break; // the word at position is in its final place
+        }
+        // three-way partition of the unsorted range [position, top.begin) around the median of three
+        size_t lo = position, hi = top.begin;
+        string_view a = words[lo], b = words[lo + (hi - lo) / 2], c = words[hi - 1];
+        string_view pivot = less(a, b) ? (less(b, c) ? b : (less(a, c) ? c : a)) : (less(a, c) ? a : (less(b, c) ? c : b));
+        size_t lt = lo, i = lo, gt = hi;
+        while (i < gt)
+        {
+            if (less(words[i], pivot))
+                swap(words[lt++], words[i++]);
+            else if (less(pivot, words[i]))
+                swap(words[i], words[--gt]);
+            else
+                ++i;
+        }
+        done.push_back(Done{lt, gt}); // the copies of the pivot are in place ; [lo, lt) and [gt, hi) are not sorted yet
+    }
+    return words[position++];
+}
+
+vector<string> SortedCursor::next(size_t count)
+{
+    vector<string> page;
+    count = min(count, total - position);
+    page.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (fetch)
+        {
+            page.push_back(fetch(position++));
+        }
+        else
+        {
+            page.emplace_back(take());
+        }
+    }
+    return page;
+}
+
+void SortedCursor::seek(size_t rank)
+{
+    rank = min(rank, total);
+    if (fetch || rank == position)
+    {
+        position = rank;
+        return;
+    }
+    if (rank < position) // everything before position is sorted already
+    {
+        done.push_back(Done{0, position});
+        position = rank;
+        return;
+    }
+    while (position < rank)
+    {
+        take();
+    }
+}
+
+size_t SortedCursor::getPosition() const { return position; }
+
+size_t SortedCursor::size() const { return total; }
+
+bool SortedCursor::atEnd() const { return position >= total; }
@@ -0,0 +1,163 @@
+#ifndef SORTEDCURSOR_H
+#define SORTEDCURSOR_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class SortedCursor
+ * @brief Hands out words in sorted order a page at a time, sorting only as far as it is asked to.
+ *
+ * Unsorted words are ordered with an incremental quicksort: each step partitions only the
+ * part that holds the next word, and the partitions are kept on a stack for the next pages.
+ * Getting the first k of n words costs O(n + k log k), and every later page continues from
+ * where the previous one stopped. Going back to an earlier page costs nothing, that part is
+ * already in its final order.
+ *
+ * Words that are sorted already (eg. a compressed category) are simply read by position.
+ */
+class SortedCursor
+{
+public:
+    /**
+     * @brief The order of the words.
+     */
+    using Less = bool (*)(std::string_view, std::string_view);
+
+private:
+    /**
+     * @brief A range of words already in their final position.
+     */
+    struct Done
+    {
+        size_t begin; ///< First position of the range.
+        size_t end;   ///< One past the last position of the range.
+    };
+
+    std::vector<std::string_view> words;           ///< The words being sorted (views, the cursor does not own them).
+    std::deque<std::string> owned;                 ///< Words some views point into, when there was no other place to keep them.
+    std::vector<Done> done;                        ///< Ranges in final position, nearest on top; between them : not sorted yet.
+    std::function<std::string(size_t)> fetch;      ///< For words sorted already : returns the word at a position.
+    Less less = nullptr;
+    size_t total = 0;
+    size_t position = 0;                           ///< Position of the next word handed out.
+
+    /**
+     * @brief Partitions until the word at position is in its final place, then returns it.
+     * @return The next word.
+     */
+    std::string_view take();
+
+public:
+    /**
+     * @brief Creates an empty cursor.
+     */
+    SortedCursor() = default;
+
+    /**
+     * @brief Creates a cursor over unsorted words.
+     * @param words Views of the words; they must stay valid as long as the cursor is used.
+     * @param less The order to hand the words out in.
+     * @param owned Strings some of the views point into, kept by the cursor (moving them does not move their characters).
+     */
+    SortedCursor(std::vector<std::string_view> words, Less less, std::deque<std::string> owned = {});
+
+    /**
+     * @brief Creates a cursor over words that are sorted already.
+     * @param total The number of words.
+     * @param fetch Returns the word at a position.
+     */
+    SortedCursor(size_t total, std::function<std::string(size_t)> fetch);
+
+    /**
+     * @brief Returns the next words in order and moves past them.
+     * @param count The maximum number of words to return.
+     * @return The words (fewer than count at the end).
+     */
+    std::vector<std::string> next(size_t count);
+
+    /**
+     * @brief Moves to a position, so that next starts from the word at that rank.
+     * @param rank The rank of the next word to hand out.
+     */
+    void seek(size_t rank);
+
+    /**
+     * @brief Returns the rank of the next word handed out.
+     * @return The position of the cursor.
+     */
+    size_t getPosition() const;
+
+    /**
+     * @brief Returns the number of words.
+     * @return The number of words.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Tells whether every word was handed out.
+     * @return True at the end.
+     */
+    bool atEnd() const;
+};
+
+/**
+ * @class CursorSlot
+ * @brief Holds the SortedCursor an object made over its own words, if it made one.
+ *
+ * The cursor points into the words of the object that made it (views, or a function reading
+ * them), so it must never follow a copy or a move of that object: copying or moving a slot
+ * leaves both slots empty, and each object makes a new cursor on first use. The cursor is
+ * kept behind a pointer, so moving a slot (and the object holding it) cannot throw.
+ */
+class CursorSlot
+{
+private:
+    std::unique_ptr<SortedCursor> cursor; ///< The cursor, or nullptr.
+
+public:
+    CursorSlot() = default;
+    CursorSlot(const CursorSlot &) noexcept {}
+    CursorSlot(CursorSlot &&other) noexcept { other.reset(); }
+    CursorSlot &operator=(const CursorSlot &) noexcept
+    {
+        reset();
+        return *this;
+    }
+    CursorSlot &operator=(CursorSlot &&other) noexcept
+    {
+        reset();
+        other.reset();
+        return *this;
+    }
+
+    /**
+     * @brief Tells whether there is no cursor (it must be made before it is used).
+     * @return True if there is none.
+     */
+    bool empty() const { return !cursor; }
+
+    /**
+     * @brief Keeps a new cursor, dropping the previous one.
+     * @param made The cursor.
+     */
+    void set(SortedCursor &&made) { cursor = std::make_unique<SortedCursor>(std::move(made)); }
+
+    /**
+     * @brief Returns the cursor (there must be one).
+     * @return The cursor.
+     */
+    SortedCursor &get() const { return *cursor; }
+
+    /**
+     * @brief Drops the cursor, eg. because the words it points into changed.
+     */
+    void reset() noexcept { cursor.reset(); }
+};
+
+#endif // SORTEDCURSOR_H
@@ -0,0 +1,331 @@
+#include "SpellChecker.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <deque>
+using namespace std;
+
+static const size_t BATCH = 64; // words looked up together : enough for their memory reads to overlap
+
+// A piece of the document, cut after a separator, and what the workers found in it.
+struct SpellChecker::Chunk
+{
+    /**
+     * @brief One word of the chunk (positions in the chunk, the document's are worked out when reporting).
+     */
+    struct Hit
+    {
+        uint32_t start;     ///< Offset in the chunk.
+        uint32_t length;
+        uint32_t line;      ///< Newlines before it in the chunk.
+        uint32_t lineStart; ///< Offset in the chunk where its line starts (when line > 0).
+        uint64_t slot;
+    };
+    uint64_t sequence = 0;   ///< Position among the chunks.
+    uint64_t offset = 0;     ///< Byte offset of the chunk in the document.
+    string storage;          ///< The text, when read from a file.
+    string_view text;        ///< The text.
+    vector<Hit> hits;        ///< The tokens to report, in order.
+    uint64_t tokens = 0;     ///< Every token, reported or not.
+    uint64_t unknown = 0;
+    uint32_t lines = 0;      ///< Newlines in the chunk.
+    uint32_t lastLineStart = 0; ///< Offset just after the last newline.
+    bool checked = false;
+};
+
+// wordChars[c] is true for the bytes that can be part of a word
+static array<bool, 256> makeWordChars()
+{
+    array<bool, 256> table{};
+    for (int c = 0; c < 256; ++c)
+    {
+        table[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '\'' || c >= 0x80;
+    }
+    return table;
+}
+static const array<bool, 256> wordChars = makeWordChars();
+
+SpellChecker::SpellChecker(const FrozenDictionary &dictionary) : dictionary(dictionary) {}
+
+SpellChecker::SpellChecker(const FrozenDictionary &dictionary, const Options &options) : dictionary(dictionary), options(options) {}
+
+void SpellChecker::checkChunk(Chunk &chunk) const
+{
+    const string_view text = chunk.text;
+    const size_t n = text.size();
+    uint32_t line = 0, lineStart = 0;
+    for (size_t i = 0; i < n;)
+    {
+        unsigned char c = text[i];
+        if (!wordChars[c])
+        {
+            if (c == '\n')
+            {
+                ++line;
+                lineStart = static_cast<uint32_t>(i + 1);
+            }
+            ++i;
+            continue;
+        }
+        size_t start = i;
+        while (i < n && wordChars[static_cast<unsigned char>(text[i])])
+        {
+            ++i;
+        }
+        size_t end = i;
+        while (start < end && text[start] == '\'') // quotes around a word are not part of it
+            ++start;
+        while (end > start && text[end - 1] == '\'')
+            --end;
+        if (start < end)
+        {
+            chunk.hits.push_back(Chunk::Hit{static_cast<uint32_t>(start), static_cast<uint32_t>(end - start), line, lineStart, FrozenDictionary::NOT_FOUND});
+        }
+    }
+    chunk.lines = line;
+    chunk.lastLineStart = lineStart;
+    chunk.tokens = chunk.hits.size();
+
+    // look the words up a batch at a time
+    string_view words[BATCH];
+    uint64_t slots[BATCH];
+    for (size_t first = 0; first < chunk.hits.size(); first += BATCH)
+    {
+        size_t count = min(BATCH, chunk.hits.size() - first);
+        for (size_t k = 0; k < count; ++k)
+        {
+            words[k] = text.substr(chunk.hits[first + k].start, chunk.hits[first + k].length);
+        }
+        dictionary.findSlots(words, count, slots);
+        for (size_t k = 0; k < count; ++k)
+        {
+            chunk.hits[first + k].slot = slots[k];
+        }
+    }
+
+    if (options.foldCase) // unknown words with capitals get a second chance in lowercase, batched the same way
+    {
+        vector<size_t> retry;
+        vector<string> lowered;
+        for (size_t h = 0; h < chunk.hits.size(); ++h)
+        {
+            const Chunk::Hit &hit = chunk.hits[h];
+            string_view word = text.substr(hit.start, hit.length);
+            if (hit.slot == FrozenDictionary::NOT_FOUND && any_of(word.begin(), word.end(), [](char ch)
+                                                                   { return ch >= 'A' && ch <= 'Z'; }))
+            {
+                string lower(word);
+                for (auto &ch : lower)
+                {
+                    if (ch >= 'A' && ch <= 'Z')
+                        ch = ch - 'A' + 'a';
+                }
+                retry.push_back(h);
+                lowered.push_back(move(lower));
+            }
+        }
+        for (size_t first = 0; first < retry.size(); first += BATCH)
+        {
+            size_t count = min(BATCH, retry.size() - first);
+            for (size_t k = 0; k < count; ++k)
+            {
+                words[k] = lowered[first + k];
+            }
+            dictionary.findSlots(words, count, slots);
+            for (size_t k = 0; k < count; ++k)
+            {
+                chunk.hits[retry[first + k]].slot = slots[k];
+            }
+        }
+    }
+
+    for (const auto &hit : chunk.hits)
+    {
+        chunk.unknown += hit.slot == FrozenDictionary::NOT_FOUND;
+    }
+    if (!options.reportKnown) // nothing to keep but the misspellings
+    {
+        chunk.hits.erase(remove_if(chunk.hits.begin(), chunk.hits.end(), [](const Chunk::Hit &hit)
+                                   { return hit.slot != FrozenDictionary::NOT_FOUND; }),
+                         chunk.hits.end());
+    }
+}
+
+void SpellChecker::report(const Chunk &chunk, uint64_t &line, uint64_t &column, const function<void(const Token &)> &emit, Summary &summary) const
+{
+    Token token;
+    for (const auto &hit : chunk.hits)
+    {
+        token.text = chunk.text.substr(hit.start, hit.length);
+        token.offset = chunk.offset + hit.start;
+        token.line = line + hit.line;
+        token.column = (hit.line == 0 ? column + hit.start : hit.start - hit.lineStart) + 1;
+        token.slot = hit.slot;
+        emit(token);
+    }
+    summary.bytes += chunk.text.size();
+    summary.tokens += chunk.tokens;
+    summary.unknown += chunk.unknown;
+    line += chunk.lines;
+    column = chunk.lines == 0 ? column + chunk.text.size() : chunk.text.size() - chunk.lastLineStart;
+}
+
+SpellChecker::Summary SpellChecker::checkText(string_view text, const function<void(const Token &)> &emit) const
+{
+    auto start = chrono::steady_clock::now();
+    Summary summary;
+    uint64_t line = 1, column = 0;
+    for (size_t offset = 0; offset < text.size();) // cut in chunks too : the positions of a hit are 32 bits
+    {
+        size_t size = min(options.chunkBytes, text.size() - offset);
+        if (offset + size < text.size())
+        {
+            size_t cut = size;
+            while (cut > 0 && wordChars[static_cast<unsigned char>(text[offset + cut - 1])])
+                --cut;
+            size = cut > 0 ? cut : size; // no separator at all : split the (huge) word
+        }
+        Chunk chunk;
+        chunk.offset = offset;
+        chunk.text = text.substr(offset, size);
+        checkChunk(chunk);
+        report(chunk, line, column, emit, summary);
+        offset += size;
+    }
+    summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+bool SpellChecker::checkFile(const string &filename, const function<void(const Token &)> &emit, Summary &summary) const
+{
+    ifstream in(filename, ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    auto start = chrono::steady_clock::now();
+    summary = Summary();
+    size_t workerCount = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    const size_t maxInFlight = 2 * workerCount + 1; // read ahead, but not the whole document
+
+    mutex stateMutex; // guards everything below
+    condition_variable changed;
+    map<uint64_t, unique_ptr<Chunk>> inFlight; // read and not reported yet, by sequence
+    deque<Chunk *> toCheck;                      // read and not checked yet
+    bool readDone = false;
+    uint64_t chunkCount = 0;
+
+    // the reader : big sequential reads, each chunk cut after its last separator, the rest carried to the next one
+    thread reader([&]()
+                  {
+        string carry;
+        uint64_t offset = 0;
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(stateMutex);
+                changed.wait(lock, [&]() { return inFlight.size() < maxInFlight; });
+            }
+            unique_ptr<Chunk> chunk(new Chunk());
+            chunk->storage = move(carry);
+            size_t kept = chunk->storage.size();
+            chunk->storage.resize(kept + options.chunkBytes);
+            in.read(&chunk->storage[kept], options.chunkBytes);
+            size_t size = kept + static_cast<size_t>(in.gcount());
+            chunk->storage.resize(size);
+            bool last = in.gcount() < static_cast<streamsize>(options.chunkBytes);
+            carry.clear();
+            if (!last)
+            {
+                size_t cut = size;
+                while (cut > 0 && wordChars[static_cast<unsigned char>(chunk->storage[cut - 1])])
+                    --cut;
+                if (cut > 0) // no separator at all : split the (huge) word
+                {
+                    carry.assign(chunk->storage, cut, string::npos);
+                    chunk->storage.resize(cut);
+                }
+            }
+            chunk->text = chunk->storage;
+            chunk->offset = offset;
+            offset += chunk->storage.size();
+            lock_guard<mutex> lock(stateMutex);
+            if (!chunk->storage.empty())
+            {
+                chunk->sequence = chunkCount++;
+                toCheck.push_back(chunk.get());
+                inFlight.emplace(chunk->sequence, move(chunk));
+            }
+            if (last)
+            {
+                readDone = true;
+            }
+            changed.notify_all();
+            if (last)
+            {
+                return;
+            }
+        } });
+
+    // the workers : take the oldest chunk not checked yet
+    vector<thread> workers;
+    for (size_t w = 0; w < workerCount; ++w)
+    {
+        workers.emplace_back([&]()
+                             {
+            while (true)
+            {
+                Chunk *chunk;
+                {
+                    unique_lock<mutex> lock(stateMutex);
+                    changed.wait(lock, [&]() { return !toCheck.empty() || readDone; });
+                    if (toCheck.empty())
+                    {
+                        return;
+                    }
+                    chunk = toCheck.front();
+                    toCheck.pop_front();
+                }
+                checkChunk(*chunk); // no lock : nobody else touches this chunk until it is marked checked
+                lock_guard<mutex> lock(stateMutex);
+                chunk->checked = true;
+                changed.notify_all();
+            } });
+    }
+
+    // this thread : report the chunks in document order as soon as each one is checked
+    uint64_t line = 1, column = 0;
+    for (uint64_t sequence = 0;; ++sequence)
+    {
+        unique_ptr<Chunk> chunk;
+        {
+            unique_lock<mutex> lock(stateMutex);
+            changed.wait(lock, [&]()
+                         {
+                auto found = inFlight.find(sequence);
+                return (found != inFlight.end() && found->second->checked) || (readDone && sequence == chunkCount); });
+            auto found = inFlight.find(sequence);
+            if (found == inFlight.end())
+            {
+                break; // every chunk was reported
+            }
+            chunk = move(found->second);
+            inFlight.erase(found);
+            changed.notify_all(); // room for the reader to read ahead
+        }
+        report(*chunk, line, column, emit, summary);
+    }
+    reader.join();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
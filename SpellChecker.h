@@ -0,0 +1,122 @@
+#ifndef SPELLCHECKER_H
+#define SPELLCHECKER_H
+
+#include "FrozenDictionary.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class SpellChecker
+ * @brief Checks the words of a (large) text document against a frozen dictionary, streaming.
+ *
+ * The document is read in large chunks on one thread, cut at the last separator so no word
+ * is split between two chunks. Worker threads tokenize the chunks with a character table and
+ * look the words up in batches (FrozenDictionary::findSlots), while the calling thread reports
+ * the tokens chunk by chunk in document order. Only a few chunks are in memory at once, however
+ * large the document is.
+ *
+ * A word is made of letters, digits, apostrophes inside it and any non-ASCII byte (so UTF-8 letters
+ * stay in words). A word that is not in the dictionary as written is looked up again in lowercase
+ * (eg. "The" at the start of a sentence).
+ */
+class SpellChecker
+{
+public:
+    /**
+     * @brief One word of the document.
+     */
+    struct Token
+    {
+        std::string_view text; ///< The word as written (only valid during the call to emit).
+        uint64_t offset = 0;   ///< Byte offset in the document.
+        uint64_t line = 0;     ///< Line number, from 1.
+        uint64_t column = 0;   ///< Byte column in the line, from 1.
+        uint64_t slot = FrozenDictionary::NOT_FOUND; ///< The word's slot in the dictionary, or NOT_FOUND if it is unknown.
+
+        /**
+         * @brief Tells whether the word is in the dictionary.
+         * @return True if it was found.
+         */
+        bool known() const { return slot != FrozenDictionary::NOT_FOUND; }
+    };
+
+    /**
+     * @brief How to check.
+     */
+    struct Options
+    {
+        size_t chunkBytes = 1 << 20; ///< Bytes read at a time (under 2 GB).
+        size_t threads = 0;          ///< Worker threads (0 for one per core).
+        bool reportKnown = true;     ///< False to only emit unknown tokens (known ones are still counted).
+        bool foldCase = true;        ///< Look unknown words up again in lowercase.
+    };
+
+    /**
+     * @brief What a check found.
+     */
+    struct Summary
+    {
+        uint64_t bytes = 0;   ///< Bytes of the document.
+        uint64_t tokens = 0;  ///< Words in the document.
+        uint64_t unknown = 0; ///< Words not in the dictionary.
+        double seconds = 0;   ///< Wall time of the check.
+    };
+
+private:
+    const FrozenDictionary &dictionary;
+    Options options;
+
+    struct Chunk;       ///< A piece of the document and its tokens, defined in SpellChecker.cpp.
+
+    /**
+     * @brief Tokenizes a chunk and looks up its words.
+     * @param chunk The chunk; receives its tokens, its number of lines and where its last line starts.
+     */
+    void checkChunk(Chunk &chunk) const;
+
+    /**
+     * @brief Emits the tokens of a checked chunk and adds up its counts.
+     * @param chunk The chunk.
+     * @param line The line the chunk starts on; moved to the line the next chunk starts on.
+     * @param column Bytes between the start of that line and the start of the chunk; moved the same way.
+     * @param emit Called with each token.
+     * @param summary Receives the counts.
+     */
+    void report(const Chunk &chunk, uint64_t &line, uint64_t &column, const std::function<void(const Token &)> &emit, Summary &summary) const;
+
+public:
+    /**
+     * @brief Creates a checker with the default options.
+     * @param dictionary The words to accept; it must outlive the checker.
+     */
+    SpellChecker(const FrozenDictionary &dictionary);
+
+    /**
+     * @brief Creates a checker.
+     * @param dictionary The words to accept; it must outlive the checker.
+     * @param options How to check.
+     */
+    SpellChecker(const FrozenDictionary &dictionary, const Options &options);
+
+    /**
+     * @brief Checks a file.
+     * @param filename The document.
+     * @param emit Called with each token (or only unknown ones), in document order, on the calling thread.
+     * @param summary Receives the counts.
+     * @return False if the file cannot be read.
+     */
+    bool checkFile(const std::string &filename, const std::function<void(const Token &)> &emit, Summary &summary) const;
+
+    /**
+     * @brief Checks a text already in memory, on the calling thread.
+     * @param text The document.
+     * @param emit Called with each token (or only unknown ones), in document order.
+     * @return The counts.
+     */
+    Summary checkText(std::string_view text, const std::function<void(const Token &)> &emit) const;
+};
+
+#endif // SPELLCHECKER_H
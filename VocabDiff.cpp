@@ -0,0 +1,373 @@
+#include "VocabDiff.h"
+#include "WordCatVec.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+bool VocabDiff::Version::fromFile(const string &filename, Version &version)
+{
+    Version read;
+    if (!VocabFile::readAll(filename, read.contents))
+    {
+        return false;
+    }
+    read.isFile = true;
+    read.extents = VocabFile::scan(read.contents);
+    read.fileCategories = VocabFile::groupByName(read.contents, read.extents); // hashes every category's bytes, parses nothing
+    for (const auto &category : read.fileCategories)
+    {
+        read.byName.emplace(category.name, read.names.size());
+        read.names.push_back(category.name);
+        read.hashes.push_back(category.hash);
+    }
+    version = move(read);
+    return true;
+}
+
+VocabDiff::Version VocabDiff::Version::fromCategories(const WordCatVec &categories)
+{
+    Version version;
+    categories.forEachCategory([&](const WordCat &wc)
+                               {
+        auto found = version.byName.emplace(wc.getCatName(), version.names.size());
+        if (found.second)
+        {
+            version.names.push_back(wc.getCatName());
+            version.hashes.push_back(0);
+            version.loaded.emplace_back();
+        }
+        size_t index = found.first->second;
+        version.loaded[index].push_back(&wc);
+        version.hashes[index] += wc.contentHash(); // cached by the category until it is edited; the sum keeps it order-free
+    });
+    return version;
+}
+
+size_t VocabDiff::Version::size() const { return names.size(); }
+
+const string &VocabDiff::Version::name(size_t index) const { return names[index]; }
+
+bool VocabDiff::Version::find(const string &name, size_t &index) const
+{
+    auto found = byName.find(name);
+    if (found == byName.end())
+    {
+        return false;
+    }
+    index = found->second;
+    return true;
+}
+
+void VocabDiff::Version::forEachWord(size_t index, const function<void(const string &)> &visit) const
+{
+    if (isFile)
+    {
+        VocabFile::forEachWordOf(contents, fileCategories[index], visit);
+        return;
+    }
+    string word;
+    for (const WordCat *wc : loaded[index])
+    {
+        wc->forEachWord([&](string_view view)
+                        {
+            word.assign(view.data(), view.size());
+            visit(word); });
+    }
+}
+
+void VocabDiff::Version::writeWords(size_t index, ostream &out) const
+{
+    if (isFile) // the word lines as they are in the file : no need to parse them
+    {
+        for (const auto *extent : fileCategories[index].extents)
+        {
+            out.write(contents.data() + extent->offset, extent->length);
+            if (extent->length > 0 && contents[extent->offset + extent->length - 1] != '\n')
+            {
+                out << '\n';
+            }
+        }
+        return;
+    }
+    forEachWord(index, [&](const string &word)
+                { out << word << '\n'; });
+}
+
+bool VocabDiff::Version::sameWords(size_t index, const Version &other, size_t otherIndex) const
+{
+    if (isFile == other.isFile) // a collision is not worth guarding against here
+    {
+        return hashes[index] == other.hashes[otherIndex]; // (two files: the same words in another order count as a change)
+    }
+    return wordsHash(index) == other.wordsHash(otherIndex); // a file's hash is of its bytes : hash its words like a loaded category's
+}
+
+uint64_t VocabDiff::Version::wordsHash(size_t index) const
+{
+    if (!isFile)
+    {
+        return hashes[index];
+    }
+    if (wordHashes.empty())
+    {
+        wordHashes.assign(size(), 0);
+        for (size_t i = 0; i < size(); ++i)
+        {
+            forEachWord(i, [&](const string &word)
+                        { wordHashes[i] += WordCat::contentHashOf(word); });
+        }
+    }
+    return wordHashes[index];
+}
+
+// the words of a category, counted
+static unordered_map<string, long> countWords(const VocabDiff::Version &version, size_t index)
+{
+    unordered_map<string, long> counts;
+    version.forEachWord(index, [&](const string &word)
+                        { ++counts[word]; });
+    return counts;
+}
+
+vector<VocabDiff::CategoryChange> VocabDiff::diff(const Version &before, const Version &after, size_t &unchanged)
+{
+    vector<CategoryChange> changes;
+    unchanged = 0;
+    for (size_t i = 0; i < after.size(); ++i)
+    {
+        CategoryChange change;
+        change.name = after.name(i);
+        size_t was;
+        if (!before.find(change.name, was))
+        {
+            change.kind = CategoryChange::Added;
+            after.forEachWord(i, [&](const string &word)
+                              { change.added.push_back(word); });
+            changes.push_back(move(change));
+            continue;
+        }
+        if (before.sameWords(was, after, i)) // O(1) for most categories : the hashes match
+        {
+            ++unchanged;
+            continue;
+        }
+        // match the new words against the old ones : what is left on either side is the diff
+        unordered_map<string, long> old = countWords(before, was);
+        after.forEachWord(i, [&](const string &word)
+                          {
+            auto match = old.find(word);
+            if (match != old.end() && match->second > 0)
+            {
+                --match->second;
+                return;
+            }
+            change.added.push_back(word); });
+        before.forEachWord(was, [&](const string &word) // in the old order
+                           {
+            auto left = old.find(word);
+            if (left->second > 0)
+            {
+                --left->second;
+                change.removed.push_back(word);
+            } });
+        if (change.added.empty() && change.removed.empty()) // same words, in another order
+        {
+            ++unchanged;
+            continue;
+        }
+        changes.push_back(move(change));
+    }
+    for (size_t i = 0; i < before.size(); ++i)
+    {
+        size_t now;
+        if (!after.find(before.name(i), now))
+        {
+            CategoryChange change;
+            change.kind = CategoryChange::Removed;
+            change.name = before.name(i);
+            before.forEachWord(i, [&](const string &word)
+                               { change.removed.push_back(word); });
+            changes.push_back(move(change));
+        }
+    }
+    return changes;
+}
+
+void VocabDiff::write(const vector<CategoryChange> &changes, ostream &sout)
+{
+    for (const auto &change : changes)
+    {
+        switch (change.kind)
+        {
+        case CategoryChange::Added:
+            sout << "+#" << change.name << " (" << change.added.size() << " words)\n";
+            break;
+        case CategoryChange::Removed:
+            sout << "-#" << change.name << " (" << change.removed.size() << " words)\n";
+            break;
+        case CategoryChange::Changed:
+            sout << " #" << change.name << " (+" << change.added.size() << " -" << change.removed.size() << ")\n";
+            for (const auto &word : change.removed)
+            {
+                sout << "-" << word << '\n';
+            }
+            for (const auto &word : change.added)
+            {
+                sout << "+" << word << '\n';
+            }
+            break;
+        }
+    }
+}
+
+bool VocabDiff::merge(const Version &base, const Version &ours, const Version &theirs, const string &filename, MergeReport &report)
+{
+    // the merge goes to a temporary file renamed over the target once it is complete, as the autosaver does :
+    // the target may be one of the versions being merged, and a failed merge must not leave half a file
+    string temporary = filename + ".tmp";
+    ofstream out(temporary, ios::binary | ios::trunc);
+    if (!out)
+    {
+        cerr << "Error opening file for writing: " << temporary << '\n';
+        return false;
+    }
+    report = MergeReport();
+
+    // every category name: ours' order, then the ones only theirs has, then the ones only base still has
+    vector<string> names;
+    unordered_map<string, bool> seen;
+    for (const Version *version : {&ours, &theirs, &base})
+    {
+        for (size_t i = 0; i < version->size(); ++i)
+        {
+            if (seen.emplace(version->name(i), true).second)
+            {
+                names.push_back(version->name(i));
+            }
+        }
+    }
+
+    for (const auto &name : names)
+    {
+        size_t b, o, t;
+        bool inBase = base.find(name, b), inOurs = ours.find(name, o), inTheirs = theirs.find(name, t);
+        // same(x, y): both sides have the category with the same words, or neither has it
+        auto sameAs = [](const Version &x, bool inX, size_t ix, const Version &y, bool inY, size_t iy)
+        { return inX == inY && (!inX || x.sameWords(ix, y, iy)); };
+
+        const Version *take = nullptr; // the whole category comes from one side (nullptr : it was removed)
+        size_t takeIndex = 0;
+        bool decided = true;
+        if (sameAs(ours, inOurs, o, theirs, inTheirs, t)) // both sides agree (possibly both edited it the same way)
+        {
+            ++report.unchanged;
+            take = inOurs ? &ours : nullptr;
+            takeIndex = o;
+        }
+        else if (sameAs(base, inBase, b, ours, inOurs, o)) // only theirs changed it
+        {
+            ++report.fromTheirs;
+            take = inTheirs ? &theirs : nullptr;
+            takeIndex = t;
+        }
+        else if (sameAs(base, inBase, b, theirs, inTheirs, t)) // only ours changed it
+        {
+            ++report.fromOurs;
+            take = inOurs ? &ours : nullptr;
+            takeIndex = o;
+        }
+        else if (!inOurs || !inTheirs) // removed on one side, edited on the other : keep the edits
+        {
+            report.conflicts.push_back("#" + name + ": removed on one side and edited on the other, kept the edited one");
+            take = inOurs ? &ours : &theirs;
+            takeIndex = inOurs ? o : t;
+        }
+        else
+        {
+            decided = false;
+        }
+        if (decided)
+        {
+            if (take)
+            {
+                out << '#' << name << '\n';
+                take->writeWords(takeIndex, out);
+                out << '\n';
+            }
+            continue;
+        }
+
+        // changed on both sides : apply each side's change to every word's number of copies
+        ++report.merged;
+        unordered_map<string, long> countBase = inBase ? countWords(base, b) : unordered_map<string, long>();
+        unordered_map<string, long> countOurs = countWords(ours, o);
+        unordered_map<string, long> countTheirs = countWords(theirs, t);
+        unordered_map<string, long> target; // how many copies of each word the merge keeps
+        auto decide = [&](const string &word)
+        {
+            if (target.count(word))
+            {
+                return;
+            }
+            long inB = countBase.count(word) ? countBase[word] : 0;
+            long dOurs = (countOurs.count(word) ? countOurs[word] : 0) - inB;
+            long dTheirs = (countTheirs.count(word) ? countTheirs[word] : 0) - inB;
+            long keep;
+            if (dOurs == dTheirs || dTheirs == 0)
+                keep = inB + dOurs;
+            else if (dOurs == 0)
+                keep = inB + dTheirs;
+            else // both changed it, differently : keep the bigger change
+            {
+                keep = inB + (labs(dTheirs) > labs(dOurs) ? dTheirs : dOurs);
+                report.conflicts.push_back("#" + name + " \"" + word + "\": " + to_string(inB) + " copies in base, " + to_string(inB + dOurs) + " in ours, " + to_string(inB + dTheirs) + " in theirs, kept " + to_string(keep));
+            }
+            target[word] = keep;
+        };
+        for (const auto &entry : countOurs)
+            decide(entry.first);
+        for (const auto &entry : countTheirs)
+            decide(entry.first);
+        for (const auto &entry : countBase)
+            decide(entry.first);
+
+        // write ours' words in their order, then what only theirs brought, in theirs' order
+        out << '#' << name << '\n';
+        auto emit = [&](const string &word)
+        {
+            long &left = target[word];
+            if (left > 0)
+            {
+                --left;
+                out << word << '\n';
+            }
+        };
+        ours.forEachWord(o, emit);
+        theirs.forEachWord(t, emit);
+        out << '\n';
+    }
+    out.close();
+    if (!out)
+    {
+        cerr << "Error writing " << temporary << '\n';
+        remove(temporary.c_str());
+        return false;
+    }
+    int fd = ::open(temporary.c_str(), O_WRONLY);
+    if (fd >= 0)
+    {
+        ::fsync(fd); // on the disk before the rename makes it the target
+        ::close(fd);
+    }
+    if (rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        cerr << "Error renaming " << temporary << " to " << filename << '\n';
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
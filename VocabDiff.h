@@ -0,0 +1,181 @@
+#ifndef VOCABDIFF_H
+#define VOCABDIFF_H
+
+#include "VocabFile.h"
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class WordCat;
+class WordCatVec;
+
+/**
+ * @class VocabDiff
+ * @brief Compares two versions of a vocabulary, and merges two edited copies of a common one.
+ *
+ * Every category of a version has a hash: of its bytes for a file, of its words for loaded
+ * categories (cached until the category is edited). Categories with the same hash on both sides
+ * are skipped without looking at a single word, so only the categories that really changed are
+ * compared word by word. Words are compared as multisets: only how many copies of each word a
+ * category has matters, not their order.
+ */
+class VocabDiff
+{
+public:
+    /**
+     * @brief One version of a vocabulary: a file, or loaded categories.
+     */
+    class Version
+    {
+    private:
+        std::string contents;                         ///< The file's text (files only).
+        std::vector<CategoryExtent> extents;          ///< Where its categories are (files only).
+        std::vector<FileCategory> fileCategories;     ///< Its categories by name (files only).
+        std::vector<std::vector<const WordCat *>> loaded; ///< The categories with each name (loaded categories only).
+        std::vector<std::string> names;               ///< The category names, in order.
+        std::vector<uint64_t> hashes;                 ///< The hash of each category (of its bytes for a file, of its words otherwise).
+        mutable std::vector<uint64_t> wordHashes;     ///< For a file: the hash of each category's words, computed when compared with loaded categories.
+        std::unordered_map<std::string, size_t> byName;
+        bool isFile = false;
+
+        /**
+         * @brief Returns the hash of a category's words, the same for a file and for loaded categories.
+         * @param index The index of the category.
+         * @return WordCat::contentHash of the words.
+         */
+        uint64_t wordsHash(size_t index) const;
+
+    public:
+        Version() = default;
+        Version(const Version &) = delete; // fileCategories points into extents
+        Version &operator=(const Version &) = delete;
+        Version(Version &&) = default;     // moving a vector keeps its elements where they are
+        Version &operator=(Version &&) = default;
+
+        /**
+         * @brief Reads a vocabulary file.
+         * @param filename The file.
+         * @param version Receives the version.
+         * @return False if the file cannot be read.
+         */
+        static bool fromFile(const std::string &filename, Version &version);
+
+        /**
+         * @brief Takes the categories of a WordCatVec, which must not change while the version is used.
+         * @param categories The categories.
+         * @return The version.
+         */
+        static Version fromCategories(const WordCatVec &categories);
+
+        /**
+         * @brief Returns the number of categories (categories with the same name count once).
+         * @return The number of categories.
+         */
+        size_t size() const;
+
+        /**
+         * @brief Returns the name of a category.
+         * @param index The index of the category.
+         * @return The name.
+         */
+        const std::string &name(size_t index) const;
+
+        /**
+         * @brief Finds a category by name.
+         * @param name The name.
+         * @param index Receives the index of the category.
+         * @return False if there is no such category.
+         */
+        bool find(const std::string &name, size_t &index) const;
+
+        /**
+         * @brief Calls visit with every word of a category, in order.
+         * @param index The index of the category.
+         * @param visit Called with each word.
+         */
+        void forEachWord(size_t index, const std::function<void(const std::string &)> &visit) const;
+
+        /**
+         * @brief Writes a category's words, one per line.
+         * @param index The index of the category.
+         * @param out The output stream.
+         */
+        void writeWords(size_t index, std::ostream &out) const;
+
+        /**
+         * @brief Tells whether a category has the same words as a category of another version.
+         * O(1) when both versions are of the same kind; a file compared with loaded categories hashes the file's words once.
+         * @param index The index of the category.
+         * @param other The other version.
+         * @param otherIndex The index of the category in the other version.
+         * @return True if the words are the same.
+         */
+        bool sameWords(size_t index, const Version &other, size_t otherIndex) const;
+    };
+
+    /**
+     * @brief How one category differs between two versions.
+     */
+    struct CategoryChange
+    {
+        enum Kind
+        {
+            Added,   ///< Only in the new version.
+            Removed, ///< Only in the old version.
+            Changed  ///< In both, with different words.
+        };
+        Kind kind = Changed;
+        std::string name;
+        std::vector<std::string> added;   ///< Words (one entry per copy) only in the new version.
+        std::vector<std::string> removed; ///< Words (one entry per copy) only in the old version.
+    };
+
+    /**
+     * @brief What a three-way merge did.
+     */
+    struct MergeReport
+    {
+        size_t unchanged = 0;   ///< Categories the same on both sides.
+        size_t fromOurs = 0;    ///< Categories only changed (or removed) in ours.
+        size_t fromTheirs = 0;  ///< Categories only changed (or removed) in theirs.
+        size_t merged = 0;      ///< Categories changed on both sides, merged word by word.
+        std::vector<std::string> conflicts; ///< What could not be merged cleanly, and what was kept.
+    };
+
+    /**
+     * @brief Compares two versions.
+     * @param before The old version.
+     * @param after The new version.
+     * @param unchanged Receives the number of categories that did not change.
+     * @return The categories that changed, in the new version's order, then the removed ones.
+     */
+    static std::vector<CategoryChange> diff(const Version &before, const Version &after, size_t &unchanged);
+
+    /**
+     * @brief Prints a diff, one line per changed word.
+     * @param changes The diff.
+     * @param sout The output stream.
+     */
+    static void write(const std::vector<CategoryChange> &changes, std::ostream &sout);
+
+    /**
+     * @brief Merges two versions edited from a common base, and writes the result as a vocabulary file.
+     *
+     * A category changed on one side only is taken from that side. A category changed on both sides
+     * is merged word by word: each side's change to a word's number of copies is applied once
+     * (twice the same change counts once). Changes that disagree are conflicts; they are reported and
+     * the bigger change is kept (for a category removed on one side and edited on the other: the edited one).
+     * @param base The common version.
+     * @param ours One edited version (its category order is kept).
+     * @param theirs The other edited version.
+     * @param filename The file to write the merged vocabulary to (replaced if it exists).
+     * @param report Receives what was done.
+     * @return False if the file cannot be written.
+     */
+    static bool merge(const Version &base, const Version &ours, const Version &theirs, const std::string &filename, MergeReport &report);
+};
+
+#endif // VOCABDIFF_H
@@ -0,0 +1,263 @@
+#include "VocabFile.h"
+#include "BloomFilter.h"
+#include "Compression.h"
+#include "FileIO.h"
+#include "LineScanner.h"
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+// Turns a sequence of lines into category extents. Used both on text in memory and on chunks of a file.
+struct ExtentBuilder
+{
+    vector<CategoryExtent> &extents;
+    bool inWords = false; // true between a header and the first blank line after it
+
+    // line does not include its '\n' (nor a '\r' before it), next is the offset just after it
+    void feed(const char *line, size_t length, uint64_t next)
+    {
+        if (length > 0 && line[0] == '#') // a new category starts
+        {
+            CategoryExtent extent;
+            extent.name.assign(line + 1, length - 1);
+            extent.offset = next;
+            extents.push_back(move(extent));
+            inWords = true;
+        }
+        else if (inWords)
+        {
+            if (length == 0) // a blank line ends the words of the category
+            {
+                inWords = false;
+                return;
+            }
+            CategoryExtent &current = extents.back();
+            ++current.wordCount;
+            current.length = next - current.offset;
+        }
+    }
+};
+
+// Splits text arriving in blocks into lines, a line possibly spanning several blocks.
+// feed(line, length, next) is called like ExtentBuilder::feed, next counting from the start of the text.
+template <class Feed>
+static void splitBlock(string &carry, uint64_t &at, const char *data, size_t length, Feed &&feed)
+{
+    const char *end = data + length;
+    const char *lastNewline = static_cast<const char *>(memrchr(data, '\n', length));
+    if (!lastNewline) // the line goes on in the next block
+    {
+        carry.append(data, length);
+        at += length;
+        return;
+    }
+    string_view line;
+    const char *start = data;
+    if (!carry.empty()) // finish the line the last block cut
+    {
+        const char *newline = static_cast<const char *>(memchr(data, '\n', length));
+        carry.append(data, newline);
+        LineScanner rest(carry.data(), carry.data() + carry.size());
+        rest.next(line);
+        feed(line.data(), line.size(), at + static_cast<uint64_t>(newline + 1 - data));
+        carry.clear();
+        start = newline + 1;
+    }
+    // every complete line of the block in one go
+    LineScanner lines(start, lastNewline + 1);
+    while (lines.next(line))
+    {
+        feed(line.data(), line.size(), at + static_cast<uint64_t>(lines.position() - data));
+    }
+    carry.assign(lastNewline + 1, end);
+    at += length;
+}
+
+// the last line, if the text does not end with a newline
+template <class Feed>
+static void splitEnd(string &carry, uint64_t at, Feed &&feed)
+{
+    LineScanner last(carry.data(), carry.data() + carry.size());
+    string_view line;
+    if (last.next(line))
+    {
+        feed(line.data(), line.size(), at);
+    }
+    carry.clear();
+}
+
+bool VocabFile::readAll(const string &filename, string &contents)
+{
+    if (Compression::detectFile(filename) == Compression::None)
+    {
+        return FileIO::readAll(filename, contents); // several large reads in flight at once, straight into contents
+    }
+    DecompressingReader file(filename);
+    contents.clear();
+    const char *data;
+    size_t length;
+    while (file.next(data, length))
+    {
+        contents.append(data, length);
+    }
+    return file.isOpen() && !file.failed();
+}
+
+vector<CategoryExtent> VocabFile::scan(const string &contents)
+{
+    vector<CategoryExtent> extents;
+    ExtentBuilder builder{extents};
+    LineScanner lines(contents.data(), contents.data() + contents.size());
+    string_view line;
+    while (lines.next(line))
+    {
+        builder.feed(line.data(), line.size(), static_cast<uint64_t>(lines.position() - contents.data()));
+    }
+    return extents;
+}
+
+bool VocabFile::scanFile(const string &filename, vector<CategoryExtent> &extents)
+{
+    DecompressingReader file(filename); // the next blocks are read (and decompressed) while this one is scanned
+    if (!file.isOpen())
+    {
+        return false;
+    }
+    extents.clear();
+    ExtentBuilder builder{extents};
+    auto feed = [&](const char *line, size_t length, uint64_t next)
+    { builder.feed(line, length, next); };
+    string carry;
+    uint64_t at = 0;
+    const char *data;
+    size_t length;
+    while (file.next(data, length))
+    {
+        splitBlock(carry, at, data, length, feed);
+    }
+    if (file.failed())
+    {
+        return false;
+    }
+    splitEnd(carry, at, feed);
+    return true;
+}
+
+bool VocabFile::readExtent(const string &filename, const CategoryExtent &extent, string &text)
+{
+    if (Compression::detectFile(filename) == Compression::None)
+    {
+        // jump straight to the category, no need to read what comes before
+        return FileIO::readRange(filename, extent.offset, static_cast<size_t>(extent.length), text);
+    }
+    // a compressed file has no offsets to jump to : decompress up to the category, keeping only its bytes
+    DecompressingReader file(filename);
+    text.clear();
+    uint64_t at = 0, end = extent.offset + extent.length;
+    const char *data;
+    size_t length;
+    while (at < end && file.next(data, length))
+    {
+        uint64_t from = max(at, extent.offset), to = min(at + length, end);
+        if (from < to)
+        {
+            text.append(data + (from - at), static_cast<size_t>(to - from));
+        }
+        at += length;
+    }
+    return text.size() == extent.length;
+}
+
+void VocabFile::forEachWord(const char *begin, const char *end, const function<void(const string &)> &visit)
+{
+    string word;
+    LineScanner lines(begin, end);
+    string_view line;
+    while (lines.next(line))
+    {
+        word.assign(line.data(), line.size());
+        visit(word);
+    }
+}
+
+void VocabFile::appendWords(const char *begin, const char *end, WordList &words, VocabStats *stats)
+{
+    string word; // only for the statistics, which key their counts by string
+    LineScanner lines(begin, end);
+    string_view line;
+    while (lines.next(line))
+    {
+        words.emplace_back(line); // straight from the text into the list's arena
+        if (stats)
+        {
+            word.assign(line.data(), line.size());
+            stats->add(word);
+        }
+    }
+}
+
+vector<FileCategory> VocabFile::groupByName(const string &contents, const vector<CategoryExtent> &extents)
+{
+    vector<FileCategory> categories;
+    unordered_map<string, size_t> byName;
+    for (const auto &extent : extents)
+    {
+        auto found = byName.emplace(extent.name, categories.size());
+        if (found.second)
+        {
+            categories.push_back(FileCategory{extent.name, {}, 0});
+        }
+        FileCategory &category = categories[found.first->second];
+        category.extents.push_back(&extent);
+        uint64_t h = BloomFilter::hash(string_view(contents.data() + extent.offset, extent.length));
+        category.hash = category.hash * 0x100000001b3ULL ^ h; // order matters : moving words between two extents is a change
+    }
+    return categories;
+}
+
+void VocabFile::forEachWordOf(const string &contents, const FileCategory &category, const function<void(const string &)> &visit)
+{
+    for (const auto *extent : category.extents)
+    {
+        const char *begin = contents.data() + extent->offset;
+        forEachWord(begin, begin + extent->length, visit);
+    }
+}
+
+void VocabParser::line(const char *text, size_t length)
+{
+    if (length > 0 && text[0] == '#') // a new category starts
+    {
+        categories.emplace_back();
+        categories.back().name.assign(text + 1, length - 1);
+        inWords = true;
+    }
+    else if (inWords)
+    {
+        if (length == 0) // a blank line ends the words of the category
+        {
+            inWords = false;
+            return;
+        }
+        Category &current = categories.back();
+        current.words.emplace_back(string_view(text, length));
+        word.assign(text, length);
+        current.stats.add(word);
+    }
+}
+
+void VocabParser::feed(const char *data, size_t length)
+{
+    splitBlock(carry, at, data, length, [this](const char *text, size_t size, uint64_t)
+               { line(text, size); });
+}
+
+void VocabParser::finish()
+{
+    splitEnd(carry, at, [this](const char *text, size_t size, uint64_t)
+             { line(text, size); });
+}
+
+vector<VocabParser::Category> &VocabParser::getCategories() { return categories; }
@@ -0,0 +1,164 @@
+#ifndef VOCABFILE_H
+#define VOCABFILE_H
+
+#include "WordList.h"
+#include "VocabStats.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where one category's words are in a vocabulary file.
+ *
+ * A vocabulary file is a list of "#Category Name" header lines, each followed by
+ * one word per line until a blank line or the next header. Lines may end in "\n" or "\r\n".
+ */
+struct CategoryExtent
+{
+    std::string name;       ///< The category name (the header line without the #).
+    uint64_t offset = 0;    ///< Byte offset of the first word line (just after the header line).
+    uint64_t length = 0;    ///< Number of bytes of word lines, newlines included.
+    size_t wordCount = 0;   ///< Number of word lines.
+};
+
+/**
+ * @brief All the places one category name appears in a vocabulary file, with a hash of their bytes.
+ */
+struct FileCategory
+{
+    std::string name;                              ///< The category name.
+    std::vector<const CategoryExtent *> extents;   ///< Its extents, in file order (a name may appear more than once).
+    uint64_t hash = 0;                             ///< Hash of the bytes of the extents, in order.
+};
+
+/**
+ * @class VocabFile
+ * @brief Reads "#Category" vocabulary files: directory scans and word parsing.
+ */
+class VocabFile
+{
+public:
+    /**
+     * @brief Reads a whole file into memory (decompressed, if it is compressed).
+     * @param filename The name of the file to read.
+     * @param contents Receives the contents of the file.
+     * @return False if the file cannot be opened.
+     */
+    static bool readAll(const std::string &filename, std::string &contents);
+
+    /**
+     * @brief Builds the category directory of a vocabulary text already in memory.
+     * @param contents The text of a vocabulary file.
+     * @return One extent per header, in file order.
+     */
+    static std::vector<CategoryExtent> scan(const std::string &contents);
+
+    /**
+     * @brief Builds the category directory of a vocabulary file in one pass over large chunks,
+     * without keeping the file in memory. The offsets of a compressed file are in its decompressed text.
+     * @param filename The name of the file to scan.
+     * @param extents Receives one extent per header, in file order.
+     * @return False if the file cannot be opened.
+     */
+    static bool scanFile(const std::string &filename, std::vector<CategoryExtent> &extents);
+
+    /**
+     * @brief Reads the bytes of one category from a file.
+     * A compressed file is decompressed up to the category: slow, keep its categories in memory instead.
+     * @param filename The name of the file to read.
+     * @param extent Where the category is in the file.
+     * @param text Receives the word lines of the category.
+     * @return False if the file cannot be opened or is shorter than expected.
+     */
+    static bool readExtent(const std::string &filename, const CategoryExtent &extent, std::string &text);
+
+    /**
+     * @brief Calls visit for every word line in a block of word lines.
+     * @param begin The first character of the block.
+     * @param end One past the last character of the block.
+     * @param visit Called with each word.
+     */
+    static void forEachWord(const char *begin, const char *end, const std::function<void(const std::string &)> &visit);
+
+    /**
+     * @brief Adds every word line in a block of word lines to a list, each word built directly from the text.
+     * @param begin The first character of the block.
+     * @param end One past the last character of the block.
+     * @param words The list to add the words to.
+     * @param stats If not null, the words are counted in it too.
+     */
+    static void appendWords(const char *begin, const char *end, WordList &words, VocabStats *stats = nullptr);
+
+    /**
+     * @brief Groups a file's extents by category name and hashes each category's bytes,
+     * so two versions of a file can tell their unchanged categories apart without parsing them.
+     * @param contents The text of the vocabulary file.
+     * @param extents Its extents (scan(contents)); they must outlive the result.
+     * @return One entry per category name, in order of first appearance.
+     */
+    static std::vector<FileCategory> groupByName(const std::string &contents, const std::vector<CategoryExtent> &extents);
+
+    /**
+     * @brief Calls visit for every word of a category, read straight from the file's text.
+     * @param contents The text of the vocabulary file.
+     * @param category The category.
+     * @param visit Called with each word.
+     */
+    static void forEachWordOf(const std::string &contents, const FileCategory &category, const std::function<void(const std::string &)> &visit);
+};
+
+/**
+ * @class VocabParser
+ * @brief Parses a vocabulary file handed over in blocks of any size, as the blocks arrive.
+ *
+ * Lets a file be parsed while the rest of it is still being read or decompressed.
+ */
+class VocabParser
+{
+public:
+    /**
+     * @brief One category of the file, with its words counted as they are parsed.
+     */
+    struct Category
+    {
+        std::string name;  ///< The category name.
+        WordList words;    ///< Its words, in file order.
+        VocabStats stats;  ///< Statistics of the words.
+    };
+
+private:
+    std::vector<Category> categories; ///< In file order (a name may appear more than once).
+    std::string carry;                ///< Start of a line cut by the end of the last block.
+    uint64_t at = 0;                  ///< Offset of the next block in the text.
+    bool inWords = false;             ///< True between a header and the first blank line after it.
+    std::string word;                 ///< The last word, as a string for the statistics.
+
+    /**
+     * @brief Handles one line.
+     * @param text The line, without its newline.
+     * @param length Its length.
+     */
+    void line(const char *text, size_t length);
+
+public:
+    /**
+     * @brief Parses the next block of the file.
+     * @param data The block.
+     * @param length Its length.
+     */
+    void feed(const char *data, size_t length);
+
+    /**
+     * @brief Parses the last line, if the file does not end with a newline.
+     */
+    void finish();
+
+    /**
+     * @brief Returns the categories parsed so far.
+     * @return The categories, in file order.
+     */
+    std::vector<Category> &getCategories();
+};
+
+#endif // VOCABFILE_H
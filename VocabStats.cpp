@@ -0,0 +1,184 @@
+#include "VocabStats.h"
+#include <algorithm>
+#include <cctype>
+using namespace std;
+
+void VocabStats::count(const string &word, long copies)
+{
+    size_t &ofLength = lengths[word.size()];
+    ofLength += copies;
+    if (ofLength == 0)
+    {
+        lengths.erase(word.size()); // keep the histogram free of empty buckets
+    }
+    if (!word.empty())
+    {
+        firstLetters[tolower(static_cast<unsigned char>(word[0]))] += copies;
+    }
+}
+
+void VocabStats::add(const string &word, size_t copies)
+{
+    if (copies == 0)
+    {
+        return;
+    }
+    total += copies;
+    if (distinct)
+    {
+        counts[word] += copies;
+    }
+    count(word, static_cast<long>(copies));
+}
+
+void VocabStats::remove(const string &word, size_t copies)
+{
+    if (copies == 0)
+    {
+        return;
+    }
+    if (distinct)
+    {
+        auto found = counts.find(word);
+        if (found == counts.end())
+        {
+            return;
+        }
+        copies = min(copies, found->second);
+        found->second -= copies;
+        if (found->second == 0)
+        {
+            counts.erase(found);
+        }
+    }
+    total -= copies;
+    count(word, -static_cast<long>(copies));
+}
+
+// the length and first-letter numbers of other, added (sign 1) or removed (sign -1) in one step each
+static void combine(size_t &total, map<size_t, size_t> &lengths, array<size_t, 256> &firstLetters, const VocabStats &other, long sign)
+{
+    total += sign * static_cast<long>(other.wordCount());
+    for (const auto &entry : other.lengthHistogram())
+    {
+        size_t &ofLength = lengths[entry.first];
+        ofLength += sign * static_cast<long>(entry.second);
+        if (ofLength == 0)
+        {
+            lengths.erase(entry.first);
+        }
+    }
+    for (size_t c = 0; c < firstLetters.size(); ++c)
+    {
+        firstLetters[c] += sign * static_cast<long>(other.firstLetterCounts()[c]);
+    }
+}
+
+void VocabStats::merge(const VocabStats &other)
+{
+    if (!other.distinct) // its distinct words are not known, so ours will not be either
+    {
+        counts = unordered_map<string, size_t>();
+        distinct = false;
+    }
+    if (distinct)
+    {
+        for (const auto &entry : other.counts) // one step per distinct word, never per copy
+        {
+            add(entry.first, entry.second);
+        }
+        return;
+    }
+    combine(total, lengths, firstLetters, other, 1);
+}
+
+void VocabStats::subtract(const VocabStats &other)
+{
+    if (!other.distinct)
+    {
+        counts = unordered_map<string, size_t>();
+        distinct = false;
+    }
+    if (distinct)
+    {
+        for (const auto &entry : other.counts)
+        {
+            remove(entry.first, entry.second);
+        }
+        return;
+    }
+    combine(total, lengths, firstLetters, other, -1);
+}
+
+void VocabStats::clear()
+{
+    total = 0;
+    counts = unordered_map<string, size_t>(); // gives the buckets back too
+    distinct = false;
+    lengths.clear();
+    firstLetters.fill(0);
+}
+
+void VocabStats::trackDistinct() { distinct = true; }
+
+bool VocabStats::tracksDistinct() const { return distinct; }
+
+size_t VocabStats::wordCount() const { return total; }
+
+size_t VocabStats::uniqueCount() const { return counts.size(); }
+
+size_t VocabStats::occurrences(const string &word) const
+{
+    auto found = counts.find(word);
+    return found == counts.end() ? 0 : found->second;
+}
+
+const map<size_t, size_t> &VocabStats::lengthHistogram() const { return lengths; }
+
+const array<size_t, 256> &VocabStats::firstLetterCounts() const { return firstLetters; }
+
+size_t VocabStats::memoryUsage() const
+{
+    // one hash node (word, count and next pointer) per distinct word, plus the bucket array and the histogram
+    const size_t inlineCapacity = string().capacity();
+    size_t bytes = sizeof(*this) + counts.bucket_count() * sizeof(void *);
+    for (const auto &entry : counts)
+    {
+        bytes += sizeof(entry) + sizeof(void *) + sizeof(size_t); // the node also caches the hash
+        if (entry.first.capacity() > inlineCapacity)
+        {
+            bytes += entry.first.capacity() + 1;
+        }
+    }
+    return bytes + lengths.size() * (2 * sizeof(size_t) + 4 * sizeof(void *));
+}
+
+void VocabStats::shrinkToFit() { counts.rehash(0); } // rehash(0) picks the smallest bucket count that fits
+
+void VocabStats::write(ostream &sout) const
+{
+    sout << "Words: " << total << ", unique: " << counts.size() << '\n';
+    sout << "Lengths:";
+    for (const auto &entry : lengths)
+    {
+        sout << ' ' << entry.first << ':' << entry.second;
+    }
+    sout << "\nFirst letters:";
+    for (size_t c = 0; c < firstLetters.size(); ++c)
+    {
+        if (firstLetters[c] != 0)
+        {
+            if (isprint(static_cast<int>(c)))
+                sout << ' ' << static_cast<char>(c) << ':' << firstLetters[c];
+            else
+                sout << " \\x" << hex << c << dec << ':' << firstLetters[c];
+        }
+    }
+    sout << '\n';
+}
+
+ostream &operator<<(ostream &out, const VocabStats &stats)
+{
+    stats.write(out);
+    return out;
+}
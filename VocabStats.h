@@ -0,0 +1,141 @@
+#ifndef VOCABSTATS_H
+#define VOCABSTATS_H
+
+#include <array>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @class VocabStats
+ * @brief Word counts, unique counts, length histogram and first-letter distribution of a set of words.
+ *
+ * Every update is proportional to the word being added or removed, so the numbers
+ * can be kept up to date on each edit and read back without looking at the words.
+ *
+ * The word count, length histogram and first letters take the same few bytes however many
+ * words there are, so they are always kept. The distinct words are not: a hash table with a
+ * copy of every distinct word would cost more than the words themselves, on every load, even
+ * when nobody asks. They are only counted after trackDistinct, which the owner of the words
+ * calls (on empty statistics, then adding every word again) the first time they are needed.
+ */
+class VocabStats
+{
+private:
+    size_t total = 0;                                ///< Number of words, duplicates included.
+    std::unordered_map<std::string, size_t> counts; ///< How many times each distinct word appears (only while distinct is true).
+    bool distinct = false;                           ///< True while counts is kept.
+    std::map<size_t, size_t> lengths;                ///< Word length -> number of words of that length.
+    std::array<size_t, 256> firstLetters{};          ///< Lowercased first character -> number of words starting with it.
+
+    /**
+     * @brief Updates the length and first-letter numbers for copies of a word.
+     * @param word The word.
+     * @param copies How many copies were added (positive) or removed (negative).
+     */
+    void count(const std::string &word, long copies);
+
+public:
+    /**
+     * @brief Adds copies of a word.
+     * @param word The word to add.
+     * @param copies How many copies to add.
+     */
+    void add(const std::string &word, size_t copies = 1);
+
+    /**
+     * @brief Removes copies of a word.
+     * @param word The word to remove.
+     * @param copies How many copies were removed (all there were, or fewer).
+     */
+    void remove(const std::string &word, size_t copies);
+
+    /**
+     * @brief Adds all the words counted by other.
+     * If other does not count distinct words, these statistics stop counting them too.
+     * @param other The statistics to add.
+     */
+    void merge(const VocabStats &other);
+
+    /**
+     * @brief Removes all the words counted by other (which must be a part of these words).
+     * If other does not count distinct words, these statistics stop counting them too.
+     * @param other The statistics to remove.
+     */
+    void subtract(const VocabStats &other);
+
+    /**
+     * @brief Forgets every word (and stops counting distinct words).
+     */
+    void clear();
+
+    /**
+     * @brief Starts counting distinct words; only valid while no word is counted yet.
+     */
+    void trackDistinct();
+
+    /**
+     * @brief Tells whether distinct words are counted (see uniqueCount and occurrences).
+     * @return True if they are.
+     */
+    bool tracksDistinct() const;
+
+    /**
+     * @brief Returns the number of words, duplicates included.
+     * @return The number of words.
+     */
+    size_t wordCount() const;
+
+    /**
+     * @brief Returns the number of distinct words (0 unless tracksDistinct).
+     * @return The number of distinct words.
+     */
+    size_t uniqueCount() const;
+
+    /**
+     * @brief Returns how many times a word appears (0 unless tracksDistinct).
+     * @param word The word to look for.
+     * @return How many times the word appears.
+     */
+    size_t occurrences(const std::string &word) const;
+
+    /**
+     * @brief Returns the length histogram.
+     * @return Word length -> number of words of that length.
+     */
+    const std::map<size_t, size_t> &lengthHistogram() const;
+
+    /**
+     * @brief Returns the first-letter distribution.
+     * @return Lowercased first character -> number of words starting with it.
+     */
+    const std::array<size_t, 256> &firstLetterCounts() const;
+
+    /**
+     * @brief Returns an estimate of the bytes used by the counts.
+     * @return The number of bytes used.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Shrinks the hash table of the counts to fit the words left in it.
+     */
+    void shrinkToFit();
+
+    /**
+     * @brief Writes the statistics to an output stream.
+     * @param sout The output stream.
+     */
+    void write(std::ostream &sout) const;
+
+    /**
+     * @brief Output stream operator overload for VocabStats.
+     * @param out The output stream.
+     * @param stats The statistics to output.
+     * @return The output stream.
+     */
+    friend std::ostream &operator<<(std::ostream &out, const VocabStats &stats);
+};
+
+#endif // VOCABSTATS_H
@@ -1,4 +1,6 @@
 #include "Word.h"
+#include <algorithm>
+#include <cctype>
 
 /* NOT NECESSARY BECAUSE WE ARE USING DEFAULT CONSTRUCTORS, DESTRUCTORS, AND OPERATORS
 // Word:: is a scope resolution operator, used to define member functions outside of the class definition (class definition is in Word.h)
@@ -42,27 +44,40 @@ Word::~Word(){}; // no need to do anything here because string automatically man
 */
 
 // Conversion constructor : Word w("hello") or Word w = "hello";
-Word::Word(const string &input) : word(input) {} // "&" allows the function to access the input argument directly, rather than creating a copy of it.
+Word::Word(const string &input) : word(input.data(), input.size()) {} // "&" allows the function to access the input argument directly, rather than creating a copy of it.
                                                  // const means that the function promises not to modify the input argument, so can accept a const string (or not)
 
+// Allocator-aware constructors : a pmr::list<Word> calls these (through its polymorphic_allocator)
+// so that the characters of each Word are carved out of the list's arena instead of the global heap
+Word::Word(const allocator_type &alloc) : word(alloc) {}
+Word::Word(const string &input, const allocator_type &alloc) : word(input.data(), input.size(), alloc) {}
+Word::Word(string_view input, const allocator_type &alloc) : word(input.data(), input.size(), alloc) {}
+Word::Word(const Word &other, const allocator_type &alloc) : word(other.word, alloc) {}
+Word::Word(Word &&other, const allocator_type &alloc) : word(move(other.word), alloc) {} // steals the buffer if both use the same arena, copies otherwise
+
 // Other member functions
 
 // set *this to word
 void Word::set(const Word &input) { word = input.word; } // sets the word to the input word
 // eg. Word w1("hello"); Word w2("world"); w1.set(w2); // w1 = "world"
 
-void Word::set(const string &input) { word = input; } // sets the word to the input string
+void Word::set(const string &input) { word.assign(input.data(), input.size()); } // sets the word to the input string
 // eg. Word w; w.set("hello");
 
-string Word::get() const { return word; } // returns the word
+string Word::get() const { return string(word.data(), word.size()); } // returns the word
 // eg. Word w("hello"); string s = w.get(); // s = "hello"
 
+string_view Word::view() const { return string_view(word.data(), word.size()); } // no copy : points at the Word's own characters
+// eg. Word w("hello"); string_view v = w.view(); // v = "hello"
+
 Word Word::getWord() const { return *this; } // returns the word
 // eg. Word w("hello"); Word w2 = w.getWord(); // w2 = "hello"
 
-string Word::getWordAsString() const { return word; } // returns the word as a string
+string Word::getWordAsString() const { return string(word.data(), word.size()); } // returns the word as a string
 
 size_t Word::length() const { return word.length(); }
+
+size_t Word::capacity() const { return word.capacity(); }
 // size_t is a positive integer type, used for sizes of objects
 
 const char *Word::c_str() const { return word.c_str(); } // returns a pointer to the first character of the string
@@ -70,17 +85,24 @@ const char *Word::c_str() const { return word.c_str(); } // returns a pointer to
 // eg. Word w("hello"); w.changeWord("world");
 void Word::changeWord(const Word &newWord) { word = newWord.word; }
 
-void Word::changeWord(const string &newWord) { word = newWord; }
+void Word::changeWord(const string &newWord) { word.assign(newWord.data(), newWord.size()); }
 // diference between the two functions is that one takes a Word object and the other takes a string object
 // eg  Word w("hello"); w.changeWord("world") vs Word w("hello"); Word w2("world"); w.changeWord(w2);
 
-Word Word::concat(const Word &other, const string &delimiter) const { return Word(word + delimiter + other.word); }
+Word Word::concat(const Word &other, const string &delimiter) const { return Word(get() + delimiter + other.get()); }
 // delimiter is a string that separates the two words
 // eg . Word w1("hello"); Word w2("world"); Word w3 = w1.concat(w2, " "); // w3 = "hello world"
 
 bool Word::isLess(const Word &other) const { return word < other.word; }
 // returns true if the word is less than the other word (in lexicographical order)
 
+bool Word::isLessIgnoreCase(const Word &other) const
+{
+    // compare character by character after lowering each one, instead of building two lowercase copies
+    return lexicographical_compare(word.begin(), word.end(), other.word.begin(), other.word.end(), [](char a, char b)
+                                   { return tolower(static_cast<unsigned char>(a)) < tolower(static_cast<unsigned char>(b)); });
+}
+
 char Word::at(size_t n) const { return word.at(n); }
 // returns the character at the nth position in the word
 
@@ -3,14 +3,22 @@
 
 #include <string>
 #include <iostream>
+#include <memory_resource>
+#include <string_view>
 using namespace std;
 
 class Word
 {
 private:
-    string word;
+    pmr::string word; // pmr::string so the characters can live in the same arena as the list node holding the Word
 
 public:
+    /**
+     * Allocator type. Declaring it makes Word "allocator-aware", so a pmr container
+     * holding Words passes its memory resource down to each Word's string.
+     */
+    using allocator_type = pmr::polymorphic_allocator<char>;
+
     /**
      * Default constructor. Initializes an empty Word.
      */
@@ -53,6 +61,41 @@ public:
      */
     Word(const string &input);
 
+    /**
+     * Constructor that initializes an empty Word whose characters come from a memory resource.
+     * @param alloc The allocator (memory resource) to use for the characters.
+     */
+    explicit Word(const allocator_type &alloc);
+
+    /**
+     * Constructor that initializes the Word with a string, using a memory resource for the characters.
+     * @param input The string to initialize the Word with.
+     * @param alloc The allocator (memory resource) to use for the characters.
+     */
+    Word(const string &input, const allocator_type &alloc);
+
+    /**
+     * Constructor that initializes the Word with a view of some characters, using a memory resource for them.
+     * Lets a pmr list build a Word straight from a line of a file, without a temporary string.
+     * @param input The characters to initialize the Word with.
+     * @param alloc The allocator (memory resource) to use for the characters.
+     */
+    Word(string_view input, const allocator_type &alloc);
+
+    /**
+     * Allocator-extended copy constructor. Used by pmr containers when copying a Word into their arena.
+     * @param other The Word to copy.
+     * @param alloc The allocator (memory resource) to use for the characters.
+     */
+    Word(const Word &other, const allocator_type &alloc);
+
+    /**
+     * Allocator-extended move constructor. Used by pmr containers when moving a Word into their arena.
+     * @param other The Word to move.
+     * @param alloc The allocator (memory resource) to use for the characters.
+     */
+    Word(Word &&other, const allocator_type &alloc);
+
     /**
      * Sets the Word to a copy of another Word.
      * @param input The Word to copy.
@@ -71,6 +114,13 @@ public:
      */
     string get() const;
 
+    /**
+     * Returns a view of the characters of the Word, without copying them.
+     * The view is valid until the Word is changed or destroyed.
+     * @return A view of the Word.
+     */
+    string_view view() const;
+
     /**
      * Returns a copy of the Word.
      * @return A copy of the Word.
@@ -89,6 +139,12 @@ public:
      */
     size_t length() const;
 
+    /**
+     * Returns how many characters the Word can hold without reallocating.
+     * @return The capacity of the Word.
+     */
+    size_t capacity() const;
+
     /**
      * Returns the Word as a C-style string.
      * @return The Word as a C-style string.
@@ -122,6 +178,13 @@ public:
      */
     bool isLess(const Word &other) const;
 
+    /**
+     * Returns true if the Word comes before another Word when case is ignored. Does not allocate.
+     * @param other The Word to compare to.
+     * @return True if the Word is less than the other Word, ignoring case.
+     */
+    bool isLessIgnoreCase(const Word &other) const;
+
     /**
      * Returns the character at a specific position in the Word.
      * @param n The position of the character to return.
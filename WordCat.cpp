@@ -1,12 +1,24 @@
 #include "WordCat.h"
+#include "Compression.h"
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <limits>
+#include <atomic>
+#include <type_traits>
 using namespace std;
 
+// vector<WordCat> moves its categories when it grows only if moving cannot throw; otherwise it copies
+// every one of them (arena, compressed block, indexes and all)
+static_assert(is_nothrow_move_constructible<WordCat>::value, "WordCat's move constructor must not throw");
+static_assert(is_nothrow_move_assignable<WordCat>::value, "WordCat's move assignment must not throw");
+
+static atomic<uint64_t> useClock(0); // ticks every time a category's words are needed, for least-recently-used eviction (atomic : different categories may be read on different threads)
+static uint64_t versionClock = 0;    // hands out category versions, so that no two edits ever get the same one
+
 // Conversion constructor : creating a WordCat object from a string
 // eg WordCat wc = "Category Name"; means that wc is a WordCat object with the name "Category Name"
-WordCat::WordCat(const string &name) : cat_name(name), word_list() {}
+WordCat::WordCat(const string &name) : cat_name(name), word_list(), version(++versionClock) {}
 
 char WordCat::menu()
 {
@@ -20,9 +32,13 @@ char WordCat::menu()
     cout << "7. Show Sorted Words in Category\n";
     cout << "8. Load Category from Text File\n";
     cout << "9. Save Category to Text File\n";
+    cout << "c. Compress / Expand Category\n";
     cout << "0. Exit\n";
     char choice;
-    cin >> choice;
+    if (!(cin >> choice))
+    {
+        return '0'; // end of input : nobody is left to type anything
+    }
     return choice;
 }
 
@@ -34,16 +50,30 @@ void WordCat::handleOption(int option)
     {
     case '1':
         // if empty list, print "No words in category."
-        if (word_list.isEmpty())
+        if (compressed ? compact.isEmpty() : word_list.isEmpty())
         {
             cout << "No words in category.\n";
         }
+        else if (pageSize > 0 && size() > pageSize) // a page at a time, each one read straight from the list's index
+        {
+            cout << "Category Name:" << cat_name << '\n';
+            showPages(cout, size(), pageSize, [this](size_t p)
+                      { return page(p, pageSize); });
+        }
+        else if (compressed) // the compressed form is printed in sorted order, straight from the blocks
+        {
+            cout << "Category Name:" << cat_name << '\n';
+            compact.write(cout, 1);
+            cout << endl
+                 << "\n\n";
+        }
         else
             cout << "Category Name:" << cat_name << '\n'
                  << word_list << "\n\n"; // calls the overloaded << operator to print the current WordList object / current instance of the class WordList
         break;
     case '2':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        expand(); // editing needs the normal form
         do
         {
             cout << "Enter word to append: "; // adds word to the end of the list
@@ -53,28 +83,35 @@ void WordCat::handleOption(int option)
             {
 
                 word_list.push_back(Word(word)); // makes word into a Word object and adds it to the end of the list
+                wordAdded(word);
             }
         } while (word != "exit");
         break;
     case '3':
+    {
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cout << "Enter word to remove: ";
         getline(cin, word);
+        expand();
+        size_t before = word_list.size();
         word_list.remove(Word(word));
+        wordRemoved(word, before - word_list.size());
         break;
+    }
     case '4':
-        word_list.clear();
+        clear();
         break;
     case '5':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cout << "Enter new category name: ";
         getline(cin, cat_name); // public member functions of a class have access to the private members of the class, but functions in other classes do not
+        version = ++versionClock;
         break;
     case '6':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cout << "Enter word to search: ";
         getline(cin, word);
-        if (word_list.lookup(Word(word)))
+        if (lookup(word))
         {
             cout << "Word found in category.\n";
         }
@@ -85,6 +122,12 @@ void WordCat::handleOption(int option)
         break;
     case '7':
         cout << "Sorted words of " << cat_name << endl;
+        if (pageSize > 0 && size() > pageSize) // only sort as far as the pages actually shown
+        {
+            showPages(cout, size(), pageSize, [this](size_t p)
+                      { return sortedPage(p, pageSize); });
+            break;
+        }
         show_sorted(cout, 1); // cout is the output stream, 5 is the number of words per line
         break;
     case '8':
@@ -99,6 +142,18 @@ void WordCat::handleOption(int option)
         getline(cin, filename);
         saveToFile(filename);
         break;
+    case 'c':
+        if (compressed)
+        {
+            decompress();
+            cout << "Category expanded.\n";
+        }
+        else
+        {
+            compress();
+            cout << "Category compressed (" << compact.memoryUsage() << " bytes).\n";
+        }
+        break;
     case '0':
         cout << "Exiting...\n";
         break;
@@ -110,11 +165,18 @@ void WordCat::handleOption(int option)
 
 void WordCat::run()
 {
+    ensureMaterialized();
+    modified = true; // the menu may edit anything, keep the words in memory from now on
     char choice;
     do // at least one iteration of the loop
     {
         choice = menu();      // calling the menu function and assigning the return value to choice
+        auto start = chrono::steady_clock::now();
         handleOption(choice); // calling the handleOption function with the choice as an argument
+        if (observer)
+        {
+            observer("WordCat", choice, chrono::steady_clock::now() - start);
+        }
     } while (choice != '0'); // display menu while choice is not 0
 }
 
@@ -126,25 +188,39 @@ void WordCat::run()
 
 void WordCat::write(ostream &sout, int n) const
 {
+    ensureMaterialized();
     int wordsPerLine = 5;
     sout << "\n\nCategory Name:" << cat_name << "\n";
+    if (compressed)
+    {
+        compact.write(sout, wordsPerLine);
+        return;
+    }
     word_list.write(sout, wordsPerLine); // referring to the write function in WordList.cpp so need to input a number of how many words per line
 }
 
 void WordCat::show_sorted(ostream &sout, int n) const
 {
-    forward_list<Word> sorted_list = word_list.getSinglyLinkedList(); // want a singly linked list because it is faster to sort
-                                                                      // don't just use word_list because it is a doubly linked list
-    // Sort the list in a case-insensitive manner
-    sorted_list.sort([](const Word &a, const Word &b)
-                     {
-        string lower_a = a.getWordAsString(), lower_b = b.getWordAsString();
-        transform(lower_a.begin(), lower_a.end(), lower_a.begin(), ::tolower);
-        transform(lower_b.begin(), lower_b.end(), lower_b.begin(), ::tolower);
-        return lower_a < lower_b; });               // .sort() sorts the list in ascending order
-    for (const auto &word : sorted_list) // for each word in the list
+    ensureMaterialized();
+    if (compressed) // already sorted : just decode the blocks in order
+    {
+        compact.forEach([&](const string &word)
+                        { sout << word << '\n'; });
+        sout << '\n';
+        return;
+    }
+    vector<const Word *> sorted_list; // sort pointers to the words instead of copies of them
+    sorted_list.reserve(word_list.size());
+    for (const auto &word : word_list)
+    {
+        sorted_list.push_back(&word);
+    }
+    // Sort the list in a case-insensitive manner (stable, so words equal apart from case keep their order)
+    stable_sort(sorted_list.begin(), sorted_list.end(), [](const Word *a, const Word *b)
+                { return a->isLessIgnoreCase(*b); }); // compares without making lowercase copies
+    for (const Word *word : sorted_list) // for each word in the list
     {
-        sout << word << '\n';
+        sout << *word << '\n';
     }
     sout << '\n';
 }
@@ -152,52 +228,70 @@ void WordCat::show_sorted(ostream &sout, int n) const
 // eg. .saveToFile("filename.txt") saves the category to a file called filename.txt
 void WordCat::saveToFile(const string &filename) const
 {
-    ofstream outFile(filename, ios::app); // ios::app appends to the end of the file rather than overwriting it ! if did not write ios::app, it would overwrite the file
-    if (!outFile)                         // if the file cannot be opened
+    // appends to the end of the file rather than overwriting it, in large queued writes (compressed for .gz / .zst)
+    CompressingWriter file(filename, true, Compression::forFilename(filename));
+    if (!file.isOpen()) // if the file cannot be opened
     {
         cerr << "Error opening file for writing: " << filename << '\n';
         return;
     }
-    // else
-    outFile << "#" << cat_name << '\n'; // # is used to indicate the start of a category
-    word_list.write(outFile, 1);        // write function handles the writing of the words to the file since takes an output stream as an argument
-    //  !!!!!!! ATTENTION : scared that it will double the categoryName since it is already written in the write function !!!!!!!!!!
-    outFile.close(); // close the file
+    ostream outFile(&file);
+    saveTo(outFile);
+    if (!file.close()) // waits for the last writes
+    {
+        cerr << "Error writing file: " << filename << '\n';
+    }
+}
+
+void WordCat::saveTo(ostream &sout) const
+{
+    ensureMaterialized();
+    sout << "#" << cat_name << '\n'; // # is used to indicate the start of a category
+    if (compressed)
+    {
+        compact.write(sout, 1);
+    }
+    else
+        word_list.write(sout, 1); // write function handles the writing of the words to the file since takes an output stream as an argument
 }
 
 void WordCat::loadFromFile(const string &filename)
 {
-    ifstream inFile(filename); // inFile is an object of the ifstream class that reads from a file
-    if (!inFile)
+    vector<CategoryExtent> extents; // where every category is in the file, found in one pass
+    if (!VocabFile::scanFile(filename, extents))
     {
         cerr << "Error opening file for reading: " << filename << '\n';
         return;
     }
 
-    string line; // create a string variable called line
-    bool categoryFound = false;
-
-    while (getline(inFile, line)) // while getLine returns true (ie. there is a line to read)
+    const CategoryExtent *found = nullptr;
+    for (const auto &extent : extents)
     {
-        if (line == "#" + cat_name)
+        if (extent.name == cat_name)
         {
-            categoryFound = true;
+            found = &extent;
             break;
         }
     }
 
-    if (!categoryFound)
+    if (!found)
     {
         cerr << "Category not found in file: " << cat_name << '\n';
         return;
     }
 
-    while (getline(inFile, line) && !line.empty() && line[0] != '#') // while the line is not empty and does not start with a #
+    string text;
+    if (!VocabFile::readExtent(filename, *found, text)) // read only this category's lines
     {
-        word_list.push_back(Word(line)); // add the word to the end of the list
+        cerr << "Error opening file for reading: " << filename << '\n';
+        return;
     }
-
-    inFile.close(); // stop reading from the file
+    ensureMaterialized();
+    expand(); // new words go into the normal form
+    VocabFile::forEachWord(text.data(), text.data() + text.size(), [&](const string &line)
+                           {
+        word_list.push_back(Word(line)); // add the word to the end of the list
+        wordAdded(line); });
 }
 
 ostream &operator<<(ostream &sout, const WordCat &wc)
@@ -207,7 +301,7 @@ ostream &operator<<(ostream &sout, const WordCat &wc)
 }
 
 // Get the name of the category
-string WordCat::getCatName() const
+const string &WordCat::getCatName() const
 {
     return cat_name;
 }
@@ -215,11 +309,20 @@ string WordCat::getCatName() const
 // Get the list of words in the category
 WordList &WordCat::getWordList()
 {
+    ensureMaterialized();
+    expand(); // the caller may edit the list, so it has to be the real one
+    wordsChanged(); // and we cannot see what it does with it
+    statsKnown = false; // so the statistics are counted again the next time they are asked for
     return word_list;
 }
 
 vector<string> WordCat::getWords() const
 {
+    ensureMaterialized();
+    if (compressed)
+    {
+        return compact.toVector();
+    }
     vector<string> words;
     for (const auto &word : word_list.getSinglyLinkedList())
     {
@@ -227,3 +330,642 @@ vector<string> WordCat::getWords() const
     }
     return words;
 }
+
+void WordCat::forEachWord(const function<void(string_view)> &visit) const
+{
+    ensureMaterialized();
+    if (compressed)
+    {
+        compact.forEach([&](const string &word)
+                        { visit(word); });
+        return;
+    }
+    for (const auto &word : word_list)
+    {
+        visit(word.view());
+    }
+}
+
+void WordCat::compress()
+{
+    if (compressed)
+    {
+        return;
+    }
+    ensureMaterialized();
+    compact = FrontCodedList(getWords());
+    word_list.clear(); // releases the list's whole arena
+    compressed = true;
+    cursor.reset();
+    version = ++versionClock; // the words are now saved in sorted order
+}
+
+void WordCat::decompress() { expand(); }
+
+void WordCat::expand()
+{
+    if (!compressed)
+    {
+        return;
+    }
+    compact.forEach([&](const string &word)
+                    { word_list.push_back(Word(word)); });
+    compact.clear();
+    compressed = false;
+    cursor.reset();
+    version = ++versionClock;
+}
+
+bool WordCat::isCompressed() const { return compressed; }
+
+bool WordCat::lookup(const string &word) const
+{
+    ensureMaterialized();
+    refreshFilter();
+    if (!filter.mightContain(word)) // most lookups are misses : answer them without touching the words
+    {
+        return false;
+    }
+    bool found = compressed ? compact.lookup(word) : word_list.contains(word); // binary search on the compressed form, list walk otherwise
+    if (!found)
+    {
+        filter.recordFalsePositive();
+    }
+    return found;
+}
+
+void WordCat::clear()
+{
+    compact.clear();
+    compressed = false;
+    word_list.clear();
+    materialized = true; // nothing left to read from the file
+    stats.clear();
+    statsKnown = true;
+    wordsChanged();
+}
+
+size_t WordCat::size() const
+{
+    if (!materialized)
+    {
+        return source.wordCount; // known from the directory scan, no need to read the words
+    }
+    return compressed ? compact.size() : word_list.size();
+}
+
+// a Bloom filter cannot forget a word, so removals only mark it stale and the next lookup rebuilds it
+void WordCat::refreshFilter() const
+{
+    if (!filterStale && !filter.isOverfull())
+    {
+        return;
+    }
+    filter.reset(size() * 2); // room to grow before the next rebuild
+    if (compressed)
+    {
+        compact.forEach([&](const string &word)
+                        { filter.insert(word); });
+    }
+    else
+    {
+        word_list.forEach([&](const Word &word)
+                          { filter.insert(word.view()); });
+    }
+    filterStale = false;
+}
+
+void WordCat::wordAdded(const string &word)
+{
+    modified = true;
+    version = ++versionClock;
+    sortedStale = true;
+    cursor.reset();
+    if (statsKnown)
+    {
+        stats.add(word);
+    }
+    if (!filterStale) // a stale filter is rebuilt from scratch anyway
+    {
+        filter.insert(word);
+    }
+    if (!anagramsStale)
+    {
+        anagrams.add(word);
+    }
+    if (!positionsStale)
+    {
+        positions.add(word);
+    }
+}
+
+void WordCat::wordRemoved(const string &word, size_t copies)
+{
+    if (statsKnown)
+    {
+        stats.remove(word, copies); // list::remove drops every copy, so do the statistics
+    }
+    if (!anagramsStale)
+    {
+        anagrams.removeAll(word); // and so do the indexes
+    }
+    if (!positionsStale)
+    {
+        positions.removeAll(word);
+    }
+    modified = true;
+    version = ++versionClock;
+    filterStale = true; // a Bloom filter cannot forget a word
+    sortedStale = true;
+    cursor.reset();
+}
+
+void WordCat::wordsChanged()
+{
+    modified = true;
+    version = ++versionClock;
+    filterStale = true;
+    sortedStale = true;
+    cursor.reset();
+    anagramsStale = true;
+    positionsStale = true;
+}
+
+void WordCat::refreshAnagrams() const
+{
+    if (!anagramsStale)
+    {
+        return;
+    }
+    anagrams = AnagramIndex();
+    forEachWord([&](string_view word)
+                { anagrams.add(word); });
+    anagramsStale = false;
+}
+
+size_t WordCat::findAnagrams(const string &letters, const function<void(const string &)> &emit) const
+{
+    refreshAnagrams();
+    return anagrams.anagramsOf(letters, emit);
+}
+
+size_t WordCat::findFormable(const string &tiles, const function<void(const string &)> &emit, size_t minLength) const
+{
+    refreshAnagrams();
+    return anagrams.formableFrom(tiles, emit, minLength);
+}
+
+void WordCat::refreshPositions() const
+{
+    if (!positionsStale)
+    {
+        return;
+    }
+    positions.clear();
+    forEachWord([&](string_view word)
+                { positions.add(word); });
+    positionsStale = false;
+}
+
+size_t WordCat::findCrossword(const string &pattern, const function<void(const string &)> &emit) const
+{
+    refreshPositions();
+    return positions.find(pattern, emit);
+}
+
+vector<string> WordCat::firstSorted(size_t k) const { return sortedPage(0, k); }
+
+vector<string> WordCat::sortedPage(size_t page, size_t size) const
+{
+    ensureMaterialized();
+    if (cursor.empty())
+    {
+        if (compressed) // already in this order : pages are read by position
+        {
+            cursor.set(SortedCursor(compact.size(), [this](size_t n)
+                                    { return compact.at(n); }));
+        }
+        else
+        {
+            vector<string_view> views;
+            views.reserve(word_list.size());
+            for (const auto &word : word_list)
+            {
+                views.push_back(word.view());
+            }
+            cursor.set(SortedCursor(move(views), FrontCodedList::less));
+        }
+    }
+    cursor.get().seek(page * size);
+    return cursor.get().next(size);
+}
+
+vector<string> WordCat::sortedAfter(const string &key, size_t count) const
+{
+    ensureMaterialized();
+    vector<string> result;
+    if (compressed) // sorted already : binary search for the first word after key
+    {
+        size_t lo = 0, hi = compact.size();
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (FrontCodedList::less(key, compact.at(mid)))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        for (size_t n = lo; n < compact.size() && result.size() < count; ++n)
+        {
+            result.push_back(compact.at(n));
+        }
+        return result;
+    }
+    // keep the words after key, then only sort the count smallest of them
+    vector<string_view> after;
+    for (const auto &word : word_list)
+    {
+        if (FrontCodedList::less(key, word.view()))
+        {
+            after.push_back(word.view());
+        }
+    }
+    count = min(count, after.size());
+    nth_element(after.begin(), after.begin() + count, after.end(), FrontCodedList::less);
+    sort(after.begin(), after.begin() + count, FrontCodedList::less);
+    result.assign(after.begin(), after.begin() + count);
+    return result;
+}
+
+vector<string> WordCat::page(size_t page, size_t size) const
+{
+    ensureMaterialized();
+    vector<string> result;
+    for (size_t n = page * size; n < this->size() && result.size() < size; ++n)
+    {
+        result.push_back(compressed ? compact.at(n) : word_list.at(n).getWordAsString()); // O(1) through the list's index
+    }
+    return result;
+}
+
+void WordCat::setPageSize(size_t size) { pageSize = size; }
+
+void WordCat::setCommandObserver(CommandObserver observer) { this->observer = move(observer); }
+
+void WordCat::showPages(ostream &sout, size_t total, size_t size, const function<vector<string>(size_t)> &pageAt)
+{
+    size_t pages = (total + size - 1) / size;
+    for (size_t p = 0; p < pages; ++p)
+    {
+        for (const auto &word : pageAt(p))
+        {
+            sout << word << '\n';
+        }
+        if (p + 1 == pages)
+        {
+            break;
+        }
+        char answer;
+        sout << "Page " << p + 1 << " of " << pages << " (n for the next page, anything else to stop): ";
+        if (!(cin >> answer) || (answer != 'n' && answer != 'N'))
+        {
+            break;
+        }
+    }
+    sout << '\n';
+}
+
+const vector<string> &WordCat::sortedWords() const
+{
+    ensureMaterialized();
+    if (sortedStale)
+    {
+        sortedRun.clear();
+        sortedRun.reserve(size());
+        forEachWord([&](string_view word)
+                    { sortedRun.emplace_back(word); });
+        sort(sortedRun.begin(), sortedRun.end());
+        sortedRun.erase(unique(sortedRun.begin(), sortedRun.end()), sortedRun.end());
+        sortedStale = false;
+    }
+    return sortedRun;
+}
+
+void WordCat::setFilterFalsePositiveRate(double rate)
+{
+    filter.setFalsePositiveRate(rate);
+    filterStale = true;
+}
+
+BloomFilter::Stats WordCat::getFilterStats() const { return filter.getStats(); }
+
+string WordCat::wordAt(size_t n) const
+{
+    ensureMaterialized();
+    return compressed ? compact.at(n) : word_list.at(n).getWordAsString();
+}
+
+vector<string> WordCat::sample(size_t k, mt19937 &rng) const
+{
+    vector<string> picked;
+    for (size_t i : WordList::sampleIndexes(k, size(), rng))
+    {
+        picked.push_back(wordAt(i));
+    }
+    return picked;
+}
+
+vector<string> WordCat::sampleWeighted(size_t k, const function<double(const string &)> &weight, mt19937 &rng) const
+{
+    vector<double> weights;
+    weights.reserve(size());
+    for (size_t i = 0; i < size(); ++i)
+    {
+        weights.push_back(weight(wordAt(i)));
+    }
+    vector<string> picked;
+    for (size_t i : WordList::sampleWeightedIndexes(weights, k, rng))
+    {
+        picked.push_back(wordAt(i));
+    }
+    return picked;
+}
+
+void WordCat::setSource(const string &filename, const CategoryExtent &extent)
+{
+    clear();
+    sourceFile = filename;
+    source = extent;
+    materialized = false;
+    modified = false;
+    statsKnown = false; // counted when the words are first read
+}
+
+bool WordCat::relocateSource(const string &filename, const CategoryExtent &extent)
+{
+    if (sourceFile != filename || modified)
+    {
+        return false;
+    }
+    source = extent; // same words, they just moved : nothing else changes
+    return true;
+}
+
+void WordCat::ensureMaterialized() const
+{
+    lastUsed = ++useClock;
+    if (materialized)
+    {
+        return;
+    }
+    materialized = true;
+    string text;
+    if (!VocabFile::readExtent(sourceFile, source, text))
+    {
+        cerr << "Error opening file for reading: " << sourceFile << '\n';
+        return;
+    }
+    bool countStats = !statsKnown; // statistics survive eviction, only count them the first time
+    VocabFile::appendWords(text.data(), text.data() + text.size(), word_list, countStats ? &stats : nullptr);
+    statsKnown = true;
+    filterStale = true;
+    sortedStale = true;
+    cursor.reset();
+    anagramsStale = true;
+    positionsStale = true;
+}
+
+bool WordCat::isMaterialized() const { return materialized; }
+
+bool WordCat::evict()
+{
+    if (!materialized || sourceFile.empty() || modified) // edited words exist nowhere else, keep them
+    {
+        return false;
+    }
+    compact.clear();
+    compressed = false;
+    word_list.clear(); // releases the whole arena
+    filter.reset(0);
+    filterStale = true;
+    vector<string>().swap(sortedRun);
+    sortedStale = true;
+    cursor.reset();
+    anagrams = AnagramIndex(); // rebuilt from the file if it is needed again
+    anagramsStale = true;
+    positions = PositionIndex();
+    positionsStale = true;
+    materialized = false;
+    return true;
+}
+
+uint64_t WordCat::getLastUsed() const { return lastUsed; }
+
+size_t WordCat::memoryEstimate() const
+{
+    if (!materialized)
+    {
+        return 0;
+    }
+    if (compressed)
+    {
+        return compact.memoryUsage() + filter.memoryUsage();
+    }
+    // one list node (two pointers + the Word) and one index slot per word, plus the characters themselves
+    size_t perWord = sizeof(Word) + 3 * sizeof(void *);
+    size_t characters = source.length; // words straight from the file : their characters are exactly the extent's bytes
+    if (sourceFile.empty() || modified)
+    {
+        characters = 0;
+        word_list.forEach([&](const Word &word)
+                          { characters += word.length() + 1; });
+    }
+    return word_list.size() * perWord + characters + filter.memoryUsage();
+}
+
+void WordCat::appendWords(WordList &&words, VocabStats &&wordStats)
+{
+    ensureMaterialized();
+    expand();
+    bool distinct = statsKnown && stats.tracksDistinct() && !wordStats.tracksDistinct(); // wordStats cannot keep ours up to date
+    if (distinct)
+    {
+        words.forEach([&](const Word &word)
+                      { stats.add(word.getWordAsString()); });
+    }
+    else if (statsKnown && stats.wordCount() == 0)
+    {
+        stats = move(wordStats); // nothing counted yet (eg. a new category) : take the loader's numbers over
+    }
+    else if (statsKnown)
+    {
+        stats.merge(wordStats);
+    }
+    if (word_list.isEmpty())
+    {
+        word_list = move(words); // nothing to keep : take the whole list (and its arena) over
+    }
+    else
+    {
+        words.forEach([&](const Word &word)
+                      { word_list.push_back(word); });
+    }
+    wordsChanged();
+}
+
+VocabStats WordCat::applyDiff(unordered_map<string, size_t> removed, WordList &&added, VocabStats &&addedStats)
+{
+    ensureMaterialized();
+    expand();
+    VocabStats gone;
+    gone.trackDistinct(); // only the words removed : few, and they keep tracked statistics tracked
+    if (!removed.empty())
+    {
+        word_list.removeIf([&](const Word &word)
+                           {
+            auto found = removed.find(word.get());
+            if (found == removed.end() || found->second == 0)
+            {
+                return false;
+            }
+            --found->second; // only remove as many copies as the file lost
+            gone.add(found->first);
+            return true; });
+        if (statsKnown)
+        {
+            stats.subtract(gone);
+        }
+        wordsChanged();
+    }
+    if (added.size() > 0)
+    {
+        appendWords(move(added), move(addedStats));
+    }
+    return gone;
+}
+
+const VocabStats &WordCat::getStats(bool distinctWords) const
+{
+    if (!statsKnown)
+    {
+        ensureMaterialized(); // counts them while reading a lazily loaded category
+    }
+    if (!statsKnown || (distinctWords && !stats.tracksDistinct())) // the list was handed out with getWordList, or the distinct words are asked for the first time : count again, once
+    {
+        stats.clear();
+        if (distinctWords)
+        {
+            stats.trackDistinct(); // kept up to date on every edit from now on
+        }
+        if (compressed)
+        {
+            compact.forEach([&](const string &word)
+                            { stats.add(word); });
+        }
+        else
+        {
+            word_list.forEach([&](const Word &word)
+                              { stats.add(word.getWordAsString()); });
+        }
+        statsKnown = true;
+    }
+    return stats;
+}
+
+bool WordCat::hasStats() const { return statsKnown; }
+
+void WordCat::setCountedInTotals(bool counted) const { countedInTotals = counted; }
+
+bool WordCat::isCountedInTotals() const { return countedInTotals; }
+
+MemoryUsage WordCat::memoryBreakdown() const
+{
+    MemoryUsage usage;
+    const size_t inlineCapacity = string().capacity();
+    usage.overheadBytes = sizeof(*this) + (cat_name.capacity() > inlineCapacity ? cat_name.capacity() + 1 : 0) + stats.memoryUsage() + filter.memoryUsage() + anagrams.memoryUsage() + positions.memoryUsage();
+    if (materialized)
+    {
+        usage += compressed ? compact.memoryBreakdown() : word_list.memoryBreakdown();
+    }
+    // the sorted copy kept for set operations
+    usage.overheadBytes += sortedRun.size() * sizeof(string);
+    usage.slackBytes += (sortedRun.capacity() - sortedRun.size()) * sizeof(string);
+    for (const auto &word : sortedRun)
+    {
+        if (word.capacity() > inlineCapacity)
+        {
+            usage.overheadBytes += word.capacity() + 1;
+        }
+    }
+    return usage;
+}
+
+void WordCat::shrinkToFit()
+{
+    cursor.reset(); // the words are about to move
+    cat_name.shrink_to_fit();
+    stats.shrinkToFit();
+    if (sortedStale) // would be rebuilt before its next use anyway
+    {
+        vector<string>().swap(sortedRun);
+    }
+    if (filterStale)
+    {
+        filter.release();
+    }
+    if (anagramsStale)
+    {
+        anagrams = AnagramIndex();
+    }
+    if (positionsStale)
+    {
+        positions = PositionIndex();
+    }
+    if (!materialized)
+    {
+        return;
+    }
+    if (compressed)
+    {
+        compact.shrinkToFit();
+    }
+    else
+    {
+        word_list.shrinkToFit();
+    }
+}
+
+uint64_t WordCat::getVersion() const { return version; }
+
+uint64_t WordCat::contentHashOf(string_view word)
+{
+    uint64_t h = BloomFilter::hash(word); // mixed again before adding, so that sums of different words rarely collide
+    h ^= h >> 31;
+    h *= 0x7fb5d329728ea185ULL;
+    return h ^ (h >> 27);
+}
+
+uint64_t WordCat::contentHash() const
+{
+    if (hashedVersion == version)
+    {
+        return wordsHash;
+    }
+    uint64_t sum = 0;
+    forEachWord([&](string_view word)
+                { sum += contentHashOf(word); }); // a sum : the order of the words does not matter
+    wordsHash = sum;
+    hashedVersion = version;
+    return wordsHash;
+}
+
+bool WordCat::getSource(string &filename, CategoryExtent &extent) const
+{
+    if (sourceFile.empty() || modified)
+    {
+        return false;
+    }
+    filename = sourceFile;
+    extent = source;
+    return true;
+}
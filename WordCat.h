@@ -2,8 +2,25 @@
 #define WORDCAT_H
 
 #include "WordList.h"
+#include "FrontCodedList.h"
+#include "BloomFilter.h"
+#include "VocabFile.h"
+#include "VocabStats.h"
+#include "SortedCursor.h"
+#include "AnagramIndex.h"
+#include "PositionIndex.h"
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
+#include <random>
+#include <unordered_map>
+
+/**
+ * @brief Called after every menu command with the menu it ran in ("WordCatVec" or "WordCat"),
+ * the option and how long it took.
+ */
+using CommandObserver = std::function<void(const char *menu, char option, std::chrono::nanoseconds elapsed)>;
 
 /**
  * @class WordCat
@@ -13,8 +30,75 @@ class WordCat
 {
 private:
     std::string cat_name; ///< The name of this category.
-    WordList word_list;   ///< The underlying container storing the words in this category.
+    mutable WordList word_list; ///< The underlying container storing the words in this category (mutable: filled on first use when loaded lazily).
     vector<string> words; ///< The list of words in this category but as a vector of strings
+    FrontCodedList compact; ///< The compressed, read-only form of the words (only used while compressed is true).
+    bool compressed = false; ///< True when the words live in compact instead of word_list.
+    mutable BloomFilter filter; ///< Fast-reject filter for lookup, rebuilt lazily.
+    mutable bool filterStale = true; ///< True when words were removed (or the list was handed out) since the filter was built.
+    std::string sourceFile; ///< The file the words are read from when the category is loaded lazily (empty otherwise).
+    CategoryExtent source; ///< Where the words are in sourceFile.
+    mutable bool materialized = true; ///< False while the words are still only in sourceFile.
+    bool modified = false; ///< True once the words were edited, so they can no longer be dropped and read again later.
+    mutable uint64_t lastUsed = 0; ///< When the words were last needed, for least-recently-used eviction.
+    mutable std::vector<std::string> sortedRun; ///< The words sorted with duplicates removed, built on demand for set operations.
+    mutable bool sortedStale = true; ///< True when the words changed since sortedRun was built.
+    mutable CursorSlot cursor;       ///< Sorted pages handed out so far (views of the words), kept for the next page; empty when the words changed or the category was copied or moved.
+    size_t pageSize = 0;             ///< Words per page for options 1 and 7 (0 shows everything at once).
+    CommandObserver observer;        ///< Told how long each command took (empty: nobody is timing).
+    mutable AnagramIndex anagrams;   ///< The words by letters, built on the first anagram query and kept up to date after.
+    mutable bool anagramsStale = true; ///< True when anagrams must be rebuilt before its next use.
+    mutable PositionIndex positions;   ///< The words by letter positions, built on the first crossword query and kept up to date after.
+    mutable bool positionsStale = true; ///< True when positions must be rebuilt before its next use.
+    mutable VocabStats stats; ///< Word statistics, updated on every edit.
+    mutable bool statsKnown = true; ///< False until a lazily loaded category reads its words (or after getWordList hands out the list).
+    mutable bool countedInTotals = false; ///< Bookkeeping for WordCatVec: true once stats are included in its totals.
+    uint64_t version; ///< Changes (to a value never used before) every time the name or the words change.
+    mutable uint64_t hashedVersion = 0; ///< The version contentHash was computed for (0: never).
+    mutable uint64_t wordsHash = 0;     ///< The last contentHash.
+
+    /**
+     * @brief Reads the words from sourceFile the first time they are needed.
+     */
+    void ensureMaterialized() const;
+
+    /**
+     * @brief Rebuilds the filter from the words if it is stale or overfull.
+     */
+    void refreshFilter() const;
+
+    /**
+     * @brief Builds the anagram index from the words if it is stale.
+     */
+    void refreshAnagrams() const;
+
+    /**
+     * @brief Builds the positional index from the words if it is stale.
+     */
+    void refreshPositions() const;
+
+    /**
+     * @brief Records that a word was added, keeping the filter up to date.
+     * @param word The word that was added.
+     */
+    void wordAdded(const std::string &word);
+
+    /**
+     * @brief Records that every copy of a word was removed.
+     * @param word The word that was removed.
+     * @param copies How many copies there were.
+     */
+    void wordRemoved(const std::string &word, size_t copies);
+
+    /**
+     * @brief Records that words were removed or may have changed in an unknown way.
+     */
+    void wordsChanged();
+
+    /**
+     * @brief Moves the words back from the compressed form into word_list, so they can be edited.
+     */
+    void expand();
 
     /**
      * @brief Displays a menu of options and prompts for user input.
@@ -92,12 +176,306 @@ public:
      */
     void saveToFile(const std::string &filename) const;
 
+    /**
+     * @brief Writes the category in the text file format ("#name", then one word per line and a blank line).
+     * @param sout The output stream, eg. a file several categories are saved to.
+     */
+    void saveTo(std::ostream &sout) const;
+
     /**
      * @brief Loads the category from a specified text file.
      * @param filename The name of the file to load from.
      */
     void loadFromFile(const std::string &filename);
 
+    /**
+     * @brief Switches the category to the compressed, read-optimized form.
+     * Words are kept sorted and front coded; the original insertion order is not kept.
+     * Any edit switches the category back to the normal form.
+     */
+    void compress();
+
+    /**
+     * @brief Switches the category back from the compressed form to the normal, editable form.
+     */
+    void decompress();
+
+    /**
+     * @brief Returns true if the category is currently stored in compressed form.
+     * @return True if the category is compressed.
+     */
+    bool isCompressed() const;
+
+    /**
+     * @brief Returns true if a word is in this category, whichever form it is stored in.
+     * @param word The word to look for.
+     * @return True if the word is in the category, false otherwise.
+     */
+    bool lookup(const std::string &word) const;
+
+    /**
+     * @brief Removes every word from this category.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the number of words in this category.
+     * @return The number of words in this category.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Adds words at the end of the category, along with their statistics.
+     * Used by the loaders, which compute both in the same pass over the file.
+     * @param words The words to add (taken over if the category is empty).
+     * @param wordStats The statistics of words (taken over if the category has no words yet).
+     */
+    void appendWords(WordList &&words, VocabStats &&wordStats);
+
+    /**
+     * @brief Removes some copies of some words and appends others, in one pass over the category.
+     * Used to apply the difference between two versions of a file without reloading it.
+     * @param removed Word -> number of copies to remove (the first copies found are removed).
+     * @param added The words to append.
+     * @param addedStats The statistics of added.
+     * @return The statistics of the words actually removed (distinct words included).
+     */
+    VocabStats applyDiff(std::unordered_map<std::string, size_t> removed, WordList &&added, VocabStats &&addedStats);
+
+    /**
+     * @brief Returns the statistics of this category, kept up to date on every edit.
+     * The distinct words are counted the first time they are asked for, and kept up to date after.
+     * @param distinctWords False if only the word count, lengths and first letters are needed: the
+     * distinct words are then not counted just for this (VocabStats::tracksDistinct tells whether they are).
+     * @return The statistics of this category.
+     */
+    const VocabStats &getStats(bool distinctWords = true) const;
+
+    /**
+     * @brief Returns true if the statistics are already known (false for a lazily loaded category not read yet).
+     * @return True if getStats() does not need to read the words.
+     */
+    bool hasStats() const;
+
+    /**
+     * @brief Marks whether this category's statistics are included in its WordCatVec's totals.
+     * @param counted True if they are included.
+     */
+    void setCountedInTotals(bool counted) const;
+
+    /**
+     * @brief Returns whether this category's statistics are included in its WordCatVec's totals.
+     * @return True if they are included.
+     */
+    bool isCountedInTotals() const;
+
+    /**
+     * @brief Returns a number that changes every time the name or the words change.
+     * Two categories never share a version unless one is a copy of the other.
+     * @return The version of this category.
+     */
+    uint64_t getVersion() const;
+
+    /**
+     * @brief Returns a hash of the words, whatever their order (so a compressed copy hashes the same).
+     * Computed once per version : asking again before an edit costs nothing.
+     * @return The hash.
+     */
+    uint64_t contentHash() const;
+
+    /**
+     * @brief Returns what one word adds to contentHash, so the words of a file can be hashed the same way.
+     * @param word The word.
+     * @return The word's share of the hash.
+     */
+    static uint64_t contentHashOf(std::string_view word);
+
+    /**
+     * @brief Tells where the words are on disk, for a lazily loaded category that was not edited.
+     * @param filename Receives the file the words are in.
+     * @param extent Receives where the words are in the file.
+     * @return True if the words are exactly the ones in the file.
+     */
+    bool getSource(std::string &filename, CategoryExtent &extent) const;
+
+    /**
+     * @brief Calls emit with every distinct word using exactly the given letters (case-insensitive).
+     * @param letters The letters, in any order.
+     * @param emit Called with each word.
+     * @return The number of words found.
+     */
+    size_t findAnagrams(const std::string &letters, const std::function<void(const std::string &)> &emit) const;
+
+    /**
+     * @brief Calls emit with every distinct word that can be formed from some tiles, each tile used at most once.
+     * @param tiles The letters available (case-insensitive); '?' is a blank standing for any letter.
+     * @param emit Called with each word.
+     * @param minLength Shortest word to report.
+     * @return The number of words found.
+     */
+    size_t findFormable(const std::string &tiles, const std::function<void(const std::string &)> &emit, size_t minLength = 1) const;
+
+    /**
+     * @brief Calls emit with every distinct word fitting a crossword pattern, such as "?a???e?".
+     * @param pattern One character per letter of the word: the letter it must have there (case-insensitive), or '?', '.' or '_' for any.
+     * @param emit Called with each word.
+     * @return The number of words found.
+     */
+    size_t findCrossword(const std::string &pattern, const std::function<void(const std::string &)> &emit) const;
+
+    /**
+     * @brief Returns the first words in sorted order (case-insensitive, the order of option 7).
+     * Only sorts as far as needed: O(n + k log k).
+     * @param k The number of words.
+     * @return The first k words, sorted.
+     */
+    std::vector<std::string> firstSorted(size_t k) const;
+
+    /**
+     * @brief Returns one page of the words in sorted order (case-insensitive, the order of option 7).
+     * Pages are served from a cursor kept until the words change, so the next page only
+     * sorts the words it shows.
+     * @param page The page number, from 0.
+     * @param size The number of words per page.
+     * @return The words of the page (none past the last page).
+     */
+    std::vector<std::string> sortedPage(size_t page, size_t size) const;
+
+    /**
+     * @brief Returns the words that come after a key in sorted order (case-insensitive, ties by bytes).
+     * @param key The key (need not be in the category).
+     * @param count The maximum number of words.
+     * @return Up to count words, sorted, all after key.
+     */
+    std::vector<std::string> sortedAfter(const std::string &key, size_t count) const;
+
+    /**
+     * @brief Returns one page of the words in their own order, in O(size).
+     * @param page The page number, from 0.
+     * @param size The number of words per page.
+     * @return The words of the page (none past the last page).
+     */
+    std::vector<std::string> page(size_t page, size_t size) const;
+
+    /**
+     * @brief Sets the number of words per page shown by options 1 and 7.
+     * @param size The number of words per page (0 shows everything at once).
+     */
+    void setPageSize(size_t size);
+
+    /**
+     * @brief Sets who is told how long each command of run takes.
+     * @param observer Called after each command (empty to stop timing).
+     */
+    void setCommandObserver(CommandObserver observer);
+
+    /**
+     * @brief Prints pages one at a time, asking before each next one.
+     * @param sout The output stream.
+     * @param total The number of words.
+     * @param size The number of words per page.
+     * @param pageAt Returns the words of a page.
+     */
+    static void showPages(std::ostream &sout, size_t total, size_t size, const std::function<std::vector<std::string>(size_t)> &pageAt);
+
+    /**
+     * @brief Returns the words sorted (by their bytes) with duplicates removed.
+     * Built on first use and kept until the words change.
+     * @return The sorted, unique words.
+     */
+    const std::vector<std::string> &sortedWords() const;
+
+    /**
+     * @brief Makes this a lazily loaded category: the words stay in the file until they are first needed.
+     * Any words already in the category are dropped.
+     * @param filename The file the words are in.
+     * @param extent Where the words are in the file.
+     */
+    void setSource(const std::string &filename, const CategoryExtent &extent);
+
+    /**
+     * @brief Points an unedited lazily loaded category at the new place of its (unchanged) words in its file.
+     * @param filename The file the words are in.
+     * @param extent The new place of the words in the file.
+     * @return False if the category is not an unedited category loaded from filename.
+     */
+    bool relocateSource(const std::string &filename, const CategoryExtent &extent);
+
+    /**
+     * @brief Returns false while a lazily loaded category has not read its words yet.
+     * @return True if the words are in memory.
+     */
+    bool isMaterialized() const;
+
+    /**
+     * @brief Drops the words of a lazily loaded category from memory; they are read again when needed.
+     * Categories that were edited are never dropped.
+     * @return True if the words were dropped.
+     */
+    bool evict();
+
+    /**
+     * @brief Returns when the words were last needed (a counter shared by all categories).
+     * @return When the words were last needed.
+     */
+    uint64_t getLastUsed() const;
+
+    /**
+     * @brief Returns a rough estimate of the memory used by the words currently in memory.
+     * @return The estimated number of bytes.
+     */
+    size_t memoryEstimate() const;
+
+    /**
+     * @brief Returns where the bytes of this category go (words, list nodes, filter, caches, unused capacity).
+     * Walks the words: use memoryEstimate when only a quick total is needed.
+     * @return The memory used by this category.
+     */
+    MemoryUsage memoryBreakdown() const;
+
+    /**
+     * @brief Rebuilds the words into tight storage and drops caches that would be rebuilt anyway.
+     * The words, their order and the version do not change.
+     */
+    void shrinkToFit();
+
+    /**
+     * @brief Returns the word at a position, in constant time (in sorted order while compressed).
+     * @param n The position of the word.
+     * @return The word at that position.
+     * @throws std::out_of_range if n is not a valid position.
+     */
+    std::string wordAt(size_t n) const;
+
+    /**
+     * @brief Picks k distinct words of this category uniformly at random.
+     * @param k The number of words to pick.
+     * @param rng The random number generator to use.
+     * @return The picked words.
+     */
+    std::vector<std::string> sample(size_t k, std::mt19937 &rng) const;
+
+    /**
+     * @brief Picks k words (with replacement), each with a probability proportional to its weight.
+     * @param k The number of words to pick.
+     * @param weight Returns the weight of a word.
+     * @param rng The random number generator to use.
+     * @return The picked words.
+     */
+    std::vector<std::string> sampleWeighted(size_t k, const std::function<double(const std::string &)> &weight, std::mt19937 &rng) const;
+
+    /**
+     * @brief Sets the false positive rate of the lookup filter (applies at the next rebuild).
+     * @param rate The wanted false positive rate (eg. 0.01 for 1%).
+     */
+    void setFilterFalsePositiveRate(double rate);
+
+    /**
+     * @brief Returns the hit / miss counters of the lookup filter.
+     * @return The hit / miss counters of the lookup filter.
+     */
+    BloomFilter::Stats getFilterStats() const;
+
     /**
      * @brief Output stream operator overload for WordCat.
      * @param out The output stream.
@@ -107,10 +485,10 @@ public:
     friend std::ostream &operator<<(std::ostream &out, const WordCat &wc);
 
     /**
-     * @brief Returns the name of this category.
+     * @brief Returns the name of this category, without copying it.
      * @return The name of this category.
      */
-    std::string getCatName() const;
+    const std::string &getCatName() const;
 
     /**
      * @brief Returns the list of words in this category.
@@ -124,5 +502,12 @@ public:
      */
     vector<string> getWords() const;
 
+    /**
+     * @brief Calls visit for every word in this category without copying the words
+     * (in sorted order while compressed).
+     * @param visit Called with a view of each word, valid only during the call.
+     */
+    void forEachWord(const std::function<void(std::string_view)> &visit) const;
+
 #endif // WORDCAT_H
 };
@@ -1,9 +1,51 @@
 #include "WordCatVec.h"
+#include "VocabDiff.h"
+#include "Compression.h"
 #include <iostream>
 #include <algorithm>
 #include <fstream>
+#include <limits>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <malloc.h>
+#include <condition_variable>
+#include <mutex>
 using namespace std;
 
+// the categories of one file, parsed on a worker thread
+struct ParsedFile
+{
+    bool opened = false;
+    bool failed = false; // the file was cut short or could not be decompressed
+    vector<VocabParser::Category> categories; // in file order, the words counted in the same pass as they are parsed
+};
+
+// reads and parses a whole file; only touches its own WordLists so several can run at once
+static ParsedFile parseFile(const string &filename)
+{
+    ParsedFile parsed;
+    DecompressingReader file(filename); // reads ahead (and decompresses on a thread of its own) while the blocks are parsed here
+    if (!file.isOpen())
+    {
+        return parsed;
+    }
+    parsed.opened = true;
+    VocabParser parser;
+    const char *data;
+    size_t length;
+    while (file.next(data, length))
+    {
+        parser.feed(data, length);
+    }
+    parser.finish();
+    parsed.failed = file.failed();
+    parsed.categories = move(parser.getCategories());
+    return parsed;
+}
+
 char WordCatVec::menu()
 {
     cout << "=========  Menu: =========\n";
@@ -16,9 +58,26 @@ char WordCatVec::menu()
     cout << "7. Show All Categories (Sorted Individually)\n";
     cout << "8. Load from Text File\n";
     cout << "9. Save to Text File\n";
+    cout << "a. Search for Word in All Categories\n";
+    cout << "b. Configure Lazy Loading\n";
+    cout << "c. Category Set Operations\n";
+    cout << "d. Show Vocabulary Statistics\n";
+    cout << "e. Configure Autosave\n";
+    cout << "f. Watch Loaded Files for Changes\n";
+    cout << "g. Show Memory Usage / Compact\n";
+    cout << "h. Search Words Matching a Pattern\n";
+    cout << "i. Freeze to / Search in a Read-Only Dictionary File\n";
+    cout << "j. Configure Paging\n";
+    cout << "k. Find Anagrams / Words Formable from Tiles\n";
+    cout << "l. Spell-Check a Document\n";
+    cout << "m. Diff / Merge Vocabulary Files\n";
+    cout << "n. Crossword Search\n";
     cout << "0. Exit\n";
     char choice;
-    cin >> choice; // user inputs a character
+    if (!(cin >> choice)) // user inputs a character
+    {
+        return '0'; // end of input : nobody is left to type anything
+    }
     return choice;
 }
 
@@ -36,6 +95,22 @@ void WordCatVec::handleOption(int option)
         }
         else
             cout << "\nCategories:\n";
+        if (pageSize > 0) // only the first page of each category, read by position
+        {
+            for (const auto &wc : theVector)
+            {
+                cout << "\n\nCategory Name:" << wc.getCatName() << "\n";
+                for (const auto &word : wc.page(0, pageSize))
+                {
+                    cout << word << '\n';
+                }
+                if (wc.size() > pageSize)
+                {
+                    cout << "... " << wc.size() - pageSize << " more words\n";
+                }
+            }
+            break;
+        }
         cout << *this; // calls the overloaded << operator to print the current WordCatVec object / current instance of the class WordCatVec
                        // * this is a pointer (to the current object)
                        // we know what is the current object because we are inside a member function of that class -> WordCatVec::handleOption(int option)
@@ -52,6 +127,7 @@ void WordCatVec::handleOption(int option)
             {
 
                 theVector.push_back(WordCat(name));
+                countCategory(theVector.back());
                 sort(theVector.begin(), theVector.end(), [](const WordCat &a, const WordCat &b)
                      { return a.getCatName() < b.getCatName(); });
             }
@@ -61,9 +137,17 @@ void WordCatVec::handleOption(int option)
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cout << "Enter category name to remove: ";
         getline(cin, name);
+        for (const auto &wc : theVector)
+        {
+            if (wc.getCatName() == name)
+            {
+                uncountCategory(wc);
+            }
+        }
         theVector.erase(remove_if(theVector.begin(), theVector.end(), [&](const WordCat &wc)
                                   { return wc.getCatName() == name; }),
                         theVector.end());
+        filterStale = true; // a Bloom filter cannot forget words, rebuild it at the next search
         break;
     case '4':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -74,9 +158,12 @@ void WordCatVec::handleOption(int option)
             if (wc.getCatName() == name) // if the category name matches the input
             {
                 // get the WordList object from the WordCat object and clear it
-                wc.getWordList().clear();
+                uncountCategory(wc);
+                wc.clear();
+                countCategory(wc);
             }
         }
+        filterStale = true;
         break;
     case '5':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -86,18 +173,31 @@ void WordCatVec::handleOption(int option)
         {
             if (wc.getCatName() == name) // if the category name matches the input
             {
-                wc.run(); // call the run function of the WordCat object
+                uncountCategory(wc); // take the old numbers out, put the new ones back in after the edits
+                wc.setPageSize(pageSize);
+                wc.setCommandObserver(observer);
+                wc.run();            // call the run function of the WordCat object
+                countCategory(wc);
             }
         }
+        filterStale = true; // the category may have been edited
         break;
     case '6': // display all words of every category mixed together (sorted)
               // Create a new vector to hold all words
+        if (pageSize > 0) // sort only the pages that get shown
+        {
+            SortedCursor cursor = allWordsCursor(); // kept for every page : the next one continues where this one stopped
+            WordCat::showPages(cout, cursor.size(), pageSize, [&](size_t p)
+                               { cursor.seek(p * pageSize);
+                                 return cursor.next(pageSize); });
+            break;
+        }
 
         // Add all words from all categories to the new vector
         for (const auto &wc : theVector)
         {
-            vector<string> words = wc.getWords(); //  getWords() returns the words of a category
-            allWords.insert(allWords.end(), words.begin(), words.end());
+            wc.forEachWord([&](string_view word) //  forEachWord() shows each word of a category, without an intermediate copy
+                           { allWords.emplace_back(word); });
         }
 
         // Sort the new vector
@@ -116,8 +216,8 @@ void WordCatVec::handleOption(int option)
               // // the lambda function takes two WordCat objects as arguments (a and b) and returns a boolean
         sort(theVector.begin(), theVector.end(), [](const WordCat &a, const WordCat &b)
              {
-    string catNameA = a.getCatName();
-    string catNameB = b.getCatName();
+    const string &catNameA = a.getCatName(); // references : comparing names must not copy them
+    const string &catNameB = b.getCatName();
 
     return catNameA < catNameB; }); // if true the first object will be placed before the second object (so goes from a to z)
 
@@ -133,14 +233,30 @@ void WordCatVec::handleOption(int option)
         for (const auto &wc : theVector)
         {
             cout << wc.getCatName() << '\n';
+            if (pageSize > 0 && wc.size() > pageSize) // top of each category only: O(n + k log k) instead of a full sort
+            {
+                for (const auto &word : wc.firstSorted(pageSize))
+                {
+                    cout << word << '\n';
+                }
+                cout << "... " << wc.size() - pageSize << " more words\n\n";
+                continue;
+            }
             wc.show_sorted(cout, 1);
         }
         break;
     case '8':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cout << "Enter filename to load from: ";
+        cout << "Enter filename (or directory) to load from: ";
         getline(cin, filename);
-        loadFromFile(filename);
+        if (filesystem::is_directory(filename))
+        {
+            loadFromDirectory(filename);
+        }
+        else
+        {
+            loadFromFile(filename);
+        }
         break;
     case '9':
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -148,6 +264,335 @@ void WordCatVec::handleOption(int option)
         getline(cin, filename);
         saveToFile(filename);
         break;
+    case 'a':
+    {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter word to search: ";
+        getline(cin, name);
+        vector<string> found = findWord(name);
+        if (found.empty())
+        {
+            cout << "Word not found in any category.\n";
+        }
+        for (const auto &catName : found)
+        {
+            cout << "Found in: " << catName << '\n';
+        }
+        break;
+    }
+    case 'b':
+    {
+        char answer;
+        cout << "Load categories lazily (y/n)? ";
+        cin >> answer;
+        setLazyLoading(answer == 'y' || answer == 'Y');
+        size_t kilobytes;
+        cout << "Memory budget in KB for lazily loaded categories (0 for no limit): ";
+        if (cin >> kilobytes)
+        {
+            setMemoryBudget(kilobytes * 1024);
+        }
+        else
+        {
+            cin.clear();
+        }
+        break;
+    }
+    case 'c':
+    {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        string opName;
+        SetOps::Operation op;
+        cout << "Operation (union, intersection, difference, symmetric): ";
+        getline(cin, opName);
+        if (!SetOps::parse(opName, op))
+        {
+            cout << "Unknown operation.\n";
+            break;
+        }
+        vector<string> catNames;
+        cout << "Enter category names, one per line (empty line to finish):\n";
+        while (getline(cin, name) && !name.empty())
+        {
+            catNames.push_back(name);
+        }
+        cout << "Name of the new category (empty to just print the result): ";
+        getline(cin, name);
+        bool ok = name.empty() ? setOperation(op, catNames, [](const string &word)
+                                              { cout << word << '\n'; })
+                               : setOperationToCategory(op, catNames, name);
+        if (!ok)
+        {
+            cout << "Category not found.\n";
+        }
+        break;
+    }
+    case 'd':
+        cout << "\nAll categories:\n"
+             << getStats();
+        for (const auto &wc : theVector)
+        {
+            const VocabStats &catStats = wc.getStats();
+            cout << wc.getCatName() << ": " << catStats.wordCount() << " words, " << catStats.uniqueCount() << " unique\n";
+        }
+        cout << '\n';
+        break;
+    case 'e':
+    {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        AutoSaver::Config config;
+        cout << "Enter autosave filename (empty to turn autosave off): ";
+        getline(cin, config.filename);
+        if (config.filename.empty())
+        {
+            disableAutosave();
+            cout << "Autosave off.\n";
+            break;
+        }
+        long seconds;
+        size_t threshold;
+        cout << "Save at most how many seconds after an edit: ";
+        cin >> seconds;
+        cout << "Save right away after how many edited categories: ";
+        cin >> threshold;
+        if (!cin || seconds < 0)
+        {
+            cin.clear();
+            cout << "Invalid settings, autosave unchanged.\n";
+            break;
+        }
+        config.interval = chrono::seconds(seconds);
+        config.dirtyThreshold = threshold;
+        enableAutosave(config);
+        cout << "Autosaving to " << config.filename << ".\n";
+        break;
+    }
+    case 'f':
+    {
+        char answer;
+        cout << "Reload categories when the loaded files change (y/n)? ";
+        cin >> answer;
+        bool on = answer == 'y' || answer == 'Y';
+        if (!setWatching(on))
+        {
+            cout << "Cannot watch files on this system.\n";
+        }
+        else if (on)
+        {
+            cout << "Watching " << loadedFiles.size() << " files.\n";
+        }
+        break;
+    }
+    case 'g':
+    {
+        for (const auto &wc : theVector)
+        {
+            cout << wc.getCatName() << ": " << wc.memoryBreakdown();
+        }
+        cout << "All categories: " << memoryBreakdown();
+        char answer;
+        cout << "Compact now (y/n)? ";
+        cin >> answer;
+        if (answer == 'y' || answer == 'Y')
+        {
+            size_t released = compact();
+            cout << "Released " << released << " bytes. Now: " << memoryBreakdown();
+        }
+        break;
+    }
+    case 'h':
+    {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter pattern (glob like *shirt or s?ock*, or regex starting with ^ or ending with $): ";
+        getline(cin, name);
+        try
+        {
+            Pattern pattern(name, Pattern::guessSyntax(name));
+            size_t found = findPattern(pattern, [](const string &catName, const string &word)
+                                       { cout << catName << ": " << word << '\n'; });
+            cout << found << " matches.\n";
+        }
+        catch (const invalid_argument &error)
+        {
+            cout << "Invalid pattern: " << error.what() << '\n';
+        }
+        break;
+    }
+    case 'i':
+    {
+        char answer;
+        cout << "(f)reeze the categories to a file, or (s)earch a frozen file? ";
+        cin >> answer;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter frozen dictionary filename: ";
+        getline(cin, filename);
+        if (answer == 'f' || answer == 'F')
+        {
+            FrozenDictionary frozen = freeze();
+            if (frozen.save(filename))
+            {
+                cout << "Froze " << frozen.wordCount() << " words in " << frozen.categoryCount() << " categories (" << frozen.byteSize() << " bytes).\n";
+            }
+            break;
+        }
+        FrozenDictionary frozen;
+        if (!FrozenDictionary::open(filename, frozen))
+        {
+            cout << "Not a frozen dictionary: " << filename << '\n';
+            break;
+        }
+        cout << "Enter word to search: ";
+        getline(cin, name);
+        vector<size_t> found = frozen.categoriesOf(name);
+        if (found.empty())
+        {
+            cout << "Word not found in any category.\n";
+        }
+        for (size_t category : found)
+        {
+            cout << "Found in: " << frozen.categoryName(category) << '\n';
+        }
+        break;
+    }
+    case 'j':
+        cout << "Words per page (0 to show everything at once): ";
+        if (!(cin >> pageSize))
+        {
+            cin.clear();
+            pageSize = 0;
+        }
+        cout << (pageSize > 0 ? "Paging on.\n" : "Paging off.\n");
+        break;
+    case 'k':
+    {
+        char answer;
+        cout << "(a)nagrams of some letters, or words (f)ormable from tiles? ";
+        cin >> answer;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << (answer == 'f' || answer == 'F' ? "Enter tiles (? for a blank): " : "Enter letters: ");
+        getline(cin, name);
+        vector<pair<string, string>> found = (answer == 'f' || answer == 'F') ? findFormable(name, 2) : findAnagrams(name);
+        for (const auto &hit : found)
+        {
+            cout << hit.first << ": " << hit.second << '\n';
+        }
+        cout << found.size() << " words.\n";
+        break;
+    }
+    case 'l':
+    {
+        char answer;
+        cout << "Report (u)nknown words only, or (a)ll words with their categories? ";
+        cin >> answer;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter document filename: ";
+        getline(cin, filename);
+        SpellChecker::Summary summary;
+        bool read = spellCheck(
+            filename, [](const SpellChecker::Token &token, const vector<string_view> &categories)
+            {
+                cout << token.line << ':' << token.column << ' ' << token.text << ": ";
+                if (categories.empty())
+                {
+                    cout << "UNKNOWN";
+                }
+                for (size_t i = 0; i < categories.size(); ++i)
+                {
+                    cout << (i > 0 ? ", " : "") << categories[i];
+                }
+                cout << '\n'; },
+            summary, answer == 'u' || answer == 'U');
+        if (!read)
+        {
+            cout << "Error opening file: " << filename << '\n';
+            break;
+        }
+        cout << summary.tokens << " words, " << summary.unknown << " unknown, " << summary.bytes << " bytes in " << summary.seconds << " s\n";
+        break;
+    }
+    case 'm':
+    {
+        char answer;
+        cout << "(d)iff two versions, or (m)erge two versions edited from a common one? ";
+        cin >> answer;
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        // a version is a file, or * for the categories loaded here
+        auto readVersion = [&](const string &prompt, VocabDiff::Version &version)
+        {
+            cout << prompt << " (filename, or * for the loaded categories): ";
+            getline(cin, filename);
+            if (filename == "*")
+            {
+                version = VocabDiff::Version::fromCategories(*this);
+                return true;
+            }
+            if (!VocabDiff::Version::fromFile(filename, version))
+            {
+                cout << "Error opening file: " << filename << '\n';
+                return false;
+            }
+            return true;
+        };
+        VocabDiff::Version first, second, third;
+        if (answer == 'm' || answer == 'M')
+        {
+            if (!readVersion("Common version", first) || !readVersion("Our version", second) || !readVersion("Their version", third))
+            {
+                break;
+            }
+            cout << "Enter filename for the merged version: ";
+            getline(cin, filename);
+            VocabDiff::MergeReport report;
+            if (VocabDiff::merge(first, second, third, filename, report))
+            {
+                for (const auto &conflict : report.conflicts)
+                {
+                    cout << "CONFLICT " << conflict << '\n';
+                }
+                cout << report.unchanged << " categories unchanged, " << report.fromOurs << " taken from ours, " << report.fromTheirs
+                     << " from theirs, " << report.merged << " merged, " << report.conflicts.size() << " conflicts.\n";
+            }
+            break;
+        }
+        if (!readVersion("Old version", first) || !readVersion("New version", second))
+        {
+            break;
+        }
+        size_t unchanged;
+        vector<VocabDiff::CategoryChange> changes = VocabDiff::diff(first, second, unchanged);
+        VocabDiff::write(changes, cout);
+        cout << changes.size() << " categories changed, " << unchanged << " unchanged.\n";
+        break;
+    }
+    case 'n':
+    {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter pattern (? for any letter, eg. ?a???e?): ";
+        getline(cin, name);
+        cout << "Enter categories, separated by commas (empty for all): ";
+        string list;
+        getline(cin, list);
+        vector<string> names;
+        for (size_t start = 0; start < list.size();)
+        {
+            size_t comma = min(list.find(',', start), list.size());
+            string one = list.substr(start, comma - start);
+            one.erase(0, one.find_first_not_of(' '));
+            one.erase(one.find_last_not_of(' ') + 1);
+            if (!one.empty())
+            {
+                names.push_back(one);
+            }
+            start = comma + 1;
+        }
+        vector<pair<string, string>> found = findCrossword(name, names);
+        for (const auto &hit : found)
+        {
+            cout << hit.first << ": " << hit.second << '\n';
+        }
+        cout << found.size() << " words.\n";
+        break;
+    }
     case '0':
         cout << "Goodbye!\n";
         break;
@@ -163,7 +608,18 @@ void WordCatVec::run()
     do
     {
         choice = menu();      // calls the menu function and stores the return value in choice
+        auto start = chrono::steady_clock::now();
+        if (size_t changed = applyFileChanges()) // pick up what other programs wrote while the user was typing
+        {
+            cout << "Reloaded " << changed << " changed categories from watched files.\n";
+        }
         handleOption(choice); // calls the handleOption function with the choice as an argument
+        enforceBudget();      // the command may have read cold categories into memory
+        autosaveCheckpoint(); // nothing changes between two commands, so this is where a snapshot is taken
+        if (observer)
+        {
+            observer("WordCatVec", choice, chrono::steady_clock::now() - start);
+        }
     } while (choice != '0');
 }
 
@@ -177,45 +633,878 @@ void WordCatVec::write(ostream &sout, int n) const // eg. wcv.write(cout, 5);
 
 void WordCatVec::saveToFile(const string &filename) const
 {
-    ofstream outFile(filename, ios::app); // ios::app appends to the end of the file rather than overwriting it
-    if (!outFile)                         // if the file cannot be opened
+    // appends to the end of the file rather than overwriting it; compressed if the name ends in .gz or .zst
+    CompressingWriter file(filename, true, Compression::forFilename(filename));
+    if (!file.isOpen()) // if the file cannot be opened
     {
         cerr << "Error opening file for writing: " << filename << '\n';
         return;
     }
+    ostream outFile(&file); // opened once for every category; full blocks are written while the next ones are formatted
     for (const auto &wc : theVector) // for each WordCat object in the vector
     {
-        wc.saveToFile(filename); // save the WordCat object to the file
+        wc.saveTo(outFile); // save the WordCat object to the file
+    }
+    if (!file.close())
+    {
+        cerr << "Error writing file: " << filename << '\n';
     }
-    outFile.close();
 }
 
 void WordCatVec::loadFromFile(const string &filename)
 {
-    ifstream inFile(filename); // open the file
-    if (!inFile)               // if the file cannot be opened
+    if (!lazyLoading || Compression::detectFile(filename) != Compression::None) // a compressed file cannot be read from the middle : load it all now
     {
-        cerr << "Error opening file for reading: " << filename << '\n';
+        loadFromFiles({filename}); // one file is just the simplest case of several
         return;
     }
 
-    string line;                  // a string to store each line of the file
-    while (getline(inFile, line)) // read each line from the file
+    // lazy : only find where each category is, its words are read the first time they are needed
+    vector<CategoryExtent> extents;
+    if (!VocabFile::scanFile(filename, extents))
+    {
+        cerr << "Error opening file for reading: " << filename << '\n';
+        return;
+    }
+    fileLoaded(filename);
+    unordered_map<string, size_t> byName; // category name -> position in theVector
+    for (size_t i = 0; i < theVector.size(); ++i)
+    {
+        byName.emplace(theVector[i].getCatName(), i);
+    }
+    for (const auto &extent : extents)
     {
-        if (line[0] == '#')
+        auto found = byName.find(extent.name);
+        if (found == byName.end())
         {
-            string categoryName = line.substr(1);
-            WordCat wc(categoryName);
-            wc.loadFromFile(filename);
+            WordCat wc(extent.name);
+            wc.setSource(filename, extent);
+            byName.emplace(extent.name, theVector.size());
             theVector.push_back(move(wc));
+            countCategory(theVector.back()); // statistics not known yet : counted when first asked for
+        }
+        else // already have this category : its words have to be merged in now
+        {
+            string text;
+            VocabFile::readExtent(filename, extent, text);
+            WordList words;
+            VocabStats wordStats;
+            VocabFile::appendWords(text.data(), text.data() + text.size(), words, &wordStats);
+            WordCat &wc = theVector[found->second];
+            if (wc.isCountedInTotals())
+            {
+                totals.merge(wordStats);
+            }
+            wc.appendWords(move(words), move(wordStats));
+        }
+    }
+    filterStale = true;
+}
+
+void WordCatVec::loadFromFiles(const vector<string> &filenames)
+{
+    // read and parse the files on several threads, each thread taking the next file not taken yet
+    vector<ParsedFile> parsed(filenames.size());
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < filenames.size(); i = next++)
+        {
+            parsed[i] = parseFile(filenames[i]);
+        }
+    };
+    size_t threadCount = min<size_t>(filenames.size(), max(1u, thread::hardware_concurrency()));
+    vector<thread> threads;
+    for (size_t t = 1; t < threadCount; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker(); // this thread works too
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    // merge on this thread, in file order, so the result does not depend on which thread finished first
+    unordered_map<string, size_t> byName; // category name -> position in theVector
+    for (size_t i = 0; i < theVector.size(); ++i)
+    {
+        byName.emplace(theVector[i].getCatName(), i);
+    }
+    for (size_t f = 0; f < filenames.size(); ++f)
+    {
+        if (!parsed[f].opened)
+        {
+            cerr << "Error opening file for reading: " << filenames[f] << '\n';
+            continue;
+        }
+        if (parsed[f].failed) // keep what could be read
+        {
+            cerr << "Error reading file (truncated, corrupt or unsupported compression): " << filenames[f] << '\n';
+        }
+        fileLoaded(filenames[f]);
+        for (auto &category : parsed[f].categories)
+        {
+            auto found = byName.find(category.name);
+            if (found == byName.end())
+            {
+                byName.emplace(category.name, theVector.size());
+                theVector.push_back(WordCat(category.name));
+                theVector.back().appendWords(move(category.words), move(category.stats)); // a new category just takes the parsed list and numbers
+                countCategory(theVector.back());
+                continue;
+            }
+            WordCat &wc = theVector[found->second];
+            if (wc.isCountedInTotals())
+            {
+                totals.merge(category.stats);
+            }
+            wc.appendWords(move(category.words), move(category.stats));
+        }
+    }
+    filterStale = true;
+}
+
+void WordCatVec::loadFromDirectory(const string &directory)
+{
+    error_code error;
+    vector<string> filenames;
+    for (const auto &entry : filesystem::directory_iterator(directory, error))
+    {
+        if (entry.is_regular_file())
+        {
+            filenames.push_back(entry.path().string());
+        }
+    }
+    if (error)
+    {
+        cerr << "Error opening directory for reading: " << directory << '\n';
+        return;
+    }
+    sort(filenames.begin(), filenames.end()); // directory order is not stable, file name order is
+    loadFromFiles(filenames);
+}
+
+void WordCatVec::refreshFilter() const
+{
+    if (!filterStale && !filter.isOverfull())
+    {
+        return;
+    }
+    size_t total = 0;
+    for (const auto &wc : theVector)
+    {
+        total += wc.size();
+    }
+    filter.reset(total);
+    for (const auto &wc : theVector)
+    {
+        wc.forEachWord([&](string_view word)
+                       { filter.insert(word); });
+    }
+    filterStale = false;
+}
+
+vector<string> WordCatVec::findWord(const string &word) const
+{
+    vector<string> names;
+    refreshFilter();
+    if (!filter.mightContain(word)) // absent from every category : no need to ask any of them
+    {
+        return names;
+    }
+    for (const auto &wc : theVector)
+    {
+        if (wc.lookup(word)) // each category has its own filter too
+        {
+            names.push_back(wc.getCatName());
         }
     }
+    if (names.empty())
+    {
+        filter.recordFalsePositive();
+    }
+    return names;
+}
 
-    inFile.close();
+void WordCatVec::setFilterFalsePositiveRate(double rate)
+{
+    filter.setFalsePositiveRate(rate);
+    filterStale = true;
+    for (auto &wc : theVector)
+    {
+        wc.setFilterFalsePositiveRate(rate);
+    }
 }
 
+BloomFilter::Stats WordCatVec::getFilterStats() const { return filter.getStats(); }
+
 ostream &operator<<(ostream &out, const WordCatVec &wcv) // eg. cout << wcv;
 {
     wcv.write(out, 1); // calls the write function with the output stream and 5 as arguments
     return out;
 }
+
+vector<pair<string, string>> WordCatVec::sample(size_t k, mt19937 &rng) const
+{
+    vector<size_t> ends; // ends[c] = number of words in categories 0..c, so a global position maps to a category by binary search
+    size_t total = 0;
+    for (const auto &wc : theVector)
+    {
+        total += wc.size();
+        ends.push_back(total);
+    }
+    vector<pair<string, string>> picked;
+    for (size_t i : WordList::sampleIndexes(k, total, rng))
+    {
+        size_t c = upper_bound(ends.begin(), ends.end(), i) - ends.begin();
+        size_t start = (c == 0) ? 0 : ends[c - 1];
+        picked.emplace_back(theVector[c].getCatName(), theVector[c].wordAt(i - start));
+    }
+    return picked;
+}
+
+vector<pair<string, string>> WordCatVec::sampleWeighted(size_t k, const function<double(const string &, const string &)> &weight, mt19937 &rng) const
+{
+    vector<pair<size_t, size_t>> positions; // (category, word) of each weight
+    vector<double> weights;
+    for (size_t c = 0; c < theVector.size(); ++c)
+    {
+        for (size_t i = 0; i < theVector[c].size(); ++i)
+        {
+            positions.emplace_back(c, i);
+            weights.push_back(weight(theVector[c].getCatName(), theVector[c].wordAt(i)));
+        }
+    }
+    vector<pair<string, string>> picked;
+    for (size_t i : WordList::sampleWeightedIndexes(weights, k, rng))
+    {
+        const WordCat &wc = theVector[positions[i].first];
+        picked.emplace_back(wc.getCatName(), wc.wordAt(positions[i].second));
+    }
+    return picked;
+}
+
+void WordCatVec::setLazyLoading(bool lazy) { lazyLoading = lazy; }
+
+void WordCatVec::setMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+    enforceBudget();
+}
+
+FrozenDictionary WordCatVec::freeze() const
+{
+    vector<string> names;
+    vector<const vector<string> *> runs; // the sorted words each category already keeps for set operations
+    names.reserve(theVector.size());
+    runs.reserve(theVector.size());
+    for (const auto &wc : theVector)
+    {
+        names.push_back(wc.getCatName());
+        runs.push_back(&wc.sortedWords());
+    }
+    return FrozenDictionary(names, runs);
+}
+
+size_t WordCatVec::findPattern(const Pattern &pattern, const function<void(const string &, const string &)> &emit) const
+{
+    // each worker takes the next category not taken yet and keeps its matches until this thread emits them
+    vector<vector<string>> matches(theVector.size());
+    vector<char> done(theVector.size(), 0);
+    mutex doneMutex;
+    condition_variable finished;
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < theVector.size(); i = next++)
+        {
+            const vector<string> &sorted = theVector[i].sortedWords(); // each category is only touched by one thread
+            pattern.scanSorted(sorted, [&](const string &word)
+                               { matches[i].push_back(word); });
+            lock_guard<mutex> lock(doneMutex);
+            done[i] = 1;
+            finished.notify_one();
+        }
+    };
+    size_t threadCount = min<size_t>(theVector.size(), max(1u, thread::hardware_concurrency()));
+    vector<thread> threads;
+    for (size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+
+    // stream the results in category order, while the workers go on with the next categories
+    size_t found = 0;
+    for (size_t i = 0; i < theVector.size(); ++i)
+    {
+        {
+            unique_lock<mutex> lock(doneMutex);
+            finished.wait(lock, [&]()
+                          { return done[i] != 0; });
+        }
+        for (const auto &word : matches[i])
+        {
+            emit(theVector[i].getCatName(), word);
+        }
+        found += matches[i].size();
+        vector<string>().swap(matches[i]);
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    return found;
+}
+
+MemoryUsage WordCatVec::memoryBreakdown() const
+{
+    MemoryUsage usage;
+    for (const auto &wc : theVector)
+    {
+        usage += wc.memoryBreakdown(); // includes sizeof(WordCat) for each element of theVector
+    }
+    usage.slackBytes += (theVector.capacity() - theVector.size()) * sizeof(WordCat);
+    usage.overheadBytes += sizeof(*this) + filter.memoryUsage() + totals.memoryUsage();
+    for (const auto &file : watchedFiles) // the category hashes of each watched file, to tell what changed
+    {
+        for (const auto &category : file.second.categories)
+        {
+            usage.overheadBytes += sizeof(category) + category.first.capacity();
+        }
+    }
+    return usage;
+}
+
+size_t WordCatVec::compact()
+{
+    size_t before = memoryBreakdown().total();
+    for (auto &wc : theVector)
+    {
+        wc.shrinkToFit();
+    }
+    theVector.shrink_to_fit();
+    totals.shrinkToFit();
+    if (filterStale)
+    {
+        filter.release();
+    }
+    size_t after = memoryBreakdown().total();
+    malloc_trim(0); // free() keeps released memory for later; this hands the unused pages back to the system
+    return before > after ? before - after : 0;
+}
+
+size_t WordCatVec::materializedBytes() const
+{
+    size_t total = 0;
+    for (const auto &wc : theVector)
+    {
+        total += wc.memoryEstimate();
+    }
+    return total;
+}
+
+void WordCatVec::enforceBudget()
+{
+    if (memoryBudget == 0)
+    {
+        return;
+    }
+    size_t used = materializedBytes();
+    if (used <= memoryBudget)
+    {
+        return;
+    }
+    vector<WordCat *> loaded; // categories whose words are in memory, coldest first
+    for (auto &wc : theVector)
+    {
+        if (wc.isMaterialized())
+        {
+            loaded.push_back(&wc);
+        }
+    }
+    sort(loaded.begin(), loaded.end(), [](const WordCat *a, const WordCat *b)
+         { return a->getLastUsed() < b->getLastUsed(); });
+    for (WordCat *wc : loaded)
+    {
+        if (used <= memoryBudget)
+        {
+            break;
+        }
+        size_t freed = wc->memoryEstimate();
+        if (wc->evict()) // edited categories refuse, their words exist nowhere else
+        {
+            used -= freed;
+        }
+    }
+}
+
+bool WordCatVec::setOperation(SetOps::Operation op, const vector<string> &catNames, const SetOps::Emit &emit) const
+{
+    vector<const vector<string> *> runs;
+    for (const auto &catName : catNames)
+    {
+        const WordCat *found = findCategory(catName);
+        if (!found)
+        {
+            return false;
+        }
+        runs.push_back(&found->sortedWords()); // sorted once, reused until the category changes
+    }
+    SetOps::apply(op, runs, emit);
+    return true;
+}
+
+bool WordCatVec::setOperationToCategory(SetOps::Operation op, const vector<string> &catNames, const string &resultName)
+{
+    WordCat result(resultName);
+    WordList words;
+    VocabStats wordStats;
+    if (!setOperation(op, catNames, [&](const string &word)
+                      {
+        words.push_back(Word(word));
+        wordStats.add(word); }))
+    {
+        return false;
+    }
+    result.appendWords(move(words), move(wordStats));
+    theVector.push_back(move(result)); // after the operation : push_back may move the categories we were reading
+    countCategory(theVector.back());
+    filterStale = true;
+    return true;
+}
+
+void WordCatVec::countCategory(const WordCat &wc) const
+{
+    if (!wc.hasStats()) // a lazily loaded category not read yet : getStats adds it later
+    {
+        wc.setCountedInTotals(false);
+        totalsComplete = false;
+        return;
+    }
+    totals.merge(wc.getStats(false)); // the distinct words are only counted once asked for
+    wc.setCountedInTotals(true);
+}
+
+void WordCatVec::uncountCategory(const WordCat &wc) const
+{
+    if (wc.isCountedInTotals())
+    {
+        totals.subtract(wc.getStats(false));
+        wc.setCountedInTotals(false);
+    }
+    else
+    {
+        totalsComplete = false; // it was not counted yet, make sure it is once it is put back
+    }
+}
+
+const VocabStats &WordCatVec::getStats() const
+{
+    if (!totalsComplete) // only after a lazy load : count each category not counted yet, once
+    {
+        for (const auto &wc : theVector)
+        {
+            if (!wc.isCountedInTotals())
+            {
+                totals.merge(wc.getStats(false));
+                wc.setCountedInTotals(true);
+            }
+        }
+        totalsComplete = true;
+    }
+    if (!totals.tracksDistinct()) // the first time the distinct words are asked for (or a category lost track of its own) :
+    {                             // count them in every category, which keeps them up to date from then on
+        totals.clear();
+        totals.trackDistinct();
+        for (const auto &wc : theVector)
+        {
+            totals.merge(wc.getStats());
+        }
+    }
+    return totals;
+}
+
+const VocabStats *WordCatVec::getStats(const string &catName) const
+{
+    const WordCat *wc = findCategory(catName);
+    return wc ? &wc->getStats() : nullptr;
+}
+
+const WordCat *WordCatVec::findCategory(string_view catName) const
+{
+    for (const auto &wc : theVector)
+    {
+        if (wc.getCatName() == catName)
+        {
+            return &wc;
+        }
+    }
+    return nullptr;
+}
+
+void WordCatVec::forEachCategory(const function<void(const WordCat &)> &visit) const
+{
+    for (const auto &wc : theVector)
+    {
+        visit(wc);
+    }
+}
+
+void WordCatVec::enableAutosave(const AutoSaver::Config &config)
+{
+    autosaver.reset(); // the old writer finishes its pending save first
+    autosaver = make_unique<AutoSaver>(config);
+}
+
+void WordCatVec::disableAutosave()
+{
+    autosaver.reset();
+}
+
+void WordCatVec::autosaveCheckpoint()
+{
+    if (!autosaver)
+    {
+        return;
+    }
+    // count the categories added, edited or removed since the last snapshot the autosaver still holds
+    // (it only lets go of one once it is written, so a failed save is retried rather than forgotten)
+    size_t dirty = 0;
+    unordered_map<string, size_t> before; // (name + version) seen last time
+    for (const auto &entry : autosaver->latestVersions())
+    {
+        ++before[entry.first + '\0' + to_string(entry.second)];
+    }
+    for (const auto &wc : theVector)
+    {
+        auto found = before.find(wc.getCatName() + '\0' + to_string(wc.getVersion()));
+        if (found == before.end() || found->second == 0)
+        {
+            ++dirty; // new or edited
+        }
+        else
+        {
+            --found->second;
+        }
+    }
+    for (const auto &entry : before)
+    {
+        dirty += entry.second; // removed
+    }
+    if (dirty == 0)
+    {
+        return;
+    }
+
+    vector<AutoSaver::Entry> snapshot;
+    snapshot.reserve(theVector.size());
+    for (const auto &wc : theVector)
+    {
+        AutoSaver::Entry entry;
+        entry.name = wc.getCatName();
+        entry.version = wc.getVersion();
+        entry.block = autosaver->cachedBlock(entry.name, entry.version); // saved before and not changed since : nothing to copy
+        string sourceFile;
+        CategoryExtent extent;
+        // still only in its file : copy its lines now, the file may change before the writer gets to it
+        bool fromFile = !entry.block && wc.getSource(sourceFile, extent) && VocabFile::readExtent(sourceFile, extent, entry.lines);
+        if (!entry.block && !fromFile) // edited : copy the words, the writer will format them
+        {
+            entry.words.reserve(wc.size());
+            wc.forEachWord([&](string_view word)
+                           { entry.words.emplace_back(word); });
+        }
+        snapshot.push_back(move(entry));
+    }
+    autosaver->submit(move(snapshot), dirty);
+}
+
+void WordCatVec::fileLoaded(const string &filename)
+{
+    if (find(loadedFiles.begin(), loadedFiles.end(), filename) == loadedFiles.end())
+    {
+        loadedFiles.push_back(filename);
+    }
+    if (watcher)
+    {
+        watchFile(filename);
+    }
+}
+
+void WordCatVec::watchFile(const string &filename)
+{
+    string contents;
+    if (!VocabFile::readAll(filename, contents) || !watcher->add(filename))
+    {
+        cerr << "Error watching file: " << filename << '\n';
+        return;
+    }
+    WatchedFile file;
+    file.hash = BloomFilter::hash(contents);
+    vector<CategoryExtent> extents = VocabFile::scan(contents);
+    for (const auto &category : VocabFile::groupByName(contents, extents))
+    {
+        file.categories.emplace(category.name, category.hash);
+    }
+    watchedFiles[filename] = move(file); // the text itself is let go : the categories hold the words
+}
+
+bool WordCatVec::setWatching(bool on)
+{
+    watchedFiles.clear();
+    watcher.reset();
+    if (!on)
+    {
+        return true;
+    }
+    watcher = make_unique<FileWatcher>();
+    for (const auto &filename : loadedFiles)
+    {
+        watchFile(filename);
+    }
+    return loadedFiles.empty() || !watchedFiles.empty();
+}
+
+size_t WordCatVec::applyFileChanges()
+{
+    if (!watcher)
+    {
+        return 0;
+    }
+    size_t changed = 0;
+    for (const auto &filename : watcher->changedFiles())
+    {
+        changed += reloadFile(filename);
+    }
+    return changed;
+}
+
+size_t WordCatVec::reloadFile(const string &filename)
+{
+    auto watchedIt = watchedFiles.find(filename);
+    if (watchedIt == watchedFiles.end())
+    {
+        return 0;
+    }
+    WatchedFile &old = watchedIt->second;
+    string contents;
+    if (!VocabFile::readAll(filename, contents)) // gone for now (being replaced)
+    {
+        return 0;
+    }
+    uint64_t hash = BloomFilter::hash(contents);
+    if (hash == old.hash) // rewritten as it was
+    {
+        return 0;
+    }
+    vector<CategoryExtent> extents = VocabFile::scan(contents);
+    vector<FileCategory> after = VocabFile::groupByName(contents, extents);
+    unordered_map<string, size_t> byName; // category name -> position in theVector
+    for (size_t i = 0; i < theVector.size(); ++i)
+    {
+        byName.emplace(theVector[i].getCatName(), i);
+    }
+
+    size_t changed = 0;
+    string source;
+    CategoryExtent sourceExtent;
+    for (const auto &category : after)
+    {
+        auto previous = old.categories.find(category.name);
+        auto found = byName.find(category.name);
+        if (previous != old.categories.end() && previous->second == category.hash) // same bytes : nothing to parse, the words may just have moved
+        {
+            if (found != byName.end() && category.extents.size() == 1)
+            {
+                theVector[found->second].relocateSource(filename, *category.extents[0]);
+            }
+            continue;
+        }
+        ++changed;
+        if (found == byName.end()) // a new category
+        {
+            WordCat wc(category.name);
+            if (lazyLoading && category.extents.size() == 1)
+            {
+                wc.setSource(filename, *category.extents[0]);
+            }
+            else
+            {
+                WordList words;
+                VocabStats wordStats;
+                VocabFile::forEachWordOf(contents, category, [&](const string &word)
+                              {
+                    words.push_back(Word(word));
+                    wordStats.add(word); });
+                wc.appendWords(move(words), move(wordStats));
+            }
+            byName.emplace(category.name, theVector.size());
+            theVector.push_back(move(wc));
+            countCategory(theVector.back());
+            continue;
+        }
+        WordCat &wc = theVector[found->second];
+        uncountCategory(wc);
+        if (category.extents.size() == 1 && wc.getSource(source, sourceExtent) && source == filename)
+        {
+            wc.setSource(filename, *category.extents[0]); // still exactly what the file says : just point at the new words
+        }
+        else
+        {
+            // match the new words against the ones the category holds : what is left on either side is the diff
+            unordered_map<string, size_t> removed;
+            wc.forEachWord([&](string_view word)
+                           { ++removed[string(word)]; });
+            WordList added;
+            VocabStats addedStats;
+            VocabFile::forEachWordOf(contents, category, [&](const string &word)
+                          {
+                auto match = removed.find(word);
+                if (match != removed.end() && match->second > 0)
+                {
+                    --match->second;
+                    return;
+                }
+                added.push_back(Word(word));
+                addedStats.add(word); });
+            for (auto it = removed.begin(); it != removed.end();)
+            {
+                it = it->second == 0 ? removed.erase(it) : next(it);
+            }
+            wc.applyDiff(move(removed), move(added), move(addedStats));
+        }
+        countCategory(wc);
+    }
+
+    // categories that are not in the file anymore : their words came from it, so they go with it
+    unordered_set<string> inNewVersion;
+    for (const auto &category : after)
+    {
+        inNewVersion.insert(category.name);
+    }
+    vector<bool> drop(theVector.size(), false);
+    for (const auto &category : old.categories)
+    {
+        auto found = byName.find(category.first);
+        if (inNewVersion.count(category.first) || found == byName.end())
+        {
+            continue;
+        }
+        ++changed;
+        uncountCategory(theVector[found->second]);
+        drop[found->second] = true;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < theVector.size(); ++i)
+    {
+        if (!drop[i])
+        {
+            if (kept != i)
+            {
+                theVector[kept] = move(theVector[i]);
+            }
+            ++kept;
+        }
+    }
+    theVector.erase(theVector.begin() + kept, theVector.end());
+
+    old.hash = hash;
+    old.categories.clear();
+    for (const auto &category : after)
+    {
+        old.categories.emplace(category.name, category.hash);
+    }
+    if (changed > 0)
+    {
+        filterStale = true;
+    }
+    return changed;
+}
+
+SortedCursor WordCatVec::allWordsCursor() const
+{
+    vector<string_view> views;
+    deque<string> decoded; // compressed categories only hand out temporary copies : the cursor keeps them (a deque never moves them)
+    for (const auto &wc : theVector)
+    {
+        wc.forEachWord([&](string_view word)
+                       {
+            if (wc.isCompressed())
+            {
+                decoded.emplace_back(word);
+                word = decoded.back();
+            }
+            views.push_back(word); });
+    }
+    return SortedCursor(move(views), [](string_view a, string_view b)
+                        { return a < b; }, // the same order as sort() on strings
+                        move(decoded));
+}
+
+void WordCatVec::setPageSize(size_t size) { pageSize = size; }
+
+void WordCatVec::setCommandObserver(CommandObserver observer) { this->observer = move(observer); }
+
+vector<pair<string, string>> WordCatVec::findAnagrams(const string &letters) const
+{
+    vector<pair<string, string>> found;
+    for (const auto &wc : theVector)
+    {
+        wc.findAnagrams(letters, [&](const string &word)
+                        { found.emplace_back(wc.getCatName(), word); });
+    }
+    return found;
+}
+
+vector<pair<string, string>> WordCatVec::findFormable(const string &tiles, size_t minLength) const
+{
+    vector<pair<string, string>> found;
+    for (const auto &wc : theVector)
+    {
+        size_t first = found.size();
+        wc.findFormable(tiles, [&](const string &word)
+                        { found.emplace_back(wc.getCatName(), word); },
+                        minLength);
+        // best plays first : longest words, then alphabetically
+        sort(found.begin() + first, found.end(), [](const pair<string, string> &a, const pair<string, string> &b)
+             { return a.second.size() != b.second.size() ? a.second.size() > b.second.size() : a.second < b.second; });
+    }
+    return found;
+}
+
+vector<pair<string, string>> WordCatVec::findCrossword(const string &pattern, const vector<string> &categoryNames) const
+{
+    vector<pair<string, string>> found;
+    for (const auto &wc : theVector)
+    {
+        if (!categoryNames.empty() && find(categoryNames.begin(), categoryNames.end(), wc.getCatName()) == categoryNames.end())
+        {
+            continue;
+        }
+        wc.findCrossword(pattern, [&](const string &word)
+                         { found.emplace_back(wc.getCatName(), word); });
+    }
+    return found;
+}
+
+bool WordCatVec::spellCheck(const string &filename, const function<void(const SpellChecker::Token &, const vector<string_view> &)> &emit, SpellChecker::Summary &summary, bool unknownOnly) const
+{
+    FrozenDictionary dictionary = freeze(); // one probe per word, whatever the number of categories
+    SpellChecker::Options options;
+    options.reportKnown = !unknownOnly;
+    SpellChecker checker(dictionary, options);
+    vector<string_view> categories; // reused for every token
+    return checker.checkFile(filename, [&](const SpellChecker::Token &token)
+                             {
+        categories.clear();
+        if (token.known())
+        {
+            for (size_t category : dictionary.categoriesOfSlot(token.slot))
+            {
+                categories.push_back(dictionary.categoryName(category));
+            }
+        }
+        emit(token, categories); },
+                             summary);
+}
@@ -2,8 +2,18 @@
 #define WORDCATVEC_H
 
 #include "WordCat.h"
+#include "SetOps.h"
+#include "AutoSaver.h"
+#include "FileWatcher.h"
+#include "Pattern.h"
+#include "FrozenDictionary.h"
+#include "SpellChecker.h"
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
+#include <string_view>
+#include <unordered_map>
 
 /**
  * @class WordCatVec
@@ -13,6 +23,77 @@ class WordCatVec
 {
 private:
     std::vector<WordCat> theVector; ///< The underlying container storing WordCat objects.
+    mutable BloomFilter filter;      ///< Fast-reject filter over the words of every category, rebuilt lazily.
+    mutable bool filterStale = true; ///< True when any category may have changed since the filter was built.
+    bool lazyLoading = false;        ///< When true, loadFromFile only scans the category directory; words are read on first use.
+    size_t memoryBudget = 0;         ///< Bytes lazily loaded categories may use before cold ones are dropped (0 means no limit).
+    mutable VocabStats totals;       ///< Statistics over every category, updated on every edit.
+    mutable bool totalsComplete = true; ///< False while some lazily loaded category is not included in totals yet.
+    std::unique_ptr<AutoSaver> autosaver; ///< Background writer, or nullptr when autosave is off.
+    size_t pageSize = 0;             ///< Words per page in the listings (0 shows everything at once).
+    CommandObserver observer;        ///< Told how long each command took, here and inside categories (empty: nobody is timing).
+
+    /**
+     * @brief What a watched file looked like when it was last loaded, to find which of its categories changed.
+     * Only hashes are kept: the words of a changed category are diffed against the live category.
+     */
+    struct WatchedFile
+    {
+        uint64_t hash = 0;                                    ///< Hash of the whole file.
+        std::unordered_map<std::string, uint64_t> categories; ///< Category name -> hash of its bytes.
+    };
+    std::vector<std::string> loadedFiles;                        ///< Every file loaded so far, in order.
+    std::unique_ptr<FileWatcher> watcher;                        ///< Watches loadedFiles, or nullptr when watching is off.
+    std::unordered_map<std::string, WatchedFile> watchedFiles;   ///< filename -> its last loaded version.
+
+    /**
+     * @brief Adds a category's statistics to the totals (or remembers to do it later if they are not known yet).
+     * @param wc The category.
+     */
+    void countCategory(const WordCat &wc) const;
+
+    /**
+     * @brief Removes a category's statistics from the totals, before it is removed or edited.
+     * @param wc The category.
+     */
+    void uncountCategory(const WordCat &wc) const;
+
+    /**
+     * @brief Drops the least recently used lazily loaded categories until they fit in the memory budget.
+     */
+    void enforceBudget();
+
+    /**
+     * @brief Hands a snapshot of the categories to the autosaver if any of them changed since the last one.
+     * Unchanged categories reuse the text already saved, so only edited ones are copied.
+     */
+    void autosaveCheckpoint();
+
+    /**
+     * @brief Remembers a loaded file, and starts watching it if watching is on.
+     * @param filename The file.
+     */
+    void fileLoaded(const std::string &filename);
+
+    /**
+     * @brief Starts watching a file, keeping the hashes of its categories to compare the next version with.
+     * @param filename The file.
+     */
+    void watchFile(const std::string &filename);
+
+    /**
+     * @brief Applies the changes between the last loaded version of a watched file and the current one.
+     * Categories whose bytes did not change are not parsed at all; a changed category is made to hold
+     * exactly the words the file now gives it, and a category gone from the file is dropped.
+     * @param filename The file.
+     * @return The number of categories added, removed or changed.
+     */
+    size_t reloadFile(const std::string &filename);
+
+    /**
+     * @brief Rebuilds the filter from every category if it is stale or overfull.
+     */
+    void refreshFilter() const;
 
     /**
      * @brief Displays a menu of options and prompts for user input.
@@ -33,9 +114,9 @@ public:
     WordCatVec() = default;
 
     /**
-     * @brief Copy constructor.
+     * @brief Copy constructor (deleted: a WordCatVec owns its autosave thread).
      */
-    WordCatVec(const WordCatVec &other) = default;
+    WordCatVec(const WordCatVec &other) = delete;
 
     /**
      * @brief Move constructor.
@@ -43,10 +124,10 @@ public:
     WordCatVec(WordCatVec &&other) = default;
 
     /**
-     * @brief Copy assignment operator.
+     * @brief Copy assignment operator (deleted: a WordCatVec owns its autosave thread).
      * @return A reference to this WordCatVec.
      */
-    WordCatVec &operator=(const WordCatVec &other) = default;
+    WordCatVec &operator=(const WordCatVec &other) = delete;
 
     /**
      * @brief Move assignment operator.
@@ -79,10 +160,242 @@ public:
 
     /**
      * @brief Loads the categories from a specified text file.
+     * Words of a category that already exists are added to it instead of creating a second one.
      * @param filename The name of the file to load from.
      */
     void loadFromFile(const std::string &filename);
 
+    /**
+     * @brief Loads the categories of several files, reading and parsing the files concurrently.
+     * Categories with the same name are merged into one, in a deterministic order:
+     * files in the order given, then categories and words in file order.
+     * @param filenames The names of the files to load from.
+     */
+    void loadFromFiles(const std::vector<std::string> &filenames);
+
+    /**
+     * @brief Loads every regular file of a directory (in file name order) with loadFromFiles.
+     * @param directory The name of the directory to load from.
+     */
+    void loadFromDirectory(const std::string &directory);
+
+    /**
+     * @brief Starts saving the categories in the background, between commands of run().
+     * A save happens once dirtyThreshold categories changed, or interval after the first unsaved change.
+     * The file is replaced atomically, so it always holds a complete save.
+     * @param config When and where to save.
+     */
+    void enableAutosave(const AutoSaver::Config &config);
+
+    /**
+     * @brief Writes any pending snapshot and stops saving in the background.
+     */
+    void disableAutosave();
+
+    /**
+     * @brief Turns watching the loaded files (and the ones loaded later) on or off.
+     * While on, run() applies the changes made to them by other programs before every command.
+     * @param on True to watch.
+     * @return False if the files cannot be watched.
+     */
+    bool setWatching(bool on);
+
+    /**
+     * @brief Applies the changes made to the watched files since the last call.
+     * Only the categories whose bytes changed are parsed; their words are diffed against the
+     * previous version and only the added and removed words are applied.
+     * @return The number of categories added, removed or changed.
+     */
+    size_t applyFileChanges();
+
+    /**
+     * @brief Finds a category by name, without copying any name.
+     * @param catName The name of the category.
+     * @return The category, or nullptr if there is none with that name.
+     */
+    const WordCat *findCategory(std::string_view catName) const;
+
+    /**
+     * @brief Calls visit for every category, in order, without copying them.
+     * @param visit Called with each category.
+     */
+    void forEachCategory(const std::function<void(const WordCat &)> &visit) const;
+
+    /**
+     * @brief Finds the categories that contain a word.
+     * Words absent from every category are rejected by a filter without searching any of them.
+     * @param word The word to look for.
+     * @return The names of the categories containing the word.
+     */
+    std::vector<std::string> findWord(const std::string &word) const;
+
+    /**
+     * @brief Finds the words of every category using exactly the given letters (case-insensitive).
+     * Each category answers from its anagram index (built on first use, then kept up to date by the edits).
+     * @param letters The letters, in any order (eg. a word to find the anagrams of).
+     * @return (category name, word) pairs, in category order.
+     */
+    std::vector<std::pair<std::string, std::string>> findAnagrams(const std::string &letters) const;
+
+    /**
+     * @brief Finds the words of every category that can be formed from some tiles, each tile used at most once.
+     * @param tiles The letters available (case-insensitive); '?' is a blank standing for any letter.
+     * @param minLength Shortest word to report.
+     * @return (category name, word) pairs, in category order, longest words first within a category.
+     */
+    std::vector<std::pair<std::string, std::string>> findFormable(const std::string &tiles, size_t minLength = 1) const;
+
+    /**
+     * @brief Finds the words fitting a crossword pattern, such as "?a???e?", in some categories.
+     * Each category answers from its positional index (built on first use, then kept up to date by the edits).
+     * @param pattern One character per letter of the word: the letter it must have there (case-insensitive), or '?', '.' or '_' for any.
+     * @param categoryNames The categories to search (empty: all of them).
+     * @return (category name, word) pairs, in category order.
+     */
+    std::vector<std::pair<std::string, std::string>> findCrossword(const std::string &pattern, const std::vector<std::string> &categoryNames = {}) const;
+
+    /**
+     * @brief Builds a read-only copy of every category with O(1) lookups, to save and map later.
+     * Each category keeps its distinct words.
+     * @return The frozen dictionary.
+     */
+    FrozenDictionary freeze() const;
+
+    /**
+     * @brief Checks the words of a document against every category, streaming it in chunks on several threads.
+     * The categories are frozen first (see freeze) so that every word is one batched hash probe.
+     * @param filename The document.
+     * @param emit Called with each token in document order, with the names of the categories it is in (none if unknown).
+     * @param summary Receives the counts and the time taken.
+     * @param unknownOnly True to only emit unknown tokens.
+     * @return False if the document cannot be read.
+     */
+    bool spellCheck(const std::string &filename, const std::function<void(const SpellChecker::Token &, const std::vector<std::string_view> &)> &emit, SpellChecker::Summary &summary, bool unknownOnly = false) const;
+
+    /**
+     * @brief Returns a cursor over the words of every category mixed together, sorted by their bytes.
+     * Only the pages asked for get sorted.
+     * @return The cursor; it holds views of the words, so it must not outlive an edit.
+     */
+    SortedCursor allWordsCursor() const;
+
+    /**
+     * @brief Sets the number of words per page in the listings (options 1, 6, 7 and inside a category).
+     * @param size The number of words per page (0 shows everything at once).
+     */
+    void setPageSize(size_t size);
+
+    /**
+     * @brief Sets who is told how long each command of run takes, including the commands run inside a category.
+     * An interaction with a category (option 5) is reported once more as a whole, after its own commands.
+     * @param observer Called after each command (empty to stop timing).
+     */
+    void setCommandObserver(CommandObserver observer);
+
+    /**
+     * @brief Finds the words matching a pattern in every category.
+     * Categories are scanned on several threads, each over its sorted words (built once and kept
+     * until the category changes), and matches are streamed in category order as soon as the
+     * categories before them are done.
+     * @param pattern The compiled pattern.
+     * @param emit Called with the category name and each distinct matching word, sorted within a category.
+     * @return The number of matches.
+     */
+    size_t findPattern(const Pattern &pattern, const std::function<void(const std::string &, const std::string &)> &emit) const;
+
+    /**
+     * @brief Sets the false positive rate of the lookup filters (this one and every category's).
+     * @param rate The wanted false positive rate (eg. 0.01 for 1%).
+     */
+    void setFilterFalsePositiveRate(double rate);
+
+    /**
+     * @brief Returns the hit / miss counters of the filter over all categories.
+     * @return The hit / miss counters of the filter over all categories.
+     */
+    BloomFilter::Stats getFilterStats() const;
+
+    /**
+     * @brief Picks k distinct words uniformly at random across all categories.
+     * Each draw is one binary search over the category sizes plus one O(1) indexed access.
+     * @param k The number of words to pick.
+     * @param rng The random number generator to use.
+     * @return The picked (category name, word) pairs.
+     */
+    std::vector<std::pair<std::string, std::string>> sample(size_t k, std::mt19937 &rng) const;
+
+    /**
+     * @brief Picks k words (with replacement) across all categories, each with a probability proportional to its weight.
+     * @param k The number of words to pick.
+     * @param weight Returns the weight of a word, given its category name and the word.
+     * @param rng The random number generator to use.
+     * @return The picked (category name, word) pairs.
+     */
+    std::vector<std::pair<std::string, std::string>> sampleWeighted(size_t k, const std::function<double(const std::string &, const std::string &)> &weight, std::mt19937 &rng) const;
+
+    /**
+     * @brief Applies a set operation to several categories, streaming the result in sorted order.
+     * Each category's words are sorted once and reused until the category changes.
+     * @param op The operation to apply.
+     * @param catNames The names of the categories, in order (the order matters for Difference).
+     * @param emit Called with each word of the result.
+     * @return False if one of the categories does not exist.
+     */
+    bool setOperation(SetOps::Operation op, const std::vector<std::string> &catNames, const SetOps::Emit &emit) const;
+
+    /**
+     * @brief Applies a set operation to several categories and stores the result as a new category.
+     * @param op The operation to apply.
+     * @param catNames The names of the categories, in order (the order matters for Difference).
+     * @param resultName The name of the new category.
+     * @return False if one of the categories does not exist.
+     */
+    bool setOperationToCategory(SetOps::Operation op, const std::vector<std::string> &catNames, const std::string &resultName);
+
+    /**
+     * @brief Returns the statistics over every category, without looking at the words.
+     * @return The statistics over every category.
+     */
+    const VocabStats &getStats() const;
+
+    /**
+     * @brief Returns the statistics of one category.
+     * @param catName The name of the category.
+     * @return The statistics of the category, or nullptr if it does not exist.
+     */
+    const VocabStats *getStats(const std::string &catName) const;
+
+    /**
+     * @brief Turns lazy loading on or off for the next loadFromFile.
+     * @param lazy True to only scan the category directory at load time.
+     */
+    void setLazyLoading(bool lazy);
+
+    /**
+     * @brief Sets how much memory lazily loaded categories may use before cold ones are dropped.
+     * @param bytes The budget in bytes (0 means no limit).
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /**
+     * @brief Returns the estimated memory used by the words of all categories currently in memory.
+     * @return The estimated number of bytes.
+     */
+    size_t materializedBytes() const;
+
+    /**
+     * @brief Returns where the bytes of every category and of this container go.
+     * @return The memory used, all categories included.
+     */
+    MemoryUsage memoryBreakdown() const;
+
+    /**
+     * @brief Rebuilds every category into tight storage, releases unused capacity
+     * and gives the freed memory back to the operating system.
+     * @return The number of bytes released, according to memoryBreakdown.
+     */
+    size_t compact();
+
     /**
      * @brief Output stream operator overload for WordCatVec.
      * @param out The output stream.
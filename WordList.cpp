@@ -1,38 +1,287 @@
 #include "WordList.h"
+#include <algorithm>
+#include <unordered_set>
 using namespace std;
 
-Word &WordList::front() { return theList.front(); } // .front() returns a reference to the first element in the list
-Word &WordList::back() { return theList.back(); }   // .back() returns a reference to the last element in the list
-const Word &WordList::front() const { return theList.front(); }
-const Word &WordList::back() const { return theList.back(); }
+// the arena asks upstream for big chunks and hands out node / string sized blocks from them,
+// so building a list costs a handful of mallocs instead of one (or two) per word
+WordList::CountingResource::CountingResource(pmr::memory_resource *upstream) : upstream(upstream) {}
+
+void *WordList::CountingResource::do_allocate(size_t size, size_t alignment)
+{
+    void *p = upstream->allocate(size, alignment);
+    bytes += size;
+    return p;
+}
+
+void WordList::CountingResource::do_deallocate(void *p, size_t size, size_t alignment)
+{
+    upstream->deallocate(p, size, alignment);
+    bytes -= size;
+}
+
+bool WordList::CountingResource::do_is_equal(const pmr::memory_resource &other) const noexcept { return this == &other; }
+
+WordList::Storage::Storage(pmr::memory_resource *upstream) : counter(upstream), arena(&counter), theList(new (raw) pmr::list<Word>(&arena)) {}
+
+// the old list is simply forgotten: its nodes and strings were all inside the arena, which release() gives back in one go
+// (skipping the destructors is fine because all they would do is deallocate into the same arena)
+void WordList::Storage::reset()
+{
+    arena.release();
+    theList = new (raw) pmr::list<Word>(&arena);
+    index.clear();
+}
+
+void WordList::Storage::reindex()
+{
+    index.clear();
+    for (auto &word : *theList)
+    {
+        index.push_back(&word); // list nodes never move, so the pointers stay valid until the word is removed
+    }
+}
+
+WordList::WordList(pmr::memory_resource *resource) : upstream(resource) {}
+
+// copying builds a brand new arena for the copy, the two lists never share memory
+WordList::WordList(const WordList &array) : upstream(array.upstream)
+{
+    if (!array.isEmpty())
+    {
+        list().assign(array.storage->theList->begin(), array.storage->theList->end()); // each Word is copied with exactly its length
+        storage->reindex();
+    }
+}
+
+WordList &WordList::operator=(const WordList &rhs)
+{
+    if (this != &rhs)
+    {
+        WordList copy(rhs);              // copy into a fresh arena first
+        upstream = copy.upstream;
+        storage = std::move(copy.storage); // then take it over, our old arena is released when copy's storage is destroyed
+    }
+    return *this;
+}
+
+pmr::list<Word> &WordList::list()
+{
+    if (!storage) // a new (or moved-from) WordList has no arena yet
+    {
+        storage = make_unique<Storage>(upstream);
+    }
+    return *storage->theList;
+}
+
+Word &WordList::front() { return list().front(); } // .front() returns a reference to the first element in the list
+Word &WordList::back() { return list().back(); }   // .back() returns a reference to the last element in the list
+const Word &WordList::front() const { return storage->theList->front(); }
+const Word &WordList::back() const { return storage->theList->back(); }
 // the difference between const and non-const functions is that the const functions do not modify the object
 // the reason why we need both is because the compiler will not allow us to call a non-const function on a const object
 
-void WordList::push_front(const Word &word) { theList.push_front(word); } // .push_front() adds an element to the front of the list
-void WordList::push_back(const Word &word) { theList.push_back(word); }   // .push_back() adds an element to the back of the list
-void WordList::pop_front() { theList.pop_front(); }                       // .pop_front() removes the first element in the list
-void WordList::pop_back() { theList.pop_back(); }                         // .pop_back() removes the last element in the list
-void WordList::remove(const Word &word) { theList.remove(word); }         // .remove() removes all elements in the list that are equal to the argument
+// every edit also updates the index, so that get(n) never has to walk the list
+void WordList::push_front(const Word &word) // .push_front() adds an element to the front of the list
+{
+    list().push_front(word);
+    storage->index.push_front(&storage->theList->front());
+}
+
+void WordList::push_back(const Word &word) // .push_back() adds an element to the back of the list
+{
+    list().push_back(word);
+    storage->index.push_back(&storage->theList->back());
+}
+
+void WordList::emplace_back(string_view word) // no temporary Word : the characters are copied once, into the arena
+{
+    list().emplace_back(word);
+    storage->index.push_back(&storage->theList->back());
+}
+
+void WordList::pop_front() // .pop_front() removes the first element in the list
+{
+    list().pop_front();
+    storage->index.pop_front();
+}
+
+void WordList::pop_back() // .pop_back() removes the last element in the list
+{
+    list().pop_back();
+    storage->index.pop_back();
+}
+
+void WordList::remove(const Word &word) // .remove() removes all elements in the list that are equal to the argument
+{
+    list().remove(word);
+    storage->reindex(); // removing walks the whole list anyway
+}
+
+size_t WordList::removeIf(const function<bool(const Word &)> &predicate)
+{
+    if (isEmpty())
+    {
+        return 0;
+    }
+    size_t before = storage->theList->size();
+    storage->theList->remove_if(predicate);
+    storage->reindex();
+    return before - storage->theList->size();
+}
 // all these . functions are member functions of the std::list class
 
+MemoryUsage WordList::memoryBreakdown() const
+{
+    MemoryUsage usage;
+    if (isEmpty())
+    {
+        return usage;
+    }
+    const size_t inlineCapacity = Word().capacity(); // short words live inside the Word itself, no extra allocation
+    const size_t nodeSize = sizeof(Word) + 2 * sizeof(void *); // a list node is the Word plus its two links
+    size_t inUse = 0;                                          // bytes of the arena holding live nodes and strings
+    for (const auto &word : *storage->theList)
+    {
+        ++usage.words;
+        ++usage.nodes;
+        usage.payloadBytes += word.length();
+        inUse += nodeSize;
+        if (word.capacity() > inlineCapacity)
+        {
+            usage.overheadBytes += nodeSize + 1; // + the '\0' at the end of the characters
+            usage.slackBytes += word.capacity() - word.length();
+            inUse += word.capacity() + 1;
+        }
+        else
+        {
+            usage.overheadBytes += nodeSize - word.length(); // the characters are inside the node
+        }
+    }
+    // what the arena holds beyond that: room left by removed words, and its size-class rounding
+    if (storage->counter.bytes > inUse)
+    {
+        usage.slackBytes += storage->counter.bytes - inUse;
+    }
+    // the index is a deque of pointers, allocated in blocks of 512 bytes
+    size_t indexBytes = storage->index.size() * sizeof(Word *);
+    usage.overheadBytes += indexBytes + sizeof(Storage);
+    usage.slackBytes += (512 - indexBytes % 512) % 512;
+    return usage;
+}
+
+void WordList::shrinkToFit()
+{
+    if (isEmpty())
+    {
+        storage.reset(); // not even an empty arena is kept
+        return;
+    }
+    WordList tight(*this);         // the copy allocates exactly what the Words need, in a new arena
+    storage = move(tight.storage); // and the old arena goes away with everything it held
+}
+
 Word WordList::get(int n) // takes parameter n and returns the nth element in the list
 {
-    auto it = theList.begin(); // auto is a placeholder for the type of the variable
-                               // it is used when the type of the variable is too long or too complicated to write out
-                               // .begin() returns an iterator to the first element in the list
-                               // an iterator is a pointer to an element in the list
-                               // it is not like .front() which returns a reference to the first element
-                               // the reason why we use an iterator is because we can use it to traverse the list
-    std::advance(it, n);       // .advance() moves the iterator n elements forward
-    return *it;
+    if (n < 0)
+    {
+        throw out_of_range("WordList::get: negative position");
+    }
+    return at(static_cast<size_t>(n));
+}
+
+const Word &WordList::at(size_t n) const // the index turns "walk n nodes" into "read slot n"
+{
+    if (n >= size())
+    {
+        throw out_of_range("WordList::at: position " + to_string(n) + " out of range (size " + to_string(size()) + ")");
+    }
+    return *storage->index[n];
+}
+
+vector<size_t> WordList::sampleIndexes(size_t k, size_t n, mt19937 &rng)
+{
+    vector<size_t> picked;
+    if (k >= n) // everything, in random order
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            picked.push_back(i);
+        }
+        shuffle(picked.begin(), picked.end(), rng);
+        return picked;
+    }
+    // Floyd's algorithm : one random draw per picked position, no matter how big n is
+    unordered_set<size_t> seen;
+    for (size_t j = n - k; j < n; ++j)
+    {
+        size_t t = uniform_int_distribution<size_t>(0, j)(rng);
+        size_t choice = seen.count(t) ? j : t;
+        seen.insert(choice);
+        picked.push_back(choice);
+    }
+    shuffle(picked.begin(), picked.end(), rng);
+    return picked;
+}
+
+vector<size_t> WordList::sampleWeightedIndexes(const vector<double> &weights, size_t k, mt19937 &rng)
+{
+    vector<size_t> picked;
+    double total = 0;
+    vector<double> cumulative; // cumulative[i] = sum of the weights up to i, so a draw is one binary search
+    cumulative.reserve(weights.size());
+    for (double w : weights)
+    {
+        total += max(w, 0.0);
+        cumulative.push_back(total);
+    }
+    if (total <= 0)
+    {
+        return picked;
+    }
+    uniform_real_distribution<double> dist(0.0, total);
+    for (size_t i = 0; i < k; ++i)
+    {
+        auto it = upper_bound(cumulative.begin(), cumulative.end(), dist(rng));
+        picked.push_back(min<size_t>(it - cumulative.begin(), weights.size() - 1));
+    }
+    return picked;
+}
+
+vector<Word> WordList::sample(size_t k, mt19937 &rng) const
+{
+    vector<Word> words;
+    for (size_t i : sampleIndexes(k, size(), rng))
+    {
+        words.push_back(at(i));
+    }
+    return words;
+}
+
+vector<Word> WordList::sampleWeighted(size_t k, const function<double(const Word &)> &weight, mt19937 &rng) const
+{
+    vector<double> weights;
+    weights.reserve(size());
+    forEach([&](const Word &word)
+            { weights.push_back(weight(word)); });
+    vector<Word> words;
+    for (size_t i : sampleWeightedIndexes(weights, k, rng))
+    {
+        words.push_back(at(i));
+    }
+    return words;
 }
 
 // .write() writes the contents of the list to the output stream sout
 // the n parameter is the number of elements to write to the output stream before starting a new line
 void WordList::write(std::ostream &sout, int n) const
 {
+    if (isEmpty())
+    {
+        return;
+    }
     int count = 0;
-    for (const auto &word : theList) // the : operator means "in" so this loop reads as "for each word in the list" that you can't modify
+    for (const auto &word : *storage->theList) // the : operator means "in" so this loop reads as "for each word in the list" that you can't modify
     {
         sout << word << ' ';  // print the word to the output stream
         if (++count % n == 0) // and if you reach the nth word
@@ -43,11 +292,29 @@ void WordList::write(std::ostream &sout, int n) const
     }
 }
 
-bool WordList::isEmpty() const { return theList.empty(); } // .empty() returns true if the list is empty, false otherwise
+bool WordList::isEmpty() const { return !storage || storage->theList->empty(); } // .empty() returns true if the list is empty, false otherwise
+
+size_t WordList::size() const { return storage ? storage->theList->size() : 0; } // .size() is constant time for std::list
+
+void WordList::forEach(const std::function<void(const Word &)> &visit) const
+{
+    if (isEmpty())
+    {
+        return;
+    }
+    for (const auto &word : *storage->theList)
+    {
+        visit(word);
+    }
+}
 
 bool WordList::lookup(const Word &word) const
 {
-    for (const auto &w : theList) // for every word (variable here called w, could be anything) in the list
+    if (isEmpty())
+    {
+        return false;
+    }
+    for (const auto &w : *storage->theList) // for every word (variable here called w, could be anything) in the list
     {
         if (w == word) // if the word is equal to the argument / pararmeter word you passed in
         {
@@ -57,12 +324,44 @@ bool WordList::lookup(const Word &word) const
     return false; // else return false
 }
 
+bool WordList::contains(std::string_view word) const
+{
+    if (isEmpty())
+    {
+        return false;
+    }
+    for (const auto &w : *storage->theList)
+    {
+        if (w.view() == word)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const pmr::list<Word> noWords; // what an empty WordList without an arena iterates over
+
+pmr::list<Word>::const_iterator WordList::begin() const { return storage ? storage->theList->cbegin() : noWords.cbegin(); }
+
+pmr::list<Word>::const_iterator WordList::end() const { return storage ? storage->theList->cend() : noWords.cend(); }
+
 std::forward_list<Word> WordList::getSinglyLinkedList() const // .getSinglyLinkedList() returns a singly linked list of the elements in the list
 {
-    return std::forward_list<Word>(theList.begin(), theList.end()); // forward_list is a singly linked list
+    if (isEmpty())
+    {
+        return std::forward_list<Word>();
+    }
+    return std::forward_list<Word>(storage->theList->begin(), storage->theList->end()); // forward_list is a singly linked list
 }
 
-void WordList::clear() { theList.clear(); } // .clear() removes all elements from the list
+void WordList::clear() // releases the whole arena at once instead of freeing every word one by one
+{
+    if (storage)
+    {
+        storage->reset();
+    }
+}
 
 std::ostream &operator<<(std::ostream &sout, const WordList &wordList) // << is the stream insertion operator
 {
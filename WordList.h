@@ -2,27 +2,95 @@
 #define WORDLIST_H
 
 #include "Word.h"
+#include "MemoryUsage.h"
 #include <stdexcept>
 #include <iostream>
 #include <list>
 #include <forward_list>
+#include <memory>
+#include <memory_resource>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <random>
 
 class WordList
 {
 private:
-    std::list<Word> theList; // list<Word> is a doubly linked list
+    /**
+     * Passes allocations on to another memory resource, counting the bytes it currently holds.
+     * Sits under the arena, so the memory the arena keeps for reuse is visible too.
+     */
+    struct CountingResource : std::pmr::memory_resource
+    {
+        explicit CountingResource(std::pmr::memory_resource *upstream);
+
+        std::pmr::memory_resource *upstream; ///< where the memory really comes from
+        size_t bytes = 0;                    ///< bytes currently allocated through this resource
+
+    private:
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+    };
+
+    /**
+     * The arena and the list that allocates from it, kept together on the heap.
+     * Moving a WordList (eg. when a vector<WordCat> is sorted) only moves the pointer,
+     * so the list nodes never end up owned by a list using a different arena.
+     */
+    struct Storage
+    {
+        /**
+         * Creates an empty list whose nodes and strings are carved out of a pool arena.
+         * @param upstream Where the arena gets its big chunks of memory from.
+         */
+        explicit Storage(std::pmr::memory_resource *upstream);
+
+        /**
+         * Drops every word at once by handing the arena's chunks back upstream.
+         * The list is never walked: everything it owns lives in the arena.
+         */
+        void reset();
+
+        CountingResource counter;                     ///< counts the memory the arena took from upstream
+        std::pmr::unsynchronized_pool_resource arena; ///< per-list arena the nodes and Word strings come from
+        alignas(std::pmr::list<Word>) unsigned char raw[sizeof(std::pmr::list<Word>)]; ///< room for the list, which is never destroyed on its own
+        std::pmr::list<Word> *theList;                 ///< list<Word> is a doubly linked list, built inside raw
+        std::deque<Word *> index;                      ///< index[i] points at the i-th Word of theList, for O(1) access
+
+        /**
+         * Rebuilds index from theList, after an edit in the middle of the list.
+         */
+        void reindex();
+    };
+
+    std::pmr::memory_resource *upstream = std::pmr::get_default_resource(); ///< where new arenas get their memory from
+    std::unique_ptr<Storage> storage;                                        ///< created on the first insertion (null means empty)
+
+    /**
+     * Returns the underlying list, creating the arena on first use.
+     * @return The underlying list.
+     */
+    std::pmr::list<Word> &list();
 
 public:
     /**
-     * Default constructor. Initializes an empty WordList.
+     * Default constructor. Initializes an empty WordList backed by its own arena.
      */
     WordList() = default;
 
     /**
-     * Copy constructor. Creates a new WordList as a copy of an existing one.
+     * Constructor that initializes an empty WordList whose arena draws from a given memory resource.
+     * @param resource The memory resource the arena gets its chunks from.
+     */
+    explicit WordList(std::pmr::memory_resource *resource);
+
+    /**
+     * Copy constructor. Creates a new WordList as a copy of an existing one, in a new arena.
      * @param array The WordList to copy.
      */
-    WordList(const WordList &array) = default;
+    WordList(const WordList &array);
 
     /**
      * Move constructor. Creates a new WordList by moving the contents of an existing one.
@@ -35,7 +103,7 @@ public:
      * @param rhs The WordList to copy.
      * @return A reference to the WordList that the contents were copied to.
      */
-    WordList &operator=(const WordList &rhs) = default;
+    WordList &operator=(const WordList &rhs);
 
     /**
      * Move assignment operator. Moves the contents of one WordList to another.
@@ -85,6 +153,12 @@ public:
      */
     void push_back(const Word &word);
 
+    /**
+     * Adds a Word made from some characters to the back of the list, built directly in the list's arena.
+     * @param word The characters of the Word.
+     */
+    void emplace_back(std::string_view word);
+
     /**
      * Removes the first Word from the list.
      */
@@ -102,12 +176,63 @@ public:
     void remove(const Word &word);
 
     /**
-     * Returns the Word at a specific position in the list.
+     * Removes every Word for which a predicate returns true, in one pass over the list.
+     * @param predicate Called once per Word, in order.
+     * @return The number of Words removed.
+     */
+    size_t removeIf(const std::function<bool(const Word &)> &predicate);
+
+    /**
+     * Returns the Word at a specific position in the list, in constant time.
      * @param n The position of the Word to return.
      * @return The Word at the specified position.
+     * @throws std::out_of_range if n is not a valid position.
      */
     Word get(int n);
 
+    /**
+     * Returns a const reference to the Word at a specific position in the list, in constant time.
+     * @param n The position of the Word to return.
+     * @return A const reference to the Word at the specified position.
+     * @throws std::out_of_range if n is not a valid position.
+     */
+    const Word &at(size_t n) const;
+
+    /**
+     * Picks k distinct Words uniformly at random (all of them, shuffled, if k >= size()).
+     * @param k The number of Words to pick.
+     * @param rng The random number generator to use.
+     * @return The picked Words.
+     */
+    std::vector<Word> sample(size_t k, std::mt19937 &rng) const;
+
+    /**
+     * Picks k Words at random (with replacement), each with a probability proportional to its weight.
+     * @param k The number of Words to pick.
+     * @param weight Returns the weight of a Word (negative weights count as 0).
+     * @param rng The random number generator to use.
+     * @return The picked Words.
+     */
+    std::vector<Word> sampleWeighted(size_t k, const std::function<double(const Word &)> &weight, std::mt19937 &rng) const;
+
+    /**
+     * Picks k distinct positions out of n uniformly at random (Floyd's algorithm, O(k)).
+     * @param k The number of positions to pick.
+     * @param n The number of positions to pick from.
+     * @param rng The random number generator to use.
+     * @return The picked positions, in random order.
+     */
+    static std::vector<size_t> sampleIndexes(size_t k, size_t n, std::mt19937 &rng);
+
+    /**
+     * Picks k positions at random (with replacement), each with a probability proportional to its weight.
+     * @param weights The weight of each position (negative weights count as 0).
+     * @param k The number of positions to pick.
+     * @param rng The random number generator to use.
+     * @return The picked positions.
+     */
+    static std::vector<size_t> sampleWeightedIndexes(const std::vector<double> &weights, size_t k, std::mt19937 &rng);
+
     /**
      * Writes the contents of the list to an output stream, with a specified number of words per line.
      * @param sout The output stream to write to.
@@ -121,6 +246,37 @@ public:
      */
     bool isEmpty() const;
 
+    /**
+     * Returns the number of Words in the list.
+     * @return The number of Words in the list.
+     */
+    size_t size() const;
+
+    /**
+     * Calls a function for every Word in the list, in order, without copying them.
+     * @param visit The function to call with each Word.
+     */
+    void forEach(const std::function<void(const Word &)> &visit) const;
+
+    /**
+     * Returns true if a word is in the list, false otherwise. Does not build a Word to compare with.
+     * @param word The characters to look for.
+     * @return True if the word is in the list, false otherwise.
+     */
+    bool contains(std::string_view word) const;
+
+    /**
+     * Returns an iterator to the first Word, for read-only range-for loops without copies.
+     * @return An iterator to the first Word.
+     */
+    std::pmr::list<Word>::const_iterator begin() const;
+
+    /**
+     * Returns an iterator past the last Word.
+     * @return An iterator past the last Word.
+     */
+    std::pmr::list<Word>::const_iterator end() const;
+
     /**
      * Returns true if a specific Word is in the list, false otherwise.
      * @param word The Word to look for.
@@ -129,10 +285,23 @@ public:
     bool lookup(const Word &word) const;
 
     /**
-     * Removes all Words from the list.
+     * Removes all Words from the list. The whole arena is released at once instead of
+     * freeing every node and string one by one.
      */
     void clear();
 
+    /**
+     * Returns where the bytes of the list go: characters, list nodes, the index and unused capacity.
+     * @return The memory used by the list.
+     */
+    MemoryUsage memoryBreakdown() const;
+
+    /**
+     * Copies the Words into a fresh arena, each string exactly as long as its Word,
+     * and releases the old arena with all the room left behind by removed Words.
+     */
+    void shrinkToFit();
+
     /**
      * Returns a singly linked list containing the same words as this list.
      * @return A singly linked list containing the same words as this list.
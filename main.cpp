@@ -1,4 +1,14 @@
 #include "WordCatVec.h"
+#include "SessionReplay.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+using namespace std;
 
 void testWordCatVec()
 {
@@ -6,8 +16,107 @@ void testWordCatVec()
     word_cat_vec.run();
 }
 
-int main()
+// The file the saves of a generated script go to, next to the script.
+string saveFileOf(const string &scriptFile) { return scriptFile + ".saved.txt"; }
+
+// Prints how the session modes are used, after a malformed command line.
+void printUsage()
+{
+    cerr << "Usage: wordcat\n"
+         << "       wordcat --record script.txt\n"
+         << "       wordcat --generate script.txt vocab.txt [commands] [seed]\n"
+         << "       wordcat --replay script.txt [repeats] [--baseline file] [--save-baseline file]\n";
+}
+
+// Reads a whole argument as a count. Returns false if it is not one (eg. a flag where a number was expected).
+bool parseCount(const char *text, unsigned long long &value)
+{
+    if (!isdigit(static_cast<unsigned char>(text[0]))) // strtoull would take a sign or spaces
+    {
+        return false;
+    }
+    char *end;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+// Replays a session script and prints the latency of every command, optionally comparing it with
+// (or saving it as) a baseline. Returns the number of regressions found.
+int replaySession(int argc, char *argv[])
+{
+    ifstream in(argv[2]);
+    if (!in)
+    {
+        cerr << "Error opening file: " << argv[2] << '\n';
+        return 1;
+    }
+    size_t repeats = 1;
+    string baseline, saveBaseline;
+    for (int i = 3; i < argc; ++i)
+    {
+        unsigned long long count;
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baseline = argv[++i];
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+            saveBaseline = argv[++i];
+        else if (parseCount(argv[i], count) && count > 0)
+            repeats = count;
+        else
+        {
+            cerr << "Not a number of repeats: " << argv[i] << '\n';
+            printUsage();
+            return 1;
+        }
+    }
+    stringstream script;
+    script << in.rdbuf();
+    SessionReplay replay;
+    SessionReplay::Report report = replay.replay(script.str(), repeats, saveFileOf(argv[2]));
+    report.write(cout);
+    if (!saveBaseline.empty() && report.save(saveBaseline))
+    {
+        cout << "Baseline saved to " << saveBaseline << '\n';
+    }
+    if (baseline.empty())
+    {
+        return 0;
+    }
+    SessionReplay::Report before;
+    if (!SessionReplay::Report::load(baseline, before))
+    {
+        cerr << "Not a session baseline: " << baseline << '\n';
+        return 1;
+    }
+    size_t regressions = SessionReplay::compare(report, before, cout);
+    cout << (regressions == 0 ? "No regressions.\n" : "Regressions found.\n");
+    return regressions == 0 ? 0 : 2;
+}
+
+int main(int argc, char *argv[])
 {
+    // no arguments : the interactive menus, as always
+    if (argc >= 3 && strcmp(argv[1], "--record") == 0) // wordcat --record script.txt
+    {
+        return SessionReplay::record(argv[2]) ? 0 : 1;
+    }
+    if (argc >= 4 && strcmp(argv[1], "--generate") == 0) // wordcat --generate script.txt vocab.txt [commands] [seed]
+    {
+        unsigned long long commands = 1000, seed = 1;
+        if ((argc >= 5 && !parseCount(argv[4], commands)) || (argc >= 6 && !parseCount(argv[5], seed)))
+        {
+            printUsage();
+            return 1;
+        }
+        string script = SessionReplay::generate(argv[3], commands, static_cast<uint32_t>(seed), saveFileOf(argv[2]));
+        ofstream out(argv[2]);
+        out << script;
+        return (!script.empty() && out) ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0) // wordcat --replay script.txt [repeats] [--baseline file] [--save-baseline file]
+    {
+        return replaySession(argc, argv);
+    }
     testWordCatVec();
     return 0;
 }
@@ -0,0 +1,157 @@
+// Allocation-count regression test (user-034): words live in their list's arena, so loading and
+// clearing a list costs a few large allocations rather than some per word, and the read-only
+// accessors of Word, WordList, WordCat and WordCatVec do not allocate at all.
+#include "../WordCatVec.h"
+#include "../VocabFile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+using namespace std;
+
+static size_t allocations = 0;   // every operator new since the program started
+static size_t deallocations = 0; // every operator delete
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept
+{
+    if (p)
+    {
+        ++deallocations;
+        free(p);
+    }
+}
+
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            cerr << __FILE__ << ':' << __LINE__ << ": failed: " #condition "\n"; \
+            ++failures;                                                        \
+        }                                                                      \
+    } while (false)
+
+// counts the allocations and deallocations made while it is alive
+struct Counter
+{
+    size_t news = allocations, deletes = deallocations;
+    size_t allocated() const { return allocations - news; }
+    size_t freed() const { return deallocations - deletes; }
+};
+
+static const size_t WORDS = 20000;
+
+// one word per line, all too long for the small string buffer, so each needs memory of its own
+static string makeLines()
+{
+    string lines;
+    for (size_t i = 0; i < WORDS; ++i)
+    {
+        lines += "vocabularyword" + to_string(i * 7919 % WORDS) + "xyz\n";
+    }
+    return lines;
+}
+
+static void loadAndClear(const string &lines)
+{
+    WordList words;
+    size_t loaded, cleared;
+    {
+        Counter counter;
+        VocabFile::appendWords(lines.data(), lines.data() + lines.size(), words);
+        loaded = counter.allocated();
+    }
+    CHECK(words.size() == WORDS);
+    cout << "load " << WORDS << " words: " << loaded << " allocations\n";
+    CHECK(loaded < WORDS / 50); // arena chunks and the index, not a node and a string per word
+    {
+        Counter counter;
+        words.clear();
+        cleared = counter.freed();
+    }
+    cout << "clear: " << cleared << " deallocations\n";
+    CHECK(cleared < WORDS / 50);
+    CHECK(words.isEmpty());
+}
+
+static void accessorsDoNotAllocate(const string &filename)
+{
+    WordCatVec categories;
+    categories.loadFromFile(filename);
+    const WordCatVec &constCategories = categories;
+    const WordCat *category = constCategories.findCategory("second");
+    CHECK(category != nullptr);
+    if (!category)
+    {
+        return;
+    }
+    const string present = "vocabularyword1xyz", absent = "notavocabularyword"; // made before counting
+    category->lookup(present); // builds the filter once
+    Counter counter;
+    size_t seen = 0, length = 0;
+    constCategories.forEachCategory([&](const WordCat &wc)
+                                    { length += wc.getCatName().size(); });
+    category->forEachWord([&](string_view word)
+                          { ++seen;
+                            length += word.size(); });
+    bool found = category->lookup(present);
+    bool missing = category->lookup(absent);
+    const WordCat *first = constCategories.findCategory("first");
+    CHECK(counter.allocated() == 0);
+    CHECK(seen == WORDS);
+    CHECK(found && !missing && first != nullptr);
+
+    WordList words;
+    words.emplace_back("alpha");
+    words.emplace_back("a rather long word, on the heap");
+    Counter listCounter;
+    bool contains = words.contains("a rather long word, on the heap");
+    for (const Word &word : static_cast<const WordList &>(words))
+    {
+        length += word.view().size();
+    }
+    bool less = words.front().isLessIgnoreCase(words.back());
+    CHECK(listCounter.allocated() == 0);
+    CHECK(contains);
+    (void)less;
+}
+
+int main()
+{
+    string lines = makeLines();
+    loadAndClear(lines);
+
+    const string filename = "AllocationTest.tmp";
+    {
+        ofstream out(filename);
+        out << "#first\nalpha\nbeta\n\n#second\n" << lines << '\n';
+    }
+    accessorsDoNotAllocate(filename);
+    remove(filename.c_str());
+
+    if (failures == 0)
+    {
+        cout << "AllocationTest: all passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
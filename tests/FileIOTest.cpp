@@ -0,0 +1,150 @@
+// Tests for the queued file I/O helpers (user-047): reads and writes through both backends, and
+// reuse of the backends borrowed from a thread.
+#include "../FileIO.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            cerr << __FILE__ << ':' << __LINE__ << ": failed: " #condition "\n"; \
+            ++failures;                                                        \
+        }                                                                      \
+    } while (false)
+
+// a few blocks and a bit, so that every helper has a partial last block
+static string makeText(size_t length)
+{
+    string text(length, ' ');
+    for (size_t i = 0; i < length; ++i)
+    {
+        text[i] = static_cast<char>('a' + (i * 31 + i / 977) % 26);
+    }
+    return text;
+}
+
+static string readWithStream(const string &filename)
+{
+    ifstream in(filename, ios::binary);
+    ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+static void readsAndWrites(const string &filename)
+{
+    const string text = makeText(3 * FileIO::BLOCK_BYTES + 12345);
+    {
+        FileWriter file(filename, false);
+        CHECK(file.isOpen());
+        ostream out(&file);
+        out.write(text.data(), 1000); // small writes, then one larger than every buffer together
+        out.write(text.data() + 1000, static_cast<streamsize>(text.size() - 1000));
+        CHECK(file.close());
+    }
+    CHECK(readWithStream(filename) == text);
+
+    string contents;
+    CHECK(FileIO::readAll(filename, contents));
+    CHECK(contents == text);
+    CHECK(FileIO::readRange(filename, FileIO::BLOCK_BYTES - 10, FileIO::BLOCK_BYTES + 20, contents));
+    CHECK(contents == text.substr(FileIO::BLOCK_BYTES - 10, FileIO::BLOCK_BYTES + 20));
+    CHECK(!FileIO::readRange(filename, text.size() - 5, 10, contents)); // past the end
+
+    string joined;
+    {
+        FileReader reader(filename);
+        CHECK(reader.isOpen());
+        const char *data;
+        size_t length;
+        while (reader.next(data, length))
+        {
+            joined.append(data, length);
+        }
+        CHECK(!reader.failed());
+    }
+    CHECK(joined == text);
+
+    {
+        FileWriter file(filename, true);
+        ostream out(&file);
+        out << "tail";
+        CHECK(file.close());
+    }
+    CHECK(readWithStream(filename) == text + "tail");
+
+    CHECK(!FileIO::readAll(filename + ".missing", contents));
+    FileReader missing(filename + ".missing");
+    CHECK(!missing.isOpen());
+}
+
+// a thread reuses the backends it gave back, and only makes another one while the first is in use
+static void reusesBackends(const string &filename)
+{
+    FileIO *first;
+    {
+        FileIO::Handle io = FileIO::acquire();
+        first = io.get();
+    }
+    {
+        FileIO::Handle again = FileIO::acquire();
+        CHECK(again.get() == first);
+        FileIO::Handle other = FileIO::acquire(); // the first one is lent out
+        CHECK(other.get() != first);
+    }
+    string contents;
+    for (int i = 0; i < 100; ++i) // many small reads, all on the same backend
+    {
+        CHECK(FileIO::readRange(filename, static_cast<uint64_t>(i), 10, contents));
+    }
+    FileIO::Handle io = FileIO::acquire();
+    CHECK(io.get() == first); // the reads borrowed it and gave it back
+    CHECK(!io->isBroken());
+}
+
+// running out of descriptors for a moment costs the ring of one file, not io_uring for good
+static void survivesTransientFailures()
+{
+    FileIO::setUringEnabled(true);
+    if (FileIO::create()->name() != string("io_uring"))
+    {
+        return; // no io_uring here : nothing to lose
+    }
+    rlimit limit;
+    CHECK(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    rlimit none = limit;
+    none.rlim_cur = 0; // every new descriptor fails with EMFILE
+    CHECK(setrlimit(RLIMIT_NOFILE, &none) == 0);
+    string fallback = FileIO::create()->name();
+    CHECK(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+    CHECK(fallback == string("pread/pwrite"));
+    CHECK(FileIO::create()->name() == string("io_uring"));
+}
+
+int main()
+{
+    const string filename = "FileIOTest.tmp";
+    for (bool uring : {true, false})
+    {
+        FileIO::setUringEnabled(uring);
+        cout << "backend: " << FileIO::acquire()->name() << '\n';
+        readsAndWrites(filename);
+        reusesBackends(filename);
+    }
+    survivesTransientFailures();
+    remove(filename.c_str());
+    if (failures == 0)
+    {
+        cout << "FileIOTest: all passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
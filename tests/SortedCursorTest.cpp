@@ -0,0 +1,99 @@
+// Regression test for the sorted page cursor of WordCat (user-040).
+// A category keeps the cursor of its last sorted page. The cursor points into the words of the category
+// that made it, so a copied or moved category (eg. after its vector grows) must make its own.
+#include "../WordCat.h"
+#include <algorithm>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            cerr << __FILE__ << ':' << __LINE__ << ": failed: " #condition "\n"; \
+            ++failures;                                                        \
+        }                                                                      \
+    } while (false)
+
+static WordCat makeCategory(const string &name, size_t count)
+{
+    WordCat category(name);
+    WordList words;
+    VocabStats stats;
+    for (size_t i = 0; i < count; ++i)
+    {
+        string word = "w" + to_string((i * 7919) % count); // not in sorted order
+        words.emplace_back(word);
+        stats.add(word);
+    }
+    category.appendWords(move(words), move(stats));
+    return category;
+}
+
+static vector<string> expectedPage(const WordCat &category, size_t page, size_t size)
+{
+    vector<string> all = category.getWords();
+    sort(all.begin(), all.end(), [](const string &a, const string &b)
+         { return FrontCodedList::less(a, b); });
+    vector<string> result;
+    for (size_t i = page * size; i < min(all.size(), (page + 1) * size); ++i)
+    {
+        result.push_back(all[i]);
+    }
+    return result;
+}
+
+// pages every category, grows the vector until it moves them, and pages them again
+static void pagesAfterGrowth(bool compressed)
+{
+    vector<WordCat> categories;
+    categories.reserve(1);
+    categories.push_back(makeCategory("first", 500));
+    if (compressed)
+    {
+        categories[0].compress();
+    }
+    CHECK(categories[0].sortedPage(0, 20) == expectedPage(categories[0], 0, 20));
+    const WordCat *before = &categories[0];
+    for (int i = 0; i < 8; ++i)
+    {
+        categories.push_back(makeCategory("more" + to_string(i), 50));
+    }
+    CHECK(&categories[0] != before); // the category did move
+    CHECK(categories[0].sortedPage(1, 20) == expectedPage(categories[0], 1, 20));
+    CHECK(categories[0].sortedPage(0, 20) == expectedPage(categories[0], 0, 20));
+}
+
+// a copy pages its own words, even once the original is edited or gone
+static void pagesAfterCopy()
+{
+    WordCat *original = new WordCat(makeCategory("original", 300));
+    CHECK(original->sortedPage(0, 10) == expectedPage(*original, 0, 10));
+    WordCat copy(*original);
+    WordCat moved(move(*original));
+    delete original;
+    CHECK(copy.sortedPage(2, 10) == expectedPage(copy, 2, 10));
+    CHECK(moved.sortedPage(2, 10) == expectedPage(moved, 2, 10));
+    WordCat assigned("assigned");
+    assigned.sortedPage(0, 10);
+    assigned = copy;
+    CHECK(assigned.sortedPage(3, 10) == expectedPage(copy, 3, 10));
+}
+
+int main()
+{
+    static_assert(is_nothrow_move_constructible<WordCat>::value, "moving a category must not copy it");
+    pagesAfterGrowth(false);
+    pagesAfterGrowth(true);
+    pagesAfterCopy();
+    if (failures == 0)
+    {
+        cout << "SortedCursorTest: all passed\n";
+    }
+    return failures == 0 ? 0 : 1;
+}